@@ -0,0 +1,49 @@
+# Copyright (C) 2018  Christian Berger
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+###########################################################################
+# Find libx264.
+FIND_PATH(X264_INCLUDE_DIR
+          NAMES x264.h
+          PATHS /usr/local/include/
+                /usr/include/)
+MARK_AS_ADVANCED(X264_INCLUDE_DIR)
+FIND_LIBRARY(X264_LIBRARY
+             NAMES x264
+             PATHS ${LIBX264DIR}/lib/
+                    /usr/lib/arm-linux-gnueabihf/
+                    /usr/lib/arm-linux-gnueabi/
+                    /usr/lib/x86_64-linux-gnu/
+                    /usr/local/lib64/
+                    /usr/lib64/
+                    /usr/lib/)
+MARK_AS_ADVANCED(X264_LIBRARY)
+
+###########################################################################
+IF (X264_INCLUDE_DIR
+    AND X264_LIBRARY)
+    SET(X264_FOUND 1)
+    SET(X264_LIBRARIES ${X264_LIBRARY})
+    SET(X264_INCLUDE_DIRS ${X264_INCLUDE_DIR})
+ENDIF()
+
+MARK_AS_ADVANCED(X264_LIBRARIES)
+MARK_AS_ADVANCED(X264_INCLUDE_DIRS)
+
+IF (X264_FOUND)
+    MESSAGE(STATUS "Found x264: ${X264_INCLUDE_DIRS}, ${X264_LIBRARIES}")
+ELSE ()
+    MESSAGE(STATUS "Could not find x264")
+ENDIF()
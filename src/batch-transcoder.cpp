@@ -0,0 +1,272 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cluon-complete.hpp"
+#include "opendlv-standard-message-set.hpp"
+#include "batch-transcoder.hpp"
+#include "gop-parallel-encoder.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+namespace {
+
+struct Timing {
+    cluon::data::TimeStamp sent{};
+    cluon::data::TimeStamp received{};
+    cluon::data::TimeStamp sampleTimeStamp{};
+};
+
+struct Stream {
+    uint32_t senderStamp{0};
+    uint32_t width{0};
+    uint32_t height{0};
+    std::mutex timingsMutex{};
+    std::deque<Timing> timings{}; // In the order of the pushed frames.
+    std::unique_ptr<GopParallelEncoder> encoder{};
+};
+
+// Holds the Envelopes back until no frame with an earlier sample time is
+// being encoded to write the recording in the order of the sample times.
+class RecordingWriter {
+   public:
+    explicit RecordingWriter(const std::string &filename) noexcept
+        : m_out(filename, std::ios::out | std::ios::binary | std::ios::trunc) {}
+
+    bool good() const noexcept {
+        return m_out.good();
+    }
+
+    void hold(cluon::data::Envelope &&envelope) noexcept {
+        std::lock_guard<std::mutex> lck(m_outMutex);
+        m_pending.push_back(std::move(envelope));
+        release();
+    }
+
+    void expect(int64_t sampleTime) noexcept {
+        std::lock_guard<std::mutex> lck(m_outMutex);
+        m_expected.insert(sampleTime);
+    }
+
+    void writeFrame(cluon::data::Envelope &&envelope, int64_t sampleTime) noexcept {
+        std::lock_guard<std::mutex> lck(m_outMutex);
+        auto it = std::upper_bound(m_pending.begin(), m_pending.end(), sampleTime, [](int64_t t, const cluon::data::Envelope &e) {
+            return t < cluon::time::toMicroseconds(e.sampleTimeStamp());
+        });
+        m_pending.insert(it, std::move(envelope));
+        finish(sampleTime);
+    }
+
+    void dropFrame(int64_t sampleTime) noexcept {
+        std::lock_guard<std::mutex> lck(m_outMutex);
+        finish(sampleTime);
+    }
+
+    void flush() noexcept {
+        std::lock_guard<std::mutex> lck(m_outMutex);
+        m_expected.clear();
+        release();
+    }
+
+    uint64_t bytes() const noexcept {
+        return m_bytes;
+    }
+
+   private:
+    void finish(int64_t sampleTime) noexcept {
+        auto it = m_expected.find(sampleTime);
+        if (m_expected.end() != it) {
+            m_expected.erase(it);
+        }
+        release();
+    }
+
+    void release() noexcept {
+        while (!m_pending.empty() && (m_expected.empty() || (cluon::time::toMicroseconds(m_pending.front().sampleTimeStamp()) < *m_expected.begin()))) {
+            write(std::move(m_pending.front()));
+            m_pending.pop_front();
+        }
+    }
+
+    void write(cluon::data::Envelope &&envelope) noexcept {
+        const std::string SERIALIZED{cluon::serializeEnvelope(std::move(envelope))};
+        m_out.write(SERIALIZED.data(), static_cast<std::streamsize>(SERIALIZED.size()));
+        m_bytes += SERIALIZED.size();
+    }
+
+   private:
+    std::mutex m_outMutex{};
+    std::ofstream m_out;
+    uint64_t m_bytes{0};
+    std::deque<cluon::data::Envelope> m_pending{};
+    std::multiset<int64_t> m_expected{}; // Sample times of the frames being encoded.
+};
+
+} // namespace
+
+bool transcodeRecording(const std::string &input, const std::string &output, std::map<std::string, std::string> &arguments, uint32_t jobs) noexcept {
+    uint32_t gop{10};
+    try {
+        gop = (arguments["gop"].size() != 0) ? static_cast<uint32_t>(std::max(std::stoi(arguments["gop"]), 0)) : gop;
+    }
+    catch (...) {
+        std::cerr << "Invalid GOP '" << arguments["gop"] << "'." << std::endl;
+        return false;
+    }
+    const uint32_t GOP{gop};
+    jobs = std::max(jobs, 1u);
+    // Transcoding has no real-time constraint; every frame is encoded.
+    arguments["frame-skip"] = "0";
+
+    // Single-threaded player to read the Envelopes in order of their sample timestamps.
+    cluon::Player player(input, false /*autoRewind*/, false /*threading*/);
+    if (!player.hasMoreData()) {
+        std::cerr << "Failed to read '" << input << "'." << std::endl;
+        return false;
+    }
+    RecordingWriter writer(output);
+    if (!writer.good()) {
+        std::cerr << "Failed to open '" << output << "'." << std::endl;
+        return false;
+    }
+
+    std::map<uint32_t, std::unique_ptr<Stream>> streams;
+    std::mutex framesMutex;
+    uint64_t framesIn{0};
+    uint64_t framesOut{0};
+    const cluon::data::TimeStamp START{cluon::time::now()};
+
+    // Creates the encoders for a new stream or a stream whose geometry changed.
+    auto setUp = [&](Stream &stream) {
+        if (stream.encoder) {
+            stream.encoder->flush();
+            stream.encoder.reset();
+        }
+        std::vector<std::unique_ptr<StreamEncoder>> encoders;
+        for (uint32_t i{0}; i < jobs; i++) {
+            encoders.emplace_back(new StreamEncoder(stream.width, stream.height, arguments));
+            if (!encoders.back()->valid()) {
+                return false;
+            }
+        }
+        Stream *s{&stream};
+        const std::string FOURCC{encoders[0]->fourcc()};
+        stream.encoder.reset(new GopParallelEncoder(std::move(encoders), GOP, [s, FOURCC, &writer, &framesMutex, &framesOut](EncodedFrame &&frame) {
+            Timing timing;
+            {
+                std::lock_guard<std::mutex> lck(s->timingsMutex);
+                timing = s->timings.front();
+                s->timings.pop_front();
+            }
+            if (frame.data.empty()) {
+                writer.dropFrame(cluon::time::toMicroseconds(timing.sampleTimeStamp));
+                return;
+            }
+            opendlv::proxy::ImageReading ir;
+            ir.fourcc(FOURCC).width(s->width).height(s->height).data(frame.data);
+            cluon::ToProtoVisitor protoEncoder;
+            ir.accept(protoEncoder);
+            cluon::data::Envelope envelope;
+            envelope.dataType(opendlv::proxy::ImageReading::ID())
+                .serializedData(protoEncoder.encodedData())
+                .sent(timing.sent)
+                .received(timing.received)
+                .sampleTimeStamp(timing.sampleTimeStamp)
+                .senderStamp(s->senderStamp);
+            writer.writeFrame(std::move(envelope), cluon::time::toMicroseconds(timing.sampleTimeStamp));
+            std::lock_guard<std::mutex> lck(framesMutex);
+            framesOut++;
+        }, false /*dropWhenBehind*/));
+        return true;
+    };
+
+    while (player.hasMoreData()) {
+        auto next = player.getNextEnvelopeToBeReplayed();
+        if (!next.first) {
+            break;
+        }
+        cluon::data::Envelope envelope{std::move(next.second)};
+        if (opendlv::proxy::ImageReading::ID() != envelope.dataType()) {
+            writer.hold(std::move(envelope));
+            continue;
+        }
+
+        Timing timing;
+        timing.sent = envelope.sent();
+        timing.received = envelope.received();
+        timing.sampleTimeStamp = envelope.sampleTimeStamp();
+        const uint32_t SENDER_STAMP{envelope.senderStamp()};
+        cluon::data::Envelope copy{envelope};
+        opendlv::proxy::ImageReading ir = cluon::extractMessage<opendlv::proxy::ImageReading>(std::move(copy));
+        std::string fourcc{ir.fourcc()};
+        std::transform(fourcc.begin(), fourcc.end(), fourcc.begin(), ::tolower);
+        const std::string FRAME{ir.data()};
+        if ((("i420" != fourcc) && ("yu12" != fourcc)) || (FRAME.size() < ir.width() * ir.height() * 3 / 2)) {
+            // Already encoded or other formats remain unchanged.
+            writer.hold(std::move(envelope));
+            continue;
+        }
+
+        std::unique_ptr<Stream> &entry{streams[SENDER_STAMP]};
+        if (!entry) {
+            entry.reset(new Stream());
+            entry->senderStamp = SENDER_STAMP;
+        }
+        Stream &stream{*entry};
+        if (!stream.encoder || (stream.width != ir.width()) || (stream.height != ir.height())) {
+            stream.width = ir.width();
+            stream.height = ir.height();
+            if (!setUp(stream)) {
+                std::cerr << "Failed to set up encoders for senderStamp " << SENDER_STAMP << " (" << stream.width << "x" << stream.height << ")." << std::endl;
+                return false;
+            }
+            std::clog << "Transcoding senderStamp " << SENDER_STAMP << " (" << stream.width << "x" << stream.height << ") with " << jobs << " encoders." << std::endl;
+        }
+
+        const uint32_t W{stream.width};
+        const uint32_t H{stream.height};
+        const uint8_t *y{reinterpret_cast<const uint8_t*>(FRAME.data())};
+        const uint8_t *planes[3]{y, y + (W * H), y + (W * H + ((W * H) >> 2))};
+        const uint32_t strides[3]{W, W / 2, W / 2};
+        {
+            std::lock_guard<std::mutex> lck(stream.timingsMutex);
+            stream.timings.push_back(timing);
+        }
+        writer.expect(cluon::time::toMicroseconds(timing.sampleTimeStamp));
+        stream.encoder->push(planes, strides, cluon::time::toMicroseconds(timing.sampleTimeStamp));
+        framesIn++;
+    }
+    for (auto &entry : streams) {
+        if (entry.second->encoder) {
+            entry.second->encoder->flush();
+            entry.second->encoder.reset();
+        }
+    }
+    writer.flush();
+
+    const double SECONDS{static_cast<double>(cluon::time::deltaInMicroseconds(cluon::time::now(), START)) / 1000000.0};
+    std::clog << "Transcoded " << framesIn << " frames (" << framesOut << " encoded) of " << streams.size() << " senderStamp(s) into '"
+              << output << "' (" << writer.bytes() << " bytes) in " << SECONDS << "s (" << (0.0 < SECONDS ? static_cast<double>(framesIn) / SECONDS : 0.0)
+              << " fps)." << std::endl;
+    return (0 < framesIn);
+}
@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BATCH_TRANSCODER_HPP
+#define BATCH_TRANSCODER_HPP
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+/**
+ * This function transcodes the I420 ImageReadings of a recording into h264
+ * ImageReadings in a new recording with the original timestamps and
+ * senderStamps; all other Envelopes are copied unchanged and in the order of
+ * the sample timestamps. Every senderStamp is encoded with several encoders
+ * working on consecutive closed GOPs; frames are never skipped.
+ *
+ * @param input Recording with I420 ImageReadings.
+ * @param output Recording to write.
+ * @param arguments Encoder arguments as accepted by the microservice (--gop, --bitrate, ...).
+ * @param jobs Number of parallel encoders per senderStamp.
+ * @return true if at least one frame was transcoded.
+ */
+bool transcodeRecording(const std::string &input, const std::string &output, std::map<std::string, std::string> &arguments, uint32_t jobs) noexcept;
+
+#endif
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "benchmark.hpp"
+#include "encoder-parameters.hpp"
+#include "i420-clip.hpp"
+#include "stream-encoder.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+int32_t runBudgetSuite(const std::string &program, std::map<std::string, std::string> &commandlineArguments) {
+    const uint32_t WIDTH{(commandlineArguments["width"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["width"])) : 640};
+    const uint32_t HEIGHT{(commandlineArguments["height"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["height"])) : 480};
+    const uint32_t FRAMES{(commandlineArguments["frames"].size() != 0) ? std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["frames"])), 16u) : 60};
+    const uint32_t GOP{(commandlineArguments["gop"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["gop"])) : 0};
+    const uint32_t INTRA_AT{FRAMES / 2};
+    const uint32_t WINDOW{10};
+
+    I420Clip clip;
+    clip.generate(WIDTH, HEIGHT, FRAMES);
+    const std::string ARGUMENTS{"--gop=" + std::to_string(GOP) + " --frame-skip=0 " + commandlineArguments["encoder-args"]};
+
+    // Both passes encode an IDR frame in the middle of the clip, which
+    // exceeds a budget of twice the largest P frame.
+    auto encodeClip = [&](StreamEncoder &encoder, std::vector<uint32_t> &sizes, std::vector<int32_t> &frameTypes, const std::function<bool(uint32_t, const AccessUnit &)> &check) {
+        for (uint32_t frame{0}; frame < FRAMES; frame++) {
+            if (INTRA_AT == frame) {
+                encoder.forceIntraFrame();
+            }
+            const uint8_t *y{clip.frame(frame)};
+            const uint8_t *planes[3]{y, y + (WIDTH * HEIGHT), y + (WIDTH * HEIGHT + ((WIDTH * HEIGHT) >> 2))};
+            const uint32_t strides[3]{WIDTH, WIDTH / 2, WIDTH / 2};
+            AccessUnit accessUnit;
+            if (!encoder.encode(planes, strides, accessUnit) || !check(frame, accessUnit)) {
+                return false;
+            }
+            sizes.push_back(accessUnit.size);
+            frameTypes.push_back(accessUnit.frameType);
+        }
+        return true;
+    };
+
+    StreamEncoder reference{WIDTH, HEIGHT, getCommandlineArgumentsFromString(ARGUMENTS)};
+    if (!reference.valid()) {
+        std::cerr << program << ": Failed to set up " << reference.backend() << " encoder." << std::endl;
+        return 1;
+    }
+    const std::string REGULAR_CONFIGURATION{reference.configuration()};
+    std::vector<uint32_t> referenceSizes;
+    std::vector<int32_t> referenceFrameTypes;
+    encodeClip(reference, referenceSizes, referenceFrameTypes, [](uint32_t, const AccessUnit &) { return true; });
+    uint32_t largestP{0};
+    for (uint32_t frame{0}; frame < referenceSizes.size(); frame++) {
+        largestP = (videoFrameTypeIDR != referenceFrameTypes[frame]) ? std::max(largestP, referenceSizes[frame]) : largestP;
+    }
+    const uint32_t BUDGET{(commandlineArguments["budget"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["budget"])) : 2 * largestP};
+    if ((referenceSizes.size() != FRAMES) || (referenceSizes[INTRA_AT] <= BUDGET)) {
+        std::cerr << program << ": The IDR frame of " << referenceSizes[INTRA_AT] << " bytes does not exceed the budget of " << BUDGET << " bytes." << std::endl;
+        return 1;
+    }
+
+    // After every re-encoded frame, the encoder must return to its regular
+    // QP range and frame sizes; the QP range is part of the configuration.
+    StreamEncoder encoder{WIDTH, HEIGHT, getCommandlineArgumentsFromString(ARGUMENTS + " --frame-budget=" + std::to_string(BUDGET))};
+    uint32_t failures{0};
+    bool reencoded{false};
+    std::vector<uint32_t> sizes;
+    std::vector<int32_t> frameTypes;
+    encodeClip(encoder, sizes, frameTypes, [&](uint32_t frame, const AccessUnit &accessUnit) {
+        if (accessUnit.size > BUDGET) {
+            std::cerr << program << ": Frame " << frame << " of " << accessUnit.size << " bytes exceeds the budget of " << BUDGET << " bytes." << std::endl;
+            failures++;
+        }
+        if (reencoded && (0 != encoder.configuration().compare(0, REGULAR_CONFIGURATION.size(), REGULAR_CONFIGURATION))) {
+            std::cerr << program << ": Frame " << frame << " after a re-encoded frame is encoded with '" << encoder.configuration() << "' instead of '" << REGULAR_CONFIGURATION << "'." << std::endl;
+            failures++;
+        }
+        reencoded = (0 < accessUnit.reencodings);
+        return true;
+    });
+
+    uint64_t referenceBytes{0};
+    uint64_t bytes{0};
+    for (uint32_t frame{INTRA_AT + 2}; frame < std::min(INTRA_AT + 2 + WINDOW, static_cast<uint32_t>(sizes.size())); frame++) {
+        referenceBytes += referenceSizes[frame];
+        bytes += sizes[frame];
+    }
+    const double RATIO{(0 < referenceBytes) ? static_cast<double>(bytes) / static_cast<double>(referenceBytes) : 0.0};
+    if (0.5 > RATIO) {
+        std::cerr << program << ": The frames after the re-encoded IDR frame have " << std::fixed << std::setprecision(2) << RATIO << " times the size of the frames without budget." << std::endl;
+        failures++;
+    }
+
+    const StreamEncoder::FrameBudgetStatistics STATISTICS{encoder.frameBudgetStatistics()};
+    std::cout << program << ": " << clip.name() << " (" << WIDTH << "x" << HEIGHT << ", " << FRAMES << " frames, GOP " << GOP << ") with a budget of " << BUDGET << " bytes: "
+              << STATISTICS.exceeded << " frame(s) exceeded it, " << STATISTICS.reencodings << " re-encoding(s) added " << STATISTICS.maxAddedTime << " microseconds at most, "
+              << STATISTICS.skipped << " frame(s) skipped; the following frames have " << std::fixed << std::setprecision(2) << RATIO << " times the size without budget; "
+              << failures << " failure(s)." << std::endl;
+    return (0 == failures) ? 0 : 1;
+}
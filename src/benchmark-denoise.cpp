@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "cluon-complete.hpp"
+#include "benchmark.hpp"
+#include "encoder-parameters.hpp"
+#include "i420-clip.hpp"
+#include "quality-metrics.hpp"
+#include "stream-encoder.hpp"
+#include "temporal-denoiser.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+namespace {
+
+/**
+ * Adds deterministic, approximately Gaussian noise (sum of four uniform
+ * samples) to every sample of the frame; the chroma planes get half of it.
+ */
+void addNoise(uint8_t *frame, uint32_t width, uint32_t height, double sigma, uint32_t &seed) noexcept {
+    const uint32_t LUMA{width * height};
+    const uint32_t SIZE{LUMA * 3 / 2};
+    // The sum of four uniform samples in [-0.5, 0.5) has a variance of 1/3.
+    const double SCALE{sigma * 1.7320508 / 4294967296.0};
+    for (uint32_t i{0}; i < SIZE; i++) {
+        double sum{-2.0 * 4294967296.0};
+        for (uint32_t k{0}; k < 4; k++) {
+            seed = seed * 1664525u + 1013904223u;
+            sum += static_cast<double>(seed);
+        }
+        const double NOISE{(i < LUMA) ? sum * SCALE : sum * SCALE * 0.5};
+        const int32_t v{static_cast<int32_t>(frame[i]) + static_cast<int32_t>(NOISE + ((0.0 > NOISE) ? -0.5 : 0.5))};
+        frame[i] = static_cast<uint8_t>(std::min(std::max(v, 0), 255));
+    }
+}
+
+struct Result {
+    uint64_t bytes{0};
+    uint64_t encodingTime{0};
+    uint64_t filterTime{0};
+    uint64_t sumOfSquaredErrors{0};
+    uint32_t frames{0};
+};
+
+} // namespace
+
+int32_t runDenoiseSuite(const std::string &program, std::map<std::string, std::string> &commandlineArguments) {
+    const uint32_t FRAMES{(commandlineArguments["frames"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["frames"])) : 120};
+    const double FPS{(commandlineArguments["fps"].size() != 0) ? std::stod(commandlineArguments["fps"]) : 30.0};
+    const uint32_t QP{(commandlineArguments["qp"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["qp"])) : 28};
+    const uint32_t THRESHOLD{(commandlineArguments["threshold"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["threshold"])) : 24};
+
+    I420Clip clip;
+    if (commandlineArguments["rec"].size() != 0) {
+        if (!clip.loadRecording(commandlineArguments["rec"], FRAMES)) {
+            std::cerr << program << ": No I420 frames found in '" << commandlineArguments["rec"] << "'." << std::endl;
+            return 1;
+        }
+    }
+    else {
+        const uint32_t WIDTH{(commandlineArguments["width"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["width"])) : 1280};
+        const uint32_t HEIGHT{(commandlineArguments["height"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["height"])) : 720};
+        clip.generate(WIDTH, HEIGHT, FRAMES);
+    }
+    // Recordings from low light carry their own noise.
+    const double NOISE{(commandlineArguments["noise"].size() != 0) ? std::stod(commandlineArguments["noise"]) : ((commandlineArguments["rec"].size() != 0) ? 0.0 : 8.0)};
+    const uint32_t WIDTH{clip.width()};
+    const uint32_t HEIGHT{clip.height()};
+
+    // Pinning the QP lets the bitrate reflect the content instead of the rate control.
+    const std::map<std::string, std::string> ARGUMENTS{getCommandlineArgumentsFromString(
+        "--rc-mode=0 --frame-skip=0 --bitrate=5000000 --qp-min=" + std::to_string(QP) + " --qp-max=" + std::to_string(QP) + " " + commandlineArguments["encoder-args"])};
+
+    const char *MODES[2]{"off", "on"};
+    Result results[2];
+    std::string implementation;
+    std::vector<uint8_t> noisy(clip.frameSize());
+    for (uint32_t mode{0}; mode < 2; mode++) {
+        StreamEncoder encoder{WIDTH, HEIGHT, ARGUMENTS};
+        if (!encoder.valid()) {
+            std::cerr << program << ": Failed to set up " << encoder.backend() << " encoder." << std::endl;
+            return 1;
+        }
+        std::unique_ptr<TemporalDenoiser> denoiser{(1 == mode) ? new TemporalDenoiser(WIDTH, HEIGHT, THRESHOLD) : nullptr};
+        if (denoiser) {
+            implementation = denoiser->implementation();
+        }
+
+        // Both modes see the same noise.
+        uint32_t seed{1};
+        Result &result{results[mode]};
+        for (uint32_t frame{0}; frame < clip.frames(); frame++) {
+            const uint8_t *clean{clip.frame(frame)};
+            std::copy(clean, clean + clip.frameSize(), noisy.begin());
+            addNoise(noisy.data(), WIDTH, HEIGHT, NOISE, seed);
+
+            const uint8_t *data{noisy.data()};
+            const uint32_t strides[3]{WIDTH, WIDTH / 2, WIDTH / 2};
+            if (denoiser) {
+                const uint8_t *input[3]{data, data + (WIDTH * HEIGHT), data + (WIDTH * HEIGHT + ((WIDTH * HEIGHT) >> 2))};
+                const int64_t BEFORE{steadyMicroseconds()};
+                data = denoiser->filter(input, strides);
+                result.filterTime += static_cast<uint64_t>(steadyMicroseconds() - BEFORE);
+            }
+            result.sumOfSquaredErrors += sumOfSquaredErrors(clean, WIDTH, data, WIDTH, WIDTH, HEIGHT);
+
+            const uint8_t *planes[3]{data, data + (WIDTH * HEIGHT), data + (WIDTH * HEIGHT + ((WIDTH * HEIGHT) >> 2))};
+            AccessUnit accessUnit;
+            const int64_t BEFORE{steadyMicroseconds()};
+            if (!encoder.encode(planes, strides, accessUnit)) {
+                std::cerr << program << ": Failed to encode frame " << frame << "." << std::endl;
+                return 1;
+            }
+            result.encodingTime += static_cast<uint64_t>(steadyMicroseconds() - BEFORE);
+            result.bytes += accessUnit.size;
+            result.frames++;
+        }
+    }
+
+    std::cout << program << ": " << clip.name() << " (" << WIDTH << "x" << HEIGHT << ", " << results[0].frames << " frames) with added noise of sigma = " << NOISE
+              << ", constant QP " << QP << ", threshold " << THRESHOLD << " (" << implementation << ")." << std::endl;
+    std::cout << std::left << std::setw(8) << "denoise" << std::right << std::setw(12) << "kbit/s" << std::setw(14) << "encode [ms]" << std::setw(14) << "filter [ms]"
+              << std::setw(20) << "input PSNR Y [dB]" << std::endl;
+    for (uint32_t mode{0}; mode < 2; mode++) {
+        const Result &r{results[mode]};
+        const double FRAMES_ENCODED{static_cast<double>(std::max(r.frames, 1u))};
+        std::cout << std::left << std::setw(8) << MODES[mode] << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(12) << static_cast<double>(r.bytes) * 8.0 * FPS / FRAMES_ENCODED / 1000.0
+                  << std::setw(14) << static_cast<double>(r.encodingTime) / FRAMES_ENCODED / 1000.0
+                  << std::setw(14) << static_cast<double>(r.filterTime) / FRAMES_ENCODED / 1000.0
+                  << std::setw(20) << psnrFromSumOfSquaredErrors(r.sumOfSquaredErrors, static_cast<uint64_t>(r.frames) * WIDTH * HEIGHT) << std::endl;
+    }
+    const double SAVED{(0 < results[0].bytes) ? 100.0 * (1.0 - static_cast<double>(results[1].bytes) / static_cast<double>(results[0].bytes)) : 0.0};
+    const double FILTER_SHARE{(0 < results[0].encodingTime) ? 100.0 * static_cast<double>(results[1].filterTime) / static_cast<double>(results[0].encodingTime) : 0.0};
+    std::cout << "bitrate saved: " << std::setprecision(1) << SAVED << "% for " << std::setprecision(2)
+              << static_cast<double>(results[1].filterTime) / std::max(results[1].frames, 1u) / 1000.0 << " ms of filtering per frame ("
+              << std::setprecision(1) << FILTER_SHARE << "% of the encoding time without denoising)." << std::endl;
+    return 0;
+}
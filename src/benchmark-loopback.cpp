@@ -0,0 +1,324 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cluon-complete.hpp"
+#include "opendlv-standard-message-set.hpp"
+#include "benchmark.hpp"
+#include "encoder-parameters.hpp"
+#include "h264-decoder.hpp"
+#include "i420-clip.hpp"
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Packet {
+    int64_t sampleTime{0};
+    uint32_t senderStamp{0};
+    std::string fourcc{};
+    uint32_t width{0};
+    uint32_t height{0};
+    std::string data{};
+};
+
+/**
+ * Emulates an impaired transport between the encoder and a receiver: each
+ * packet is dropped, duplicated, or held back behind its successor with the
+ * given probabilities.
+ */
+class Impairment {
+   private:
+    Impairment(const Impairment &) = delete;
+    Impairment(Impairment &&)      = delete;
+    Impairment &operator=(const Impairment &) = delete;
+    Impairment &operator=(Impairment &&) = delete;
+
+   public:
+    Impairment(double loss, double reorder, double duplicate, uint32_t seed) noexcept
+        : m_loss{loss}
+        , m_reorder{reorder}
+        , m_duplicate{duplicate}
+        , m_generator{seed} {}
+
+   public:
+    void pass(const Packet &packet, std::vector<Packet> &out) noexcept {
+        if (m_distribution(m_generator) < m_loss) {
+            lost++;
+            return;
+        }
+        const bool HOLD_BACK{m_distribution(m_generator) < m_reorder};
+        const bool DUPLICATE{m_distribution(m_generator) < m_duplicate};
+        if (HOLD_BACK && !m_heldBack) {
+            m_heldBack.reset(new Packet(packet));
+            reordered++;
+        }
+        else {
+            out.push_back(packet);
+            flush(out);
+        }
+        if (DUPLICATE) {
+            out.push_back(packet);
+            duplicated++;
+        }
+    }
+
+    void flush(std::vector<Packet> &out) noexcept {
+        if (m_heldBack) {
+            out.push_back(*m_heldBack);
+            m_heldBack.reset();
+        }
+    }
+
+   public:
+    uint32_t lost{0};
+    uint32_t reordered{0};
+    uint32_t duplicated{0};
+
+   private:
+    const double m_loss;
+    const double m_reorder;
+    const double m_duplicate;
+    std::mt19937 m_generator;
+    std::uniform_real_distribution<double> m_distribution{0.0, 1.0};
+    std::unique_ptr<Packet> m_heldBack{};
+};
+
+bool isIDR(const std::string &accessUnit) noexcept {
+    for (std::size_t i{0}; i + 3 < accessUnit.size(); i++) {
+        if ((0 == accessUnit[i]) && (0 == accessUnit[i + 1]) && (1 == accessUnit[i + 2]) && (5 == (accessUnit[i + 3] & 0x1f))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+int32_t runLoopbackSuite(const std::string &program, std::map<std::string, std::string> &commandlineArguments) {
+    const std::string ENCODER{(commandlineArguments["encoder"].size() != 0) ? commandlineArguments["encoder"] : "opendlv-video-h264-encoder"};
+    const std::string ENCODER_ARGUMENTS{(commandlineArguments["encoder-args"].size() != 0) ? commandlineArguments["encoder-args"] : "--gop=10 --frame-skip=0"};
+    const uint16_t CID{(commandlineArguments["cid"].size() != 0) ? static_cast<uint16_t>(std::stoi(commandlineArguments["cid"])) : static_cast<uint16_t>(253)};
+    const uint32_t ID{(commandlineArguments["id"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["id"])) : 0};
+    const uint32_t WIDTH{(commandlineArguments["width"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["width"])) : 640};
+    const uint32_t HEIGHT{(commandlineArguments["height"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["height"])) : 480};
+    const uint32_t FRAMES{(commandlineArguments["frames"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["frames"])) : 100};
+    const float FPS{(commandlineArguments["fps"].size() != 0) ? std::stof(commandlineArguments["fps"]) : 20.0f};
+    const double LOSS{(commandlineArguments["loss"].size() != 0) ? std::stod(commandlineArguments["loss"]) / 100.0 : 0.0};
+    const double REORDER{(commandlineArguments["reorder"].size() != 0) ? std::stod(commandlineArguments["reorder"]) / 100.0 : 0.0};
+    const double DUPLICATE{(commandlineArguments["duplicate"].size() != 0) ? std::stod(commandlineArguments["duplicate"]) / 100.0 : 0.0};
+    const uint32_t SEED{(commandlineArguments["seed"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["seed"])) : 1};
+    const double MAX_MISSING{(commandlineArguments["max-missing"].size() != 0) ? std::stod(commandlineArguments["max-missing"]) : 0.0};
+    const uint32_t TIMEOUT{(commandlineArguments["timeout"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["timeout"])) : 10};
+    const uint32_t SIZE{WIDTH * HEIGHT * 3 / 2};
+    const int64_t FRAME_INTERVAL{static_cast<int64_t>(1000000.0f / FPS)};
+
+    std::stringstream name;
+    name << "benchmark-loopback-" << getpid();
+    cluon::SharedMemory producer{name.str(), SIZE};
+    if (!producer.valid()) {
+        std::cerr << program << ": Failed to create shared memory '" << name.str() << "'." << std::endl;
+        return 1;
+    }
+
+    // Capture the published envelopes; the impairment layer sits between the
+    // transport and the receiver.
+    std::mutex receivedMutex;
+    std::vector<Packet> sent;
+    std::vector<Packet> received;
+    std::vector<Packet> published;
+    std::vector<Packet> delivered;
+    Impairment impairment{LOSS, REORDER, DUPLICATE, SEED};
+    cluon::OD4Session od4{CID};
+    od4.dataTrigger(opendlv::proxy::ImageReading::ID(), [&](cluon::data::Envelope &&envelope) {
+        Packet packet;
+        packet.sampleTime = cluon::time::toMicroseconds(envelope.sampleTimeStamp());
+        packet.senderStamp = envelope.senderStamp();
+        opendlv::proxy::ImageReading ir = cluon::extractMessage<opendlv::proxy::ImageReading>(std::move(envelope));
+        packet.fourcc = ir.fourcc();
+        packet.width = ir.width();
+        packet.height = ir.height();
+        packet.data = ir.data();
+        std::lock_guard<std::mutex> lck(receivedMutex);
+        sent.push_back(packet);
+        impairment.pass(packet, received);
+    });
+
+    std::vector<std::string> arguments{"--cid=" + std::to_string(CID), "--name=" + name.str(), "--width=" + std::to_string(WIDTH),
+                                       "--height=" + std::to_string(HEIGHT), "--id=" + std::to_string(ID)};
+    for (auto argument : splitString(ENCODER_ARGUMENTS, ' ')) {
+        arguments.push_back(argument);
+    }
+    const pid_t PID{startEncoder(ENCODER, arguments)};
+    if (0 > PID) {
+        std::cerr << program << ": Failed to fork: " << strerror(errno) << std::endl;
+        return 1;
+    }
+
+    I420Clip clip;
+    clip.generate(WIDTH, HEIGHT, 2 * static_cast<uint32_t>(FPS));
+    auto publish = [&](uint32_t frame) {
+        const cluon::data::TimeStamp NOW{cluon::time::now()};
+        producer.lock();
+        memcpy(producer.data(), clip.frame(frame % clip.frames()), SIZE);
+        producer.setTimeStamp(NOW);
+        producer.unlock();
+        producer.notifyAll();
+        return cluon::time::toMicroseconds(NOW);
+    };
+
+    // Warm up until the encoder has attached and its first frame arrived.
+    int32_t retCode{0};
+    int64_t firstMeasured{0};
+    {
+        const auto DEADLINE{std::chrono::steady_clock::now() + std::chrono::seconds(TIMEOUT)};
+        bool ready{false};
+        for (uint32_t frame{0}; !ready && (std::chrono::steady_clock::now() < DEADLINE); frame++) {
+            publish(frame);
+            std::this_thread::sleep_for(std::chrono::microseconds(FRAME_INTERVAL));
+            std::lock_guard<std::mutex> lck(receivedMutex);
+            ready = !sent.empty();
+        }
+        if (!ready || (0 != waitpid(PID, nullptr, WNOHANG))) {
+            std::cerr << program << ": No frames received from '" << ENCODER << "' within " << TIMEOUT << "s." << std::endl;
+            stopEncoder(PID);
+            return 1;
+        }
+    }
+
+    std::set<int64_t> produced;
+    {
+        const auto START{std::chrono::steady_clock::now()};
+        for (uint32_t frame{0}; frame < FRAMES; frame++) {
+            std::this_thread::sleep_until(START + std::chrono::microseconds(frame * FRAME_INTERVAL));
+            produced.insert(publish(frame));
+        }
+        firstMeasured = *produced.begin();
+        std::this_thread::sleep_for(std::chrono::microseconds(5 * FRAME_INTERVAL));
+    }
+    const bool ENCODER_ALIVE{0 == waitpid(PID, nullptr, WNOHANG)};
+
+    uint32_t lost{0};
+    uint32_t reordered{0};
+    uint32_t duplicated{0};
+    // Take the captured envelopes before stopping the encoder so that
+    // nothing published during its shutdown is evaluated.
+    {
+        std::lock_guard<std::mutex> lck(receivedMutex);
+        impairment.flush(received);
+        sent.swap(published);
+        received.swap(delivered);
+        lost = impairment.lost;
+        reordered = impairment.reordered;
+        duplicated = impairment.duplicated;
+    }
+    const double CPU{stopEncoder(PID)};
+    if (!ENCODER_ALIVE) {
+        std::cerr << program << ": '" << ENCODER << "' terminated during the test." << std::endl;
+        return 1;
+    }
+
+    // Verify the stream as published: metadata and monotonic timestamps that
+    // match the frames that were produced.
+    uint32_t encoded{0};
+    int64_t previous{0};
+    for (auto &packet : published) {
+        if (("h264" != packet.fourcc) || (WIDTH != packet.width) || (HEIGHT != packet.height) || (ID != packet.senderStamp)) {
+            std::cerr << program << ": Unexpected ImageReading " << packet.fourcc << " " << packet.width << "x" << packet.height << " from " << packet.senderStamp << "." << std::endl;
+            retCode = 1;
+        }
+        if (packet.sampleTime <= previous) {
+            std::cerr << program << ": Sample time " << packet.sampleTime << " is not after " << previous << "." << std::endl;
+            retCode = 1;
+        }
+        previous = packet.sampleTime;
+        if (packet.sampleTime >= firstMeasured) {
+            if (0 == produced.count(packet.sampleTime)) {
+                std::cerr << program << ": Sample time " << packet.sampleTime << " does not belong to a produced frame." << std::endl;
+                retCode = 1;
+            }
+            encoded++;
+        }
+    }
+    const double MISSING{100.0 * static_cast<double>(FRAMES - std::min(encoded, FRAMES)) / static_cast<double>(FRAMES)};
+    if (MISSING > MAX_MISSING) {
+        std::cerr << program << ": " << encoded << " of " << FRAMES << " frames were published (" << MISSING << "% missing)." << std::endl;
+        retCode = 1;
+    }
+
+    // Receiver: the frames are decoded in the order of their arrival like by
+    // a receiver without jitter buffer; frames are expected to be decodable
+    // unless a predecessor since the last IDR frame was lost, late, or
+    // duplicated.
+    std::map<int64_t, size_t> positions;
+    for (size_t i{0}; i < published.size(); i++) {
+        positions[published[i].sampleTime] = i;
+    }
+
+    H264Decoder decoder;
+    if (!decoder.valid()) {
+        std::cerr << program << ": Failed to create openh264 decoder." << std::endl;
+        return 1;
+    }
+    uint32_t decoded{0};
+    uint32_t concealed{0};
+    bool intact{true};
+    size_t next{0};
+    for (auto &packet : delivered) {
+        const size_t POSITION{positions[packet.sampleTime]};
+        intact = (intact && (next == POSITION)) || isIDR(packet.data);
+        next = POSITION + 1;
+        DecodedPicture picture;
+        const bool OK{decoder.decode(reinterpret_cast<const uint8_t*>(packet.data.data()), static_cast<uint32_t>(packet.data.size()), picture)};
+        if (OK && ((WIDTH != picture.width) || (HEIGHT != picture.height))) {
+            std::cerr << program << ": Decoded " << picture.width << "x" << picture.height << " instead of " << WIDTH << "x" << HEIGHT << "." << std::endl;
+            retCode = 1;
+        }
+        if (OK) {
+            decoded++;
+        }
+        else if (intact) {
+            std::cerr << program << ": Frame with sample time " << packet.sampleTime << " is not decodable." << std::endl;
+            retCode = 1;
+        }
+        else {
+            concealed++;
+        }
+    }
+
+    std::cout << program << ": " << FRAMES << " frames produced, " << encoded << " published, " << lost << " lost, "
+              << reordered << " reordered, " << duplicated << " duplicated, " << decoded << " decoded, "
+              << concealed << " undecodable after loss." << std::endl;
+    std::cout << program << ": encoder used " << std::fixed << std::setprecision(3) << (1000.0 * CPU / static_cast<double>(std::max<std::size_t>(1, published.size())))
+              << " ms CPU per published frame." << std::endl;
+    std::cout << program << ": " << ((0 == retCode) ? "PASSED" : "FAILED") << std::endl;
+    return retCode;
+}
@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "benchmark.hpp"
+#include "encoder-parameters.hpp"
+#include "gop-parallel-encoder.hpp"
+#include "h264-decoder.hpp"
+#include "i420-clip.hpp"
+#include "stream-encoder.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+int32_t runParallelSuite(const std::string &program, std::map<std::string, std::string> &commandlineArguments) {
+    const uint32_t WIDTH{(commandlineArguments["width"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["width"])) : 640};
+    const uint32_t HEIGHT{(commandlineArguments["height"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["height"])) : 480};
+    const uint32_t GOP{(commandlineArguments["gop"].size() != 0) ? std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["gop"])), 2u) : 10};
+    const uint32_t INSTANCES{(commandlineArguments["instances"].size() != 0) ? std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["instances"])), 2u) : 2};
+
+    std::map<std::string, std::string> arguments{getCommandlineArgumentsFromString("--gop=" + std::to_string(GOP) + " --frame-skip=0 " + commandlineArguments["encoder-args"])};
+    std::vector<std::unique_ptr<StreamEncoder>> encoders;
+    for (uint32_t i{0}; i < INSTANCES; i++) {
+        encoders.push_back(std::unique_ptr<StreamEncoder>(new StreamEncoder(WIDTH, HEIGHT, arguments)));
+    }
+
+    // The delivery of the first frame stalls the encoding threads: the thread
+    // delivering it waits here and the others wait for the delivery.
+    std::mutex stallMutex;
+    std::condition_variable stallChanged;
+    bool stalled{false};
+    bool released{false};
+    std::vector<EncodedFrame> delivered;
+    GopParallelEncoder encoder{std::move(encoders), GOP, [&](EncodedFrame &&frame) {
+        std::unique_lock<std::mutex> lck(stallMutex);
+        if (!released) {
+            stalled = true;
+            stallChanged.notify_all();
+            stallChanged.wait(lck, [&released]() { return released; });
+        }
+        delivered.push_back(std::move(frame));
+    }};
+    if (!encoder.valid()) {
+        std::cerr << program << ": Failed to set up " << INSTANCES << " encoders." << std::endl;
+        return 1;
+    }
+
+    I420Clip clip;
+    clip.generate(WIDTH, HEIGHT, GOP * 2);
+    const uint32_t strides[3]{WIDTH, WIDTH / 2, WIDTH / 2};
+    uint32_t number{0};
+    auto push = [&]() {
+        const uint8_t *y{clip.frame(number % clip.frames())};
+        const uint8_t *planes[3]{y, y + (WIDTH * HEIGHT), y + (WIDTH * HEIGHT + ((WIDTH * HEIGHT) >> 2))};
+        return encoder.push(planes, strides, static_cast<int64_t>(number++) * 50000);
+    };
+
+    push();
+    {
+        std::unique_lock<std::mutex> lck(stallMutex);
+        stallChanged.wait(lck, [&stalled]() { return stalled; });
+    }
+    // The queues of the stalled instances fill up until the first frame of
+    // a GOP is dropped; the rest of that GOP is pushed after the stall.
+    int64_t droppedIdr{-1};
+    while ((0 > droppedIdr) && (number < GOP * INSTANCES * 4)) {
+        const uint32_t NUMBER{number};
+        if (!push() && (0 == NUMBER % GOP)) {
+            droppedIdr = NUMBER;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lck(stallMutex);
+        released = true;
+    }
+    stallChanged.notify_all();
+    encoder.flush();
+    if (0 > droppedIdr) {
+        std::cerr << program << ": No IDR frame was dropped while the encoders were stalled." << std::endl;
+        return 1;
+    }
+    while (number < droppedIdr + GOP * (INSTANCES + 1)) {
+        push();
+        encoder.flush();
+    }
+
+    // Every GOP must start with an IDR frame at its first published frame
+    // and the stream must decode without errors.
+    uint32_t failures{0};
+    uint32_t published{0};
+    std::set<uint64_t> startedGops;
+    H264Decoder decoder;
+    for (auto &frame : delivered) {
+        if (frame.data.empty()) {
+            continue;
+        }
+        published++;
+        if (startedGops.insert(frame.number / GOP).second && (videoFrameTypeIDR != frame.frameType)) {
+            std::cerr << program << ": Frame " << frame.number << " starts the published part of its GOP but is no IDR frame." << std::endl;
+            failures++;
+        }
+        DecodedPicture picture;
+        if (!decoder.decode(reinterpret_cast<const uint8_t*>(frame.data.data()), static_cast<uint32_t>(frame.data.size()), picture)) {
+            std::cerr << program << ": Frame " << frame.number << " failed to decode." << std::endl;
+            failures++;
+        }
+    }
+    std::cout << "Stalled " << INSTANCES << " encoders until IDR frame " << droppedIdr << " was dropped; published " << published << " of " << number << " frames, "
+              << failures << " failure(s)." << std::endl;
+    return (0 == failures) ? 0 : 1;
+}
@@ -0,0 +1,199 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cluon-complete.hpp"
+#include "benchmark.hpp"
+#include "encoder-parameters.hpp"
+#include "i420-clip.hpp"
+#include "rate-distortion.hpp"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct Preset {
+    std::string name;
+    std::string arguments;
+};
+
+std::vector<Preset> loadPresets(const std::string &filename) {
+    std::vector<Preset> presets;
+    if (filename.empty()) {
+        presets.push_back(Preset{"default", ""});
+        presets.push_back(Preset{"fast", "--ecomplexity=0 --num-ref-frame=1 --adaptive-quant=0 --background-detection=0 --scene-change-detect=0"});
+        presets.push_back(Preset{"quality", "--ecomplexity=2 --num-ref-frame=4"});
+#ifdef HAVE_X264
+        presets.push_back(Preset{"x264", "--backend=x264"});
+        presets.push_back(Preset{"x264-fast", "--backend=x264 --x264-preset=ultrafast"});
+#endif
+        return presets;
+    }
+
+    for (auto &namedArguments : loadNamedArguments(filename)) {
+        presets.push_back(Preset{namedArguments.first, namedArguments.second});
+    }
+    return presets;
+}
+
+bool parseGeometry(const std::string &geometry, uint32_t &width, uint32_t &height) {
+    auto dimensions = splitString(geometry, 'x');
+    if (2 != dimensions.size()) {
+        return false;
+    }
+    width = static_cast<uint32_t>(std::stoi(dimensions[0]));
+    height = static_cast<uint32_t>(std::stoi(dimensions[1]));
+    return (0 < width) && (0 < height);
+}
+
+std::string keyOf(const std::string &clip, const std::string &preset) {
+    return clip + "|" + preset;
+}
+
+} // namespace
+
+int32_t runRateDistortionSuite(const std::string &program, std::map<std::string, std::string> &commandlineArguments) {
+    const uint32_t FRAMES{(commandlineArguments["frames"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["frames"])) : 60};
+    const float FPS{(commandlineArguments["fps"].size() != 0) ? std::stof(commandlineArguments["fps"]) : 30.0f};
+    const double MAX_BITRATE_INCREASE{(commandlineArguments["max-bitrate-increase"].size() != 0) ? std::stod(commandlineArguments["max-bitrate-increase"]) : 5.0};
+    const double MAX_PSNR_DROP{(commandlineArguments["max-psnr-drop"].size() != 0) ? std::stod(commandlineArguments["max-psnr-drop"]) : 0.25};
+    const double MAX_SSIM_DROP{(commandlineArguments["max-ssim-drop"].size() != 0) ? std::stod(commandlineArguments["max-ssim-drop"]) : 0.005};
+    const double MAX_FPS_DROP{(commandlineArguments["max-fps-drop"].size() != 0) ? std::stod(commandlineArguments["max-fps-drop"]) : 15.0};
+
+    std::vector<std::unique_ptr<I420Clip>> clips;
+    if (commandlineArguments["clips"].size() != 0) {
+        for (auto entry : splitString(commandlineArguments["clips"], ',')) {
+            auto fileAndGeometry = splitString(entry, '@');
+            uint32_t width{0};
+            uint32_t height{0};
+            std::unique_ptr<I420Clip> clip(new I420Clip());
+            if ((2 != fileAndGeometry.size()) || !parseGeometry(fileAndGeometry[1], width, height) || !clip->load(fileAndGeometry[0], width, height, FRAMES)) {
+                std::cerr << program << ": Failed to load clip '" << entry << "'." << std::endl;
+                return 1;
+            }
+            clips.push_back(std::move(clip));
+        }
+    }
+    else {
+        const std::string SYNTHETIC{(commandlineArguments["synthetic"].size() != 0) ? commandlineArguments["synthetic"] : "640x480,1280x720"};
+        for (auto geometry : splitString(SYNTHETIC, ',')) {
+            uint32_t width{0};
+            uint32_t height{0};
+            if (!parseGeometry(geometry, width, height)) {
+                std::cerr << program << ": Invalid geometry '" << geometry << "'." << std::endl;
+                return 1;
+            }
+            std::unique_ptr<I420Clip> clip(new I420Clip());
+            clip->generate(width, height, FRAMES);
+            clips.push_back(std::move(clip));
+        }
+    }
+
+    const std::vector<Preset> presets{loadPresets(commandlineArguments["presets"])};
+    if (presets.empty()) {
+        std::cerr << program << ": No presets found in '" << commandlineArguments["presets"] << "'." << std::endl;
+        return 1;
+    }
+
+    std::cout << std::left << std::setw(32) << "clip" << std::setw(12) << "preset" << std::right
+              << std::setw(8) << "frames" << std::setw(12) << "kbit/s" << std::setw(10) << "PSNR-Y" << std::setw(10) << "PSNR"
+              << std::setw(10) << "SSIM" << std::setw(10) << "enc fps" << std::setw(8) << "skips" << std::endl;
+
+    std::vector<std::pair<std::string, ClipResult>> results;
+    for (auto &clip : clips) {
+        for (auto &preset : presets) {
+            ClipResult result{evaluateClip(*clip, preset.arguments, FPS)};
+            if (!result.valid) {
+                std::cerr << program << ": Failed to evaluate '" << clip->name() << "' with preset '" << preset.name << "'." << std::endl;
+                return 1;
+            }
+            std::cout << std::left << std::setw(32) << clip->name() << std::setw(12) << preset.name << std::right << std::fixed
+                      << std::setw(8) << result.frames << std::setw(12) << std::setprecision(1) << result.bitrateKbps
+                      << std::setw(10) << std::setprecision(2) << result.psnrY << std::setw(10) << result.psnr
+                      << std::setw(10) << std::setprecision(4) << result.ssim << std::setw(10) << std::setprecision(1) << result.encodeFps
+                      << std::setw(8) << result.skippedFrames << std::endl;
+            results.push_back(std::make_pair(keyOf(clip->name(), preset.name), result));
+        }
+    }
+
+    if (commandlineArguments["save"].size() != 0) {
+        std::ofstream out(commandlineArguments["save"]);
+        out << "clip|preset,frames,bitrate_kbps,psnr_y,psnr,ssim,encode_fps" << std::endl;
+        for (auto &entry : results) {
+            out << entry.first << "," << entry.second.frames << "," << entry.second.bitrateKbps << "," << entry.second.psnrY << ","
+                << entry.second.psnr << "," << entry.second.ssim << "," << entry.second.encodeFps << std::endl;
+        }
+    }
+
+    int32_t regressions{0};
+    if (commandlineArguments["baseline"].size() != 0) {
+        std::map<std::string, ClipResult> baseline;
+        std::ifstream in(commandlineArguments["baseline"]);
+        if (!in.good()) {
+            std::cerr << program << ": Failed to open baseline '" << commandlineArguments["baseline"] << "'." << std::endl;
+            return 1;
+        }
+        std::string line;
+        std::getline(in, line); // Skip header.
+        while (std::getline(in, line)) {
+            auto fields = splitString(line, ',');
+            if (7 == fields.size()) {
+                ClipResult r;
+                r.frames = static_cast<uint32_t>(std::stoi(fields[1]));
+                r.bitrateKbps = std::stod(fields[2]);
+                r.psnrY = std::stod(fields[3]);
+                r.psnr = std::stod(fields[4]);
+                r.ssim = std::stod(fields[5]);
+                r.encodeFps = std::stod(fields[6]);
+                baseline[fields[0]] = r;
+            }
+        }
+
+        for (auto &entry : results) {
+            if (0 == baseline.count(entry.first)) {
+                std::clog << program << ": No baseline for '" << entry.first << "'." << std::endl;
+                continue;
+            }
+            const ClipResult &before{baseline[entry.first]};
+            const ClipResult &now{entry.second};
+            std::stringstream sstr;
+            if (now.bitrateKbps > before.bitrateKbps * (1.0 + MAX_BITRATE_INCREASE / 100.0)) {
+                sstr << " bitrate " << before.bitrateKbps << " -> " << now.bitrateKbps << " kbit/s;";
+            }
+            if (now.psnr < before.psnr - MAX_PSNR_DROP) {
+                sstr << " PSNR " << before.psnr << " -> " << now.psnr << " dB;";
+            }
+            if (now.ssim < before.ssim - MAX_SSIM_DROP) {
+                sstr << " SSIM " << before.ssim << " -> " << now.ssim << ";";
+            }
+            if (now.encodeFps < before.encodeFps * (1.0 - MAX_FPS_DROP / 100.0)) {
+                sstr << " encoding speed " << before.encodeFps << " -> " << now.encodeFps << " fps;";
+            }
+            if (!sstr.str().empty()) {
+                std::cerr << program << ": Regression for '" << entry.first << "':" << sstr.str() << std::endl;
+                regressions++;
+            }
+        }
+        std::clog << program << ": " << regressions << " regression(s) found." << std::endl;
+    }
+    return (0 == regressions) ? 0 : 1;
+}
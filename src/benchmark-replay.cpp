@@ -0,0 +1,218 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cluon-complete.hpp"
+#include "opendlv-standard-message-set.hpp"
+#include "benchmark.hpp"
+#include "encoder-parameters.hpp"
+#include "quality-metrics.hpp"
+#include "stream-encoder.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct FrameRecord {
+    uint32_t frame{0};
+    int64_t sampleTime{0};
+    uint32_t senderStamp{0};
+    int32_t frameType{0};
+    uint32_t bytes{0};
+    int64_t encodeTime{0};
+    double spatialActivity{0.0};
+    double temporalDifference{0.0};
+};
+
+double correlation(const std::vector<FrameRecord> &records, double FrameRecord::*metric) {
+    const double N{static_cast<double>(records.size())};
+    if (2.0 > N) {
+        return 0.0;
+    }
+    double sumX{0.0}, sumY{0.0}, sumXX{0.0}, sumYY{0.0}, sumXY{0.0};
+    for (auto &r : records) {
+        const double x{r.*metric};
+        const double y{static_cast<double>(r.encodeTime)};
+        sumX += x;
+        sumY += y;
+        sumXX += x * x;
+        sumYY += y * y;
+        sumXY += x * y;
+    }
+    const double denominator{std::sqrt((N * sumXX - sumX * sumX) * (N * sumYY - sumY * sumY))};
+    return (0.0 < denominator) ? (N * sumXY - sumX * sumY) / denominator : 0.0;
+}
+
+const char *frameTypeName(int32_t frameType) {
+    switch (frameType) {
+        case videoFrameTypeIDR: return "IDR";
+        case videoFrameTypeI: return "I";
+        case videoFrameTypeP: return "P";
+        case videoFrameTypeSkip: return "skip";
+        case videoFrameTypeIPMixed: return "IP";
+        default: return "?";
+    }
+}
+
+} // namespace
+
+int32_t runReplaySuite(const std::string &program, std::map<std::string, std::string> &commandlineArguments) {
+    const std::string REC{commandlineArguments["rec"]};
+    const bool REALTIME{commandlineArguments.count("realtime") != 0};
+    const bool FILTER_SENDER_STAMP{commandlineArguments["sender-stamp"].size() != 0};
+    const uint32_t SENDER_STAMP{FILTER_SENDER_STAMP ? static_cast<uint32_t>(std::stoi(commandlineArguments["sender-stamp"])) : 0};
+    const std::string NAME{commandlineArguments["name"]};
+    const std::string ENCODER_ARGUMENTS{commandlineArguments["encoder-args"]};
+    const uint32_t TOP{(commandlineArguments["top"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["top"])) : 10};
+
+    if (REC.empty()) {
+        std::cerr << program << ": --rec=<recording> is required for --suite=replay." << std::endl;
+        return 1;
+    }
+
+    // Single-threaded player to replay the recording deterministically.
+    cluon::Player player(REC, false /*autoRewind*/, false /*threading*/);
+    if (!player.hasMoreData()) {
+        std::cerr << program << ": Failed to read '" << REC << "'." << std::endl;
+        return 1;
+    }
+
+    std::unique_ptr<StreamEncoder> encoder;
+    uint32_t width{0};
+    uint32_t height{0};
+    std::vector<uint8_t> previousLuma;
+    std::unique_ptr<cluon::SharedMemory> sharedMemory;
+
+    std::vector<FrameRecord> records;
+    while (player.hasMoreData()) {
+        auto next = player.getNextEnvelopeToBeReplayed();
+        if (!next.first) {
+            break;
+        }
+        cluon::data::Envelope envelope{std::move(next.second)};
+        if (REALTIME) {
+            std::this_thread::sleep_for(std::chrono::duration<int32_t, std::micro>(player.delay()));
+        }
+        if ((opendlv::proxy::ImageReading::ID() != envelope.dataType()) || (FILTER_SENDER_STAMP && (SENDER_STAMP != envelope.senderStamp()))) {
+            continue;
+        }
+        const cluon::data::TimeStamp sampleTimeStamp{envelope.sampleTimeStamp()};
+        const uint32_t senderStamp{envelope.senderStamp()};
+        opendlv::proxy::ImageReading ir = cluon::extractMessage<opendlv::proxy::ImageReading>(std::move(envelope));
+        std::string fourcc{ir.fourcc()};
+        std::transform(fourcc.begin(), fourcc.end(), fourcc.begin(), ::tolower);
+        const std::string FRAME{ir.data()};
+        const uint32_t FRAME_SIZE{ir.width() * ir.height() * 3 / 2};
+        if ((("i420" != fourcc) && ("yu12" != fourcc)) || (FRAME.size() < FRAME_SIZE)) {
+            continue;
+        }
+
+        // (Re-)initialize the encoder whenever the geometry changes.
+        if (!encoder || (width != ir.width()) || (height != ir.height())) {
+            width = ir.width();
+            height = ir.height();
+            encoder.reset(new StreamEncoder(width, height, getCommandlineArgumentsFromString(ENCODER_ARGUMENTS)));
+            if (!encoder->valid()) {
+                std::cerr << program << ": Failed to set up " << encoder->backend() << " encoder." << std::endl;
+                return 1;
+            }
+            previousLuma.assign(FRAME.begin(), FRAME.begin() + width * height);
+            if (!NAME.empty()) {
+                sharedMemory.reset(new cluon::SharedMemory{NAME, FRAME_SIZE});
+                std::clog << program << ": Replaying into '" << sharedMemory->name() << "' (" << sharedMemory->size() << " bytes)." << std::endl;
+            }
+        }
+
+        const uint8_t *y{reinterpret_cast<const uint8_t*>(FRAME.data())};
+        if (sharedMemory && sharedMemory->valid() && (sharedMemory->size() >= FRAME_SIZE)) {
+            sharedMemory->lock();
+            memcpy(sharedMemory->data(), y, FRAME_SIZE);
+            sharedMemory->setTimeStamp(sampleTimeStamp);
+            sharedMemory->unlock();
+            sharedMemory->notifyAll();
+        }
+
+        FrameRecord record;
+        record.frame = static_cast<uint32_t>(records.size());
+        record.sampleTime = cluon::time::toMicroseconds(sampleTimeStamp);
+        record.senderStamp = senderStamp;
+        record.spatialActivity = spatialActivity(y, width, width, height);
+        record.temporalDifference = meanAbsoluteDifference(y, width, previousLuma.data(), width, width, height);
+        memcpy(previousLuma.data(), y, width * height);
+
+        const uint8_t *planes[3]{y, y + (width * height), y + (width * height + ((width * height) >> 2))};
+        const uint32_t strides[3]{width, width / 2, width / 2};
+        AccessUnit accessUnit;
+        cluon::data::TimeStamp before{cluon::time::now()};
+        const bool encoded{encoder->encode(planes, strides, accessUnit)};
+        cluon::data::TimeStamp after{cluon::time::now()};
+        record.encodeTime = cluon::time::deltaInMicroseconds(after, before);
+        if (encoded) {
+            record.frameType = accessUnit.frameType;
+            record.bytes = accessUnit.size;
+        }
+        records.push_back(record);
+    }
+    if (records.empty()) {
+        std::cerr << program << ": No I420 ImageReading found in '" << REC << "'." << std::endl;
+        return 1;
+    }
+
+    if (commandlineArguments["csv"].size() != 0) {
+        std::ofstream out(commandlineArguments["csv"]);
+        out << "frame,sample_us,sender_stamp,frame_type,bytes,encode_us,spatial_activity,temporal_difference" << std::endl;
+        for (auto &r : records) {
+            out << r.frame << "," << r.sampleTime << "," << r.senderStamp << "," << frameTypeName(r.frameType) << "," << r.bytes << ","
+                << r.encodeTime << "," << r.spatialActivity << "," << r.temporalDifference << std::endl;
+        }
+    }
+
+    std::vector<int64_t> encodeTimes;
+    for (auto &r : records) {
+        encodeTimes.push_back(r.encodeTime);
+    }
+    std::sort(encodeTimes.begin(), encodeTimes.end());
+    auto percentile = [&encodeTimes](uint32_t p) { return encodeTimes[(encodeTimes.size() - 1) * p / 100]; };
+
+    std::cout << program << ": " << records.size() << " frames of " << width << "x" << height << " replayed "
+              << (REALTIME ? "at recorded speed" : "at maximum speed") << "." << std::endl;
+    std::cout << "encoding time [us]: p50 = " << percentile(50) << ", p95 = " << percentile(95) << ", p99 = " << percentile(99)
+              << ", max = " << encodeTimes.back() << std::endl;
+    std::cout << std::fixed << std::setprecision(3) << "correlation of encoding time with spatial activity = "
+              << correlation(records, &FrameRecord::spatialActivity) << ", with temporal difference = "
+              << correlation(records, &FrameRecord::temporalDifference) << std::endl;
+
+    std::vector<FrameRecord> slowest{records};
+    std::sort(slowest.begin(), slowest.end(), [](const FrameRecord &a, const FrameRecord &b) { return a.encodeTime > b.encodeTime; });
+    slowest.resize(std::min(static_cast<size_t>(TOP), slowest.size()));
+    std::cout << std::setw(8) << "frame" << std::setw(20) << "sample time [us]" << std::setw(6) << "type" << std::setw(10) << "bytes"
+              << std::setw(12) << "encode us" << std::setw(10) << "spatial" << std::setw(10) << "temporal" << std::endl;
+    for (auto &r : slowest) {
+        std::cout << std::setw(8) << r.frame << std::setw(20) << r.sampleTime << std::setw(6) << frameTypeName(r.frameType)
+                  << std::setw(10) << r.bytes << std::setw(12) << r.encodeTime << std::setprecision(2) << std::setw(10)
+                  << r.spatialActivity << std::setw(10) << r.temporalDifference << std::endl;
+    }
+    return 0;
+}
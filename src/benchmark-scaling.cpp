@@ -0,0 +1,261 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cluon-complete.hpp"
+#include "benchmark.hpp"
+#include "encoder-parameters.hpp"
+#include "i420-clip.hpp"
+#include "stream-encoder.hpp"
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct StreamStatistics {
+    uint32_t produced{0};
+    uint32_t encoded{0};
+    uint32_t late{0};
+    std::vector<int64_t> latencies{};
+};
+
+struct RunResult {
+    uint32_t streams{0};
+    uint32_t threads{0};
+    bool pinned{false};
+    uint64_t produced{0};
+    uint64_t encoded{0};
+    uint64_t missed{0};
+    double missRate{0.0};
+    double p99LatencyMs{0.0};
+    double cpuCores{0.0};
+    double cpuMsPerFrame{0.0};
+};
+
+double cpuSeconds() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec)
+         + static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000000.0;
+}
+
+void pinCurrentThread(uint32_t firstCore, uint32_t numberOfCores) {
+    const uint32_t CORES{std::max(1u, std::thread::hardware_concurrency())};
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    for (uint32_t i{0}; i < numberOfCores; i++) {
+        CPU_SET((firstCore + i) % CORES, &cpuset);
+    }
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+}
+
+RunResult run(const std::string &program, uint32_t streams, uint32_t threads, bool pinned, uint32_t width, uint32_t height, float fps, uint32_t seconds, const std::string &encoderArguments) {
+    RunResult result;
+    result.streams = streams;
+    result.threads = threads;
+    result.pinned = pinned;
+
+    const uint32_t SIZE{width * height * 3 / 2};
+    const int64_t FRAME_INTERVAL{static_cast<int64_t>(1000000.0f / fps)};
+
+    // A few pre-rendered frames are cycled so that producing is cheap compared to encoding.
+    I420Clip clip;
+    clip.generate(width, height, 8);
+
+    std::vector<std::unique_ptr<cluon::SharedMemory>> producers;
+    for (uint32_t i{0}; i < streams; i++) {
+        std::stringstream name;
+        name << "benchmark-scaling-" << getpid() << "-" << i;
+        producers.emplace_back(new cluon::SharedMemory{name.str(), SIZE});
+        if (!producers.back()->valid()) {
+            std::cerr << program << ": Failed to create shared memory '" << name.str() << "'." << std::endl;
+            return result;
+        }
+    }
+
+    std::atomic<bool> running{true};
+    std::vector<StreamStatistics> statistics(streams);
+    std::vector<std::thread> encoders;
+    std::atomic<uint32_t> ready{0};
+    for (uint32_t i{0}; i < streams; i++) {
+        encoders.emplace_back([&, i]() {
+            if (pinned) {
+                pinCurrentThread(i * threads, threads);
+            }
+            cluon::SharedMemory sharedMemory{producers[i]->name().substr(producers[i]->name().rfind('/') + 1)};
+
+            auto arguments = getCommandlineArgumentsFromString(encoderArguments);
+            std::stringstream threadsArgument;
+            threadsArgument << threads;
+            arguments["threads"] = threadsArgument.str();
+            StreamEncoder encoder{width, height, arguments};
+            const bool initialized{sharedMemory.valid() && encoder.valid()};
+            ready++;
+
+            StreamStatistics &stats{statistics[i]};
+            int64_t lastSampleTime{0};
+            while (initialized && running.load()) {
+                sharedMemory.wait();
+                if (!running.load()) {
+                    break;
+                }
+                sharedMemory.lock();
+                auto r = sharedMemory.getTimeStamp();
+                const int64_t sampleTime{r.first ? cluon::time::toMicroseconds(r.second) : 0};
+                if (sampleTime == lastSampleTime) {
+                    sharedMemory.unlock();
+                    continue;
+                }
+                lastSampleTime = sampleTime;
+
+                const uint8_t *data{reinterpret_cast<const uint8_t*>(sharedMemory.data())};
+                const uint8_t *planes[3]{data, data + (width * height), data + (width * height + ((width * height) >> 2))};
+                const uint32_t strides[3]{width, width / 2, width / 2};
+                AccessUnit accessUnit;
+                encoder.encode(planes, strides, accessUnit);
+                sharedMemory.unlock();
+
+                const int64_t latency{cluon::time::toMicroseconds(cluon::time::now()) - sampleTime};
+                stats.encoded++;
+                stats.latencies.push_back(latency);
+                if (latency > FRAME_INTERVAL) {
+                    stats.late++;
+                }
+            }
+        });
+    }
+    while (ready.load() < streams) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    // All producers are driven from one thread at the same frame rate; the
+    // streams are staggered within the frame interval as real cameras are not in phase.
+    const double CPU_BEFORE{cpuSeconds()};
+    const auto START{std::chrono::steady_clock::now()};
+    const uint32_t FRAMES{static_cast<uint32_t>(static_cast<float>(seconds) * fps)};
+    for (uint32_t frame{0}; frame < FRAMES; frame++) {
+        for (uint32_t i{0}; i < streams; i++) {
+            const auto due = START + std::chrono::microseconds(frame * FRAME_INTERVAL + (i * FRAME_INTERVAL) / streams);
+            std::this_thread::sleep_until(due);
+            producers[i]->lock();
+            memcpy(producers[i]->data(), clip.frame(frame), SIZE);
+            producers[i]->setTimeStamp(cluon::time::now());
+            producers[i]->unlock();
+            producers[i]->notifyAll();
+            statistics[i].produced++;
+        }
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(2 * FRAME_INTERVAL));
+    const double WALL{std::chrono::duration<double>(std::chrono::steady_clock::now() - START).count()};
+    const double CPU{cpuSeconds() - CPU_BEFORE};
+
+    running.store(false);
+    for (auto &producer : producers) {
+        producer->notifyAll();
+    }
+    for (auto &encoder : encoders) {
+        encoder.join();
+    }
+
+    std::vector<int64_t> latencies;
+    for (auto &stats : statistics) {
+        result.produced += stats.produced;
+        result.encoded += stats.encoded;
+        result.missed += (stats.produced - std::min(stats.produced, stats.encoded)) + stats.late;
+        latencies.insert(latencies.end(), stats.latencies.begin(), stats.latencies.end());
+    }
+    if (!latencies.empty()) {
+        std::sort(latencies.begin(), latencies.end());
+        result.p99LatencyMs = static_cast<double>(latencies[(latencies.size() * 99) / 100]) / 1000.0;
+    }
+    result.missRate = (0 < result.produced) ? static_cast<double>(result.missed) / static_cast<double>(result.produced) : 1.0;
+    result.cpuCores = CPU / WALL;
+    result.cpuMsPerFrame = (0 < result.encoded) ? (CPU * 1000.0) / static_cast<double>(result.encoded) : 0.0;
+    return result;
+}
+
+std::vector<uint32_t> parseList(const std::string &list) {
+    std::vector<uint32_t> values;
+    for (auto entry : splitString(list, ',')) {
+        values.push_back(static_cast<uint32_t>(std::stoi(entry)));
+    }
+    return values;
+}
+
+} // namespace
+
+int32_t runScalingSuite(const std::string &program, std::map<std::string, std::string> &commandlineArguments) {
+    const uint32_t WIDTH{(commandlineArguments["width"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["width"])) : 1920};
+    const uint32_t HEIGHT{(commandlineArguments["height"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["height"])) : 1080};
+    const float FPS{(commandlineArguments["fps"].size() != 0) ? std::stof(commandlineArguments["fps"]) : 30.0f};
+    const uint32_t DURATION{(commandlineArguments["duration"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["duration"])) : 10};
+    const double MAX_MISS_RATE{(commandlineArguments["max-miss-rate"].size() != 0) ? std::stod(commandlineArguments["max-miss-rate"]) : 1.0};
+    const std::vector<uint32_t> STREAMS{parseList((commandlineArguments["streams"].size() != 0) ? commandlineArguments["streams"] : "1,2,4,8")};
+    const std::vector<uint32_t> THREADS{parseList((commandlineArguments["threads"].size() != 0) ? commandlineArguments["threads"] : "1")};
+    const std::vector<uint32_t> PINNING{parseList((commandlineArguments["pinning"].size() != 0) ? commandlineArguments["pinning"] : "0,1")};
+    const std::string ENCODER_ARGUMENTS{commandlineArguments["encoder-args"]};
+
+    std::clog << program << ": " << std::thread::hardware_concurrency() << " hardware threads; " << WIDTH << "x" << HEIGHT << "@" << FPS
+              << "; deadline per frame = " << (1000.0f / FPS) << " ms." << std::endl;
+    std::cout << std::setw(8) << "streams" << std::setw(9) << "threads" << std::setw(8) << "pinned" << std::setw(10) << "encoded"
+              << std::setw(10) << "missed %" << std::setw(12) << "p99 ms" << std::setw(11) << "CPU cores" << std::setw(14) << "CPU ms/frame"
+              << std::setw(12) << "efficiency" << std::endl;
+
+    for (auto threads : THREADS) {
+        for (auto pinning : PINNING) {
+            double singleStreamCpuMsPerFrame{0.0};
+            uint32_t sustained{0};
+            bool saturated{false};
+            for (auto streams : STREAMS) {
+                RunResult r{run(program, streams, threads, (0 != pinning), WIDTH, HEIGHT, FPS, DURATION, ENCODER_ARGUMENTS)};
+                // The first configuration with a measurable CPU cost is the reference.
+                if (singleStreamCpuMsPerFrame <= 0.0) {
+                    singleStreamCpuMsPerFrame = r.cpuMsPerFrame;
+                }
+                // Scaling efficiency per core: CPU cost per frame of the smallest
+                // configuration relative to the CPU cost per frame of this one.
+                const double EFFICIENCY{(0.0 < r.cpuMsPerFrame) ? singleStreamCpuMsPerFrame / r.cpuMsPerFrame : 0.0};
+                std::cout << std::setw(8) << r.streams << std::setw(9) << r.threads << std::setw(8) << (r.pinned ? "yes" : "no")
+                          << std::setw(10) << r.encoded << std::fixed << std::setprecision(2) << std::setw(10) << (r.missRate * 100.0)
+                          << std::setw(12) << r.p99LatencyMs << std::setw(11) << r.cpuCores << std::setw(14) << r.cpuMsPerFrame
+                          << std::setw(12) << EFFICIENCY << std::endl;
+                if (!saturated && ((r.missRate * 100.0) <= MAX_MISS_RATE)) {
+                    sustained = streams;
+                }
+                else {
+                    saturated = true;
+                }
+            }
+            std::cout << "threads=" << threads << ", pinning=" << (0 != pinning ? "yes" : "no") << ": " << sustained << " stream(s) sustained at <= "
+                      << MAX_MISS_RATE << "% deadline misses" << (saturated ? "; deadline misses start above." : ".") << std::endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cluon-complete.hpp"
+#include "opendlv-standard-message-set.hpp"
+#include "benchmark.hpp"
+#include "encoder-parameters.hpp"
+#include "i420-clip.hpp"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace {
+
+/**
+ * Synthetic camera publishing I420 frames into a new shared memory area.
+ */
+class Producer {
+   private:
+    Producer(const Producer &) = delete;
+    Producer(Producer &&)      = delete;
+    Producer &operator=(const Producer &) = delete;
+    Producer &operator=(Producer &&) = delete;
+
+   public:
+    Producer(const std::string &name, const I420Clip &clip, float fps) noexcept
+        : m_sharedMemory{new cluon::SharedMemory{name, clip.frameSize()}} {
+        m_thread = std::thread([this, &clip, fps]() {
+            const auto START{std::chrono::steady_clock::now()};
+            for (uint32_t frame{0}; m_running.load(); frame++) {
+                m_sharedMemory->lock();
+                memcpy(m_sharedMemory->data(), clip.frame(frame % clip.frames()), clip.frameSize());
+                m_sharedMemory->setTimeStamp(cluon::time::now());
+                m_sharedMemory->unlock();
+                m_sharedMemory->notifyAll();
+                std::this_thread::sleep_until(START + std::chrono::microseconds(static_cast<int64_t>((frame + 1) * 1000000.0f / fps)));
+            }
+        });
+    }
+    ~Producer() {
+        m_running.store(false);
+        m_thread.join();
+    }
+
+   private:
+    std::unique_ptr<cluon::SharedMemory> m_sharedMemory;
+    std::atomic<bool> m_running{true};
+    std::thread m_thread{};
+};
+
+} // namespace
+
+int32_t runStartupSuite(const std::string &program, std::map<std::string, std::string> &commandlineArguments) {
+    const std::string ENCODER{(commandlineArguments["encoder"].size() != 0) ? commandlineArguments["encoder"] : "opendlv-video-h264-encoder"};
+    const std::string ENCODER_ARGUMENTS{commandlineArguments["encoder-args"]};
+    const uint16_t CID{(commandlineArguments["cid"].size() != 0) ? static_cast<uint16_t>(std::stoi(commandlineArguments["cid"])) : static_cast<uint16_t>(253)};
+    const uint32_t WIDTH{(commandlineArguments["width"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["width"])) : 1280};
+    const uint32_t HEIGHT{(commandlineArguments["height"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["height"])) : 720};
+    const float FPS{(commandlineArguments["fps"].size() != 0) ? std::stof(commandlineArguments["fps"]) : 30.0f};
+    const uint32_t RUNS{(commandlineArguments["runs"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["runs"])) : 5};
+    const uint32_t DELAY{(commandlineArguments["delay"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["delay"])) : 500};
+    const uint32_t TIMEOUT{(commandlineArguments["timeout"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["timeout"])) : 10};
+
+    I420Clip clip;
+    clip.generate(WIDTH, HEIGHT, static_cast<uint32_t>(FPS));
+
+    // Arrival of the first frame from the encoder of the current run, which
+    // is identified by its senderStamp.
+    std::atomic<uint32_t> currentId{0};
+    std::atomic<int64_t> firstArrival{0};
+    cluon::OD4Session od4{CID};
+    od4.dataTrigger(opendlv::proxy::ImageReading::ID(), [&](cluon::data::Envelope &&envelope) {
+        int64_t none{0};
+        if (currentId.load() == envelope.senderStamp()) {
+            firstArrival.compare_exchange_strong(none, steadyMicroseconds());
+        }
+    });
+
+    const char *SCENARIOS[2]{"producer first", "encoder first"};
+    std::vector<int64_t> timeToFirstFrame[2];
+    uint32_t failures{0};
+    for (uint32_t run{0}; run < RUNS; run++) {
+        for (uint32_t scenario{0}; scenario < 2; scenario++) {
+            const uint32_t ID{1 + run * 2 + scenario};
+            std::stringstream name;
+            name << "benchmark-startup-" << getpid() << "-" << ID;
+            std::vector<std::string> arguments{"--cid=" + std::to_string(CID), "--name=" + name.str(), "--width=" + std::to_string(WIDTH),
+                                               "--height=" + std::to_string(HEIGHT), "--id=" + std::to_string(ID)};
+            for (auto argument : splitString(ENCODER_ARGUMENTS, ' ')) {
+                arguments.push_back(argument);
+            }
+            currentId.store(ID);
+            firstArrival.store(0);
+
+            // The time to the first frame is measured from the moment the last
+            // of both processes was started.
+            std::unique_ptr<Producer> producer;
+            pid_t pid{-1};
+            int64_t start{0};
+            if (0 == scenario) {
+                producer.reset(new Producer(name.str(), clip, FPS));
+                std::this_thread::sleep_for(std::chrono::milliseconds(DELAY));
+                start = steadyMicroseconds();
+                pid = startEncoder(ENCODER, arguments);
+            }
+            else {
+                pid = startEncoder(ENCODER, arguments);
+                std::this_thread::sleep_for(std::chrono::milliseconds(DELAY));
+                start = steadyMicroseconds();
+                producer.reset(new Producer(name.str(), clip, FPS));
+            }
+
+            const int64_t DEADLINE{start + static_cast<int64_t>(TIMEOUT) * 1000000};
+            while ((0 == firstArrival.load()) && (steadyMicroseconds() < DEADLINE) && (0 < pid) && (0 == waitpid(pid, nullptr, WNOHANG))) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            const int64_t ARRIVAL{firstArrival.load()};
+            if (0 < pid) {
+                stopEncoder(pid);
+            }
+            producer.reset();
+
+            if (0 == ARRIVAL) {
+                std::cerr << program << ": Run " << run << " (" << SCENARIOS[scenario] << "): no frame received." << std::endl;
+                failures++;
+            }
+            else {
+                timeToFirstFrame[scenario].push_back(ARRIVAL - start);
+            }
+        }
+    }
+
+    std::cout << program << ": time to first published frame for " << WIDTH << "x" << HEIGHT << " over " << RUNS << " runs [ms]:" << std::endl;
+    std::cout << std::left << std::setw(16) << "scenario" << std::right << std::setw(10) << "min" << std::setw(10) << "median" << std::setw(10)
+              << "max" << std::setw(10) << "failed" << std::endl;
+    for (uint32_t scenario{0}; scenario < 2; scenario++) {
+        std::vector<int64_t> &t{timeToFirstFrame[scenario]};
+        std::sort(t.begin(), t.end());
+        std::cout << std::left << std::setw(16) << SCENARIOS[scenario] << std::right << std::fixed << std::setprecision(1);
+        if (t.empty()) {
+            std::cout << std::setw(10) << "-" << std::setw(10) << "-" << std::setw(10) << "-";
+        }
+        else {
+            std::cout << std::setw(10) << static_cast<double>(t.front()) / 1000.0 << std::setw(10) << static_cast<double>(t[t.size() / 2]) / 1000.0
+                      << std::setw(10) << static_cast<double>(t.back()) / 1000.0;
+        }
+        std::cout << std::setw(10) << (RUNS - t.size()) << std::endl;
+    }
+    return (0 == failures) ? 0 : 1;
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cluon-complete.hpp"
+#include "benchmark.hpp"
+#include "encoder-parameters.hpp"
+#include "encoder-pool.hpp"
+#include "i420-clip.hpp"
+#include "stream-encoder.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <utility>
+#include <vector>
+
+int32_t runSwitchSuite(const std::string &program, std::map<std::string, std::string> &commandlineArguments) {
+    const uint32_t WIDTH{(commandlineArguments["width"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["width"])) : 1280};
+    const uint32_t HEIGHT{(commandlineArguments["height"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["height"])) : 720};
+    const uint32_t FRAMES{(commandlineArguments["frames"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["frames"])) : 300};
+    const uint32_t INTERVAL{(commandlineArguments["interval"].size() != 0) ? std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["interval"])), 1u) : 30};
+
+    std::vector<std::pair<std::string, std::string>> profiles;
+    if (commandlineArguments["profiles"].size() != 0) {
+        profiles = loadNamedArguments(commandlineArguments["profiles"]);
+    }
+    else {
+        profiles.push_back(std::make_pair("teleop", "--bitrate=800000 --gop=30 --ecomplexity=0 --num-ref-frame=1"));
+        profiles.push_back(std::make_pair("recording", "--bitrate=4000000 --gop=60 --ecomplexity=2 --num-ref-frame=4"));
+    }
+    if (2 > profiles.size()) {
+        std::cerr << program << ": At least two profiles are needed to switch between." << std::endl;
+        return 1;
+    }
+    std::vector<std::map<std::string, std::string>> arguments;
+    for (auto &profile : profiles) {
+        arguments.push_back(getCommandlineArgumentsFromString(profile.second + " " + commandlineArguments["encoder-args"]));
+    }
+
+    I420Clip clip;
+    clip.generate(WIDTH, HEIGHT, std::min(FRAMES, 60u));
+
+    // Every INTERVAL frames, the next profile is selected either by setting up
+    // a new encoder (cold) or by taking a pre-initialized one from the pool (warm);
+    // the stall is the time from the switch until the first frame is encoded.
+    const char *MODES[2]{"cold", "warm"};
+    std::vector<int64_t> stalls[2];
+    std::vector<int64_t> encodingTimes;
+    uint32_t failures{0};
+    for (uint32_t mode{0}; mode < 2; mode++) {
+        const bool WARM{1 == mode};
+        EncoderPool pool{static_cast<uint32_t>(profiles.size())};
+        if (WARM) {
+            for (auto &a : arguments) {
+                pool.prewarm(WIDTH, HEIGHT, a, false);
+            }
+        }
+
+        uint32_t current{0};
+        std::unique_ptr<StreamEncoder> encoder{WARM ? pool.acquire(WIDTH, HEIGHT, arguments[current], false) : std::unique_ptr<StreamEncoder>(new StreamEncoder(WIDTH, HEIGHT, arguments[current]))};
+        for (uint32_t frame{0}; frame < FRAMES; frame++) {
+            int64_t switchStart{0};
+            if ((0 < frame) && (0 == frame % INTERVAL)) {
+                const uint32_t NEXT{static_cast<uint32_t>((current + 1) % profiles.size())};
+                switchStart = steadyMicroseconds();
+                if (WARM) {
+                    pool.release(EncoderPool::keyOf(WIDTH, HEIGHT, arguments[current]), std::move(encoder));
+                    encoder = pool.acquire(WIDTH, HEIGHT, arguments[NEXT], false);
+                }
+                else {
+                    encoder.reset();
+                    encoder.reset(new StreamEncoder(WIDTH, HEIGHT, arguments[NEXT]));
+                }
+                current = NEXT;
+            }
+            if (!encoder->valid()) {
+                std::cerr << program << ": Failed to set up encoder for profile '" << profiles[current].first << "'." << std::endl;
+                return 1;
+            }
+
+            const uint8_t *y{clip.frame(frame % clip.frames())};
+            const uint8_t *planes[3]{y, y + (WIDTH * HEIGHT), y + (WIDTH * HEIGHT + ((WIDTH * HEIGHT) >> 2))};
+            const uint32_t strides[3]{WIDTH, WIDTH / 2, WIDTH / 2};
+            AccessUnit accessUnit;
+            const int64_t BEFORE{steadyMicroseconds()};
+            const bool ENCODED{encoder->encode(planes, strides, accessUnit)};
+            const int64_t AFTER{steadyMicroseconds()};
+            if (0 < switchStart) {
+                stalls[mode].push_back(AFTER - switchStart);
+                if (!ENCODED || (videoFrameTypeIDR != accessUnit.frameType)) {
+                    std::cerr << program << ": Frame " << frame << " after switching to '" << profiles[current].first << "' (" << MODES[mode] << ") is no IDR frame." << std::endl;
+                    failures++;
+                }
+            }
+            else if (ENCODED && (0 < frame)) {
+                encodingTimes.push_back(AFTER - BEFORE);
+            }
+        }
+    }
+    if (stalls[0].empty() || encodingTimes.empty()) {
+        std::cerr << program << ": No profile switch within " << FRAMES << " frames (--interval=" << INTERVAL << ")." << std::endl;
+        return 1;
+    }
+
+    std::sort(encodingTimes.begin(), encodingTimes.end());
+    std::cout << program << ": " << stalls[0].size() << " profile switches between " << profiles.size() << " profiles at " << WIDTH << "x" << HEIGHT
+              << "; median encoding time without switch = " << std::fixed << std::setprecision(2)
+              << static_cast<double>(encodingTimes[encodingTimes.size() / 2]) / 1000.0 << " ms." << std::endl;
+    std::cout << "time from switch to the first encoded frame [ms]:" << std::endl;
+    std::cout << std::left << std::setw(8) << "mode" << std::right << std::setw(10) << "min" << std::setw(10) << "median" << std::setw(10) << "max" << std::endl;
+    for (uint32_t mode{0}; mode < 2; mode++) {
+        std::vector<int64_t> &t{stalls[mode]};
+        std::sort(t.begin(), t.end());
+        std::cout << std::left << std::setw(8) << MODES[mode] << std::right << std::setw(10) << static_cast<double>(t.front()) / 1000.0
+                  << std::setw(10) << static_cast<double>(t[t.size() / 2]) / 1000.0 << std::setw(10) << static_cast<double>(t.back()) / 1000.0 << std::endl;
+    }
+    return (0 == failures) ? 0 : 1;
+}
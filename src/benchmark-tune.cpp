@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cluon-complete.hpp"
+#include "benchmark.hpp"
+#include "encoder-parameters.hpp"
+#include "i420-clip.hpp"
+#include "rate-distortion.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Knob {
+    std::string name;
+    std::vector<std::string> values;
+};
+
+struct Candidate {
+    std::string arguments{};
+    double msPerFrame{0.0};
+    double bitrateKbps{0.0};
+    double psnr{0.0};
+    bool valid{false};
+};
+
+std::vector<Knob> defaultKnobs() {
+    return std::vector<Knob>{
+        Knob{"ecomplexity", {"0", "1", "2"}},
+        Knob{"num-ref-frame", {"1", "2", "4"}},
+        Knob{"adaptive-quant", {"0", "1"}},
+        Knob{"background-detection", {"0", "1"}},
+        Knob{"scene-change-detect", {"0", "1"}},
+        Knob{"denoise", {"0", "1"}},
+        Knob{"loop-filter", {"0", "1"}},
+        Knob{"long-term-ref", {"0", "1"}},
+    };
+}
+
+// Parses "ecomplexity:0|1|2,num-ref-frame:1|4".
+std::vector<Knob> parseKnobs(const std::string &specification) {
+    std::vector<Knob> knobs;
+    for (auto entry : splitString(specification, ',')) {
+        auto nameAndValues = splitString(entry, ':');
+        if (2 == nameAndValues.size()) {
+            knobs.push_back(Knob{nameAndValues[0], splitString(nameAndValues[1], '|')});
+        }
+    }
+    return knobs;
+}
+
+std::string argumentsOf(const std::vector<Knob> &knobs, const std::vector<uint32_t> &selection) {
+    std::stringstream sstr;
+    for (uint32_t i{0}; i < knobs.size(); i++) {
+        sstr << (0 < i ? " " : "") << "--" << knobs[i].name << "=" << knobs[i].values[selection[i]];
+    }
+    return sstr.str();
+}
+
+// a dominates b if it is not worse in any objective and better in at least one.
+bool dominates(const Candidate &a, const Candidate &b) {
+    const bool notWorse{(a.msPerFrame <= b.msPerFrame) && (a.bitrateKbps <= b.bitrateKbps) && (a.psnr >= b.psnr)};
+    const bool better{(a.msPerFrame < b.msPerFrame) || (a.bitrateKbps < b.bitrateKbps) || (a.psnr > b.psnr)};
+    return notWorse && better;
+}
+
+} // namespace
+
+int32_t runTuneSuite(const std::string &program, std::map<std::string, std::string> &commandlineArguments) {
+    const uint32_t FRAMES{(commandlineArguments["frames"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["frames"])) : 120};
+    const float FPS{(commandlineArguments["fps"].size() != 0) ? std::stof(commandlineArguments["fps"]) : 30.0f};
+    const uint32_t JOBS{(commandlineArguments["jobs"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["jobs"])) : std::max(1u, std::thread::hardware_concurrency())};
+    const uint32_t BUDGET{(commandlineArguments["budget"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["budget"])) : 0};
+    const uint32_t SEED{(commandlineArguments["seed"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["seed"])) : 1};
+    const std::string BASE_ARGUMENTS{commandlineArguments["encoder-args"]};
+    const std::vector<Knob> KNOBS{(commandlineArguments["knobs"].size() != 0) ? parseKnobs(commandlineArguments["knobs"]) : defaultKnobs()};
+
+    std::vector<std::unique_ptr<I420Clip>> clips;
+    if (commandlineArguments["rec"].size() != 0) {
+        for (auto rec : splitString(commandlineArguments["rec"], ',')) {
+            std::unique_ptr<I420Clip> clip(new I420Clip());
+            if (!clip->loadRecording(rec, FRAMES)) {
+                std::cerr << program << ": No I420 ImageReading found in '" << rec << "'." << std::endl;
+                return 1;
+            }
+            clips.push_back(std::move(clip));
+        }
+    }
+    else {
+        std::unique_ptr<I420Clip> clip(new I420Clip());
+        clip->generate(640, 480, FRAMES);
+        clips.push_back(std::move(clip));
+    }
+
+    // Enumerate the full grid; a budget selects a reproducible random subset.
+    // The defaults of this microservice are always evaluated as reference.
+    uint64_t gridSize{1};
+    for (auto &knob : KNOBS) {
+        gridSize *= knob.values.size();
+    }
+    std::vector<std::string> configurations;
+    {
+        std::vector<uint32_t> selection(KNOBS.size(), 0);
+        for (uint64_t index{0}; index < gridSize; index++) {
+            uint64_t rest{index};
+            for (uint32_t i{0}; i < KNOBS.size(); i++) {
+                selection[i] = static_cast<uint32_t>(rest % KNOBS[i].values.size());
+                rest /= KNOBS[i].values.size();
+            }
+            configurations.push_back(argumentsOf(KNOBS, selection));
+        }
+        if ((0 < BUDGET) && (BUDGET < configurations.size())) {
+            std::mt19937 generator(SEED);
+            std::shuffle(configurations.begin(), configurations.end(), generator);
+            configurations.resize(BUDGET);
+        }
+        configurations.push_back("");
+    }
+    std::clog << program << ": Evaluating " << configurations.size() << " configurations (grid of " << gridSize << ") on " << clips.size()
+              << " clip(s) with " << JOBS << " parallel job(s)." << std::endl;
+
+    std::vector<Candidate> candidates(configurations.size());
+    std::atomic<uint32_t> next{0};
+    std::mutex progressMutex;
+    uint32_t done{0};
+    std::vector<std::thread> workers;
+    for (uint32_t job{0}; job < JOBS; job++) {
+        workers.emplace_back([&]() {
+            for (uint32_t i{next++}; i < configurations.size(); i = next++) {
+                Candidate &candidate{candidates[i]};
+                candidate.arguments = configurations[i];
+                candidate.valid = true;
+                // Force single-threaded encoders so that the parallel jobs do not distort the timing.
+                const std::string ARGUMENTS{BASE_ARGUMENTS + " " + configurations[i] + " --threads=1"};
+                for (auto &clip : clips) {
+                    ClipResult r{evaluateClip(*clip, ARGUMENTS, FPS)};
+                    candidate.valid &= r.valid;
+                    candidate.msPerFrame += r.encodeMsPerFrame / static_cast<double>(clips.size());
+                    candidate.bitrateKbps += r.bitrateKbps / static_cast<double>(clips.size());
+                    candidate.psnr += r.psnr / static_cast<double>(clips.size());
+                }
+                std::lock_guard<std::mutex> lck(progressMutex);
+                done++;
+                if (0 == (done % 16)) {
+                    std::clog << program << ": " << done << "/" << configurations.size() << " configurations evaluated." << std::endl;
+                }
+            }
+        });
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    std::vector<Candidate> front;
+    for (auto &candidate : candidates) {
+        if (!candidate.valid) {
+            continue;
+        }
+        bool dominated{false};
+        for (auto &other : candidates) {
+            if (other.valid && dominates(other, candidate)) {
+                dominated = true;
+                break;
+            }
+        }
+        if (!dominated) {
+            front.push_back(candidate);
+        }
+    }
+    std::sort(front.begin(), front.end(), [](const Candidate &a, const Candidate &b) { return a.msPerFrame < b.msPerFrame; });
+
+    const std::string CID{(commandlineArguments["cid"].size() != 0) ? commandlineArguments["cid"] : "<cid>"};
+    const std::string NAME{(commandlineArguments["name"].size() != 0) ? commandlineArguments["name"] : "<name>"};
+    std::cout << "Pareto-optimal configurations (" << front.size() << " of " << candidates.size() << "):" << std::endl;
+    std::cout << std::setw(10) << "ms/frame" << std::setw(12) << "kbit/s" << std::setw(10) << "PSNR" << "  command line" << std::endl;
+    for (auto &candidate : front) {
+        std::stringstream commandLine;
+        commandLine << "opendlv-video-h264-encoder --cid=" << CID << " --name=" << NAME << " --width=" << clips[0]->width()
+                    << " --height=" << clips[0]->height() << (BASE_ARGUMENTS.empty() ? "" : " ") << BASE_ARGUMENTS
+                    << (candidate.arguments.empty() ? "" : " ") << candidate.arguments;
+        std::cout << std::fixed << std::setprecision(2) << std::setw(10) << candidate.msPerFrame << std::setprecision(1) << std::setw(12)
+                  << candidate.bitrateKbps << std::setprecision(2) << std::setw(10) << candidate.psnr << "  " << commandLine.str() << std::endl;
+    }
+    return 0;
+}
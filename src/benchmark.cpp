@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "benchmark.hpp"
+
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+int64_t steadyMicroseconds() noexcept {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+pid_t startEncoder(const std::string &encoder, const std::vector<std::string> &arguments) noexcept {
+    const pid_t pid{fork()};
+    if (0 == pid) {
+        std::vector<char*> argv;
+        argv.push_back(const_cast<char*>(encoder.c_str()));
+        for (auto &argument : arguments) {
+            argv.push_back(const_cast<char*>(argument.c_str()));
+        }
+        argv.push_back(nullptr);
+        execvp(encoder.c_str(), argv.data());
+        std::cerr << "Failed to start '" << encoder << "': " << strerror(errno) << std::endl;
+        _exit(127);
+    }
+    return pid;
+}
+
+double stopEncoder(pid_t pid) noexcept {
+    struct rusage usage;
+    memset(&usage, 0, sizeof(usage));
+    kill(pid, SIGTERM);
+    bool stopped{false};
+    for (uint32_t i{0}; !stopped && (i < 200); i++) {
+        stopped = (pid == wait4(pid, nullptr, WNOHANG, &usage));
+        if (!stopped) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    if (!stopped) {
+        kill(pid, SIGKILL);
+        wait4(pid, nullptr, 0, &usage);
+    }
+    return static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) + static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000000.0;
+}
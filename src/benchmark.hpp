@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include <sys/types.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * Rate-distortion-speed regression suite: encodes reference clips with
+ * parameter presets, decodes them, and compares bitrate, PSNR/SSIM, and
+ * encoding speed against an optional baseline.
+ *
+ * @return 0 if no regression was found.
+ */
+int32_t runRateDistortionSuite(const std::string &program, std::map<std::string, std::string> &commandlineArguments);
+
+/**
+ * Multi-stream scalability benchmark: drives N synthetic shared memory
+ * producers and N encoders while varying the threads per encoder and CPU
+ * pinning, and reports deadline misses and scaling efficiency.
+ *
+ * @return 0 on success.
+ */
+int32_t runScalingSuite(const std::string &program, std::map<std::string, std::string> &commandlineArguments);
+
+/**
+ * Deterministic replay benchmark: pushes the I420 ImageReadings of a
+ * recording through the encoder at recorded or maximum speed and reports
+ * the per-frame encoding time against the frame content.
+ *
+ * @return 0 on success.
+ */
+int32_t runReplaySuite(const std::string &program, std::map<std::string, std::string> &commandlineArguments);
+
+/**
+ * Parameter autotuner: evaluates combinations of encoder parameters in
+ * parallel on recorded or synthetic footage and prints the Pareto-optimal
+ * configurations for encoding time, bitrate, and PSNR as command lines.
+ *
+ * @return 0 on success.
+ */
+int32_t runTuneSuite(const std::string &program, std::map<std::string, std::string> &commandlineArguments);
+
+/**
+ * Loopback integration test: runs the encoder executable against a synthetic
+ * shared memory producer, captures the published envelopes on the OD4Session,
+ * passes them through an impairment layer (loss, reordering, duplication), and
+ * verifies frame count, timestamps, and decodability.
+ *
+ * @return 0 if all checks passed.
+ */
+int32_t runLoopbackSuite(const std::string &program, std::map<std::string, std::string> &commandlineArguments);
+
+/**
+ * Startup benchmark: measures the time to the first published frame when the
+ * encoder is started before or after the shared memory producer.
+ *
+ * @return 0 if every run published a frame.
+ */
+int32_t runStartupSuite(const std::string &program, std::map<std::string, std::string> &commandlineArguments);
+
+/**
+ * Profile switch benchmark: measures the stall from switching the encoder
+ * profile to the first encoded frame when setting up a new encoder and when
+ * taking a pre-initialized one from the encoder pool.
+ *
+ * @return 0 if every switch started with an IDR frame.
+ */
+int32_t runSwitchSuite(const std::string &program, std::map<std::string, std::string> &commandlineArguments);
+
+/**
+ * Temporal denoise benchmark: encodes a clip with added sensor noise at
+ * constant QP with and without the temporal denoiser and reports the CPU
+ * time of the filter against the bitrate it saves.
+ *
+ * @return 0 if all frames were encoded.
+ */
+int32_t runDenoiseSuite(const std::string &program, std::map<std::string, std::string> &commandlineArguments);
+
+/**
+ * GOP-parallel robustness test: stalls the encoder instances until the first
+ * frame of a GOP is dropped and verifies that every GOP is published from an
+ * IDR frame on and that the stream decodes without errors.
+ *
+ * @return 0 if all checks passed.
+ */
+int32_t runParallelSuite(const std::string &program, std::map<std::string, std::string> &commandlineArguments);
+
+/**
+ * Frame budget test: encodes a clip with an IDR frame that exceeds the budget
+ * of --frame-budget and verifies that every frame fits it and that the
+ * encoder returns to its regular QP range and frame sizes after re-encoding.
+ *
+ * @return 0 if all checks passed.
+ */
+int32_t runBudgetSuite(const std::string &program, std::map<std::string, std::string> &commandlineArguments);
+
+/**
+ * @return Microseconds of the steady clock.
+ */
+int64_t steadyMicroseconds() noexcept;
+
+/**
+ * @return Process ID of the started encoder executable (searched in PATH) or -1.
+ */
+pid_t startEncoder(const std::string &encoder, const std::vector<std::string> &arguments) noexcept;
+
+/**
+ * This function terminates the encoder executable and kills it if it does not stop within two seconds.
+ *
+ * @return CPU time in seconds used by the encoder executable.
+ */
+double stopEncoder(pid_t pid) noexcept;
+
+#endif
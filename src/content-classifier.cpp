@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "content-classifier.hpp"
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+    #define HAVE_X86_SIMD
+#endif
+
+namespace {
+
+const uint32_t BLOCK{16};
+const uint32_t MAX_PALETTE{256};
+// Slots of the hash table for the colors; at most a quarter is used.
+const uint32_t COLOR_SLOT_BITS{10};
+const uint32_t COLOR_SLOTS{1u << COLOR_SLOT_BITS};
+// Camera frames hardly have any flat blocks besides saturated areas.
+const float FLAT_BLOCK_RATIO{0.25f};
+
+uint32_t countFlatBlocksScalar(const uint8_t *row, uint32_t stride, uint32_t blocks) noexcept {
+    uint32_t flat{0};
+    for (uint32_t b{0}; b < blocks; b++) {
+        const uint8_t *block{row + b * BLOCK};
+        const uint8_t VALUE{block[0]};
+        bool isFlat{true};
+        for (uint32_t y{0}; isFlat && (y < BLOCK); y++) {
+            for (uint32_t x{0}; x < BLOCK; x++) {
+                isFlat = isFlat && (VALUE == block[y * stride + x]);
+            }
+        }
+        flat += (isFlat ? 1 : 0);
+    }
+    return flat;
+}
+
+#ifdef HAVE_X86_SIMD
+uint32_t countFlatBlocksSSE2(const uint8_t *row, uint32_t stride, uint32_t blocks) noexcept {
+    uint32_t flat{0};
+    for (uint32_t b{0}; b < blocks; b++) {
+        const uint8_t *block{row + b * BLOCK};
+        const __m128i VALUE{_mm_set1_epi8(static_cast<char>(block[0]))};
+        __m128i equal{_mm_cmpeq_epi8(VALUE, VALUE)};
+        for (uint32_t y{0}; y < BLOCK; y++) {
+            equal = _mm_and_si128(equal, _mm_cmpeq_epi8(VALUE, _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + y * stride))));
+        }
+        flat += (0xFFFF == _mm_movemask_epi8(equal)) ? 1 : 0;
+    }
+    return flat;
+}
+
+__attribute__((target("avx2")))
+uint32_t countFlatBlocksAVX2(const uint8_t *row, uint32_t stride, uint32_t blocks) noexcept {
+    uint32_t flat{0};
+    uint32_t b{0};
+    // Two neighbouring blocks per iteration.
+    for (; (b + 2) <= blocks; b += 2) {
+        const uint8_t *block{row + b * BLOCK};
+        const __m256i VALUE{_mm256_inserti128_si256(_mm256_castsi128_si256(_mm_set1_epi8(static_cast<char>(block[0]))), _mm_set1_epi8(static_cast<char>(block[BLOCK])), 1)};
+        __m256i equal{_mm256_cmpeq_epi8(VALUE, VALUE)};
+        for (uint32_t y{0}; y < BLOCK; y++) {
+            equal = _mm256_and_si256(equal, _mm256_cmpeq_epi8(VALUE, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + y * stride))));
+        }
+        const uint32_t MASK{static_cast<uint32_t>(_mm256_movemask_epi8(equal))};
+        flat += ((0xFFFFu == (MASK & 0xFFFFu)) ? 1 : 0) + ((0xFFFFu == (MASK >> 16)) ? 1 : 0);
+    }
+    return flat + countFlatBlocksScalar(row + b * BLOCK, stride, blocks - b);
+}
+#endif
+
+using CountFlatBlocks = uint32_t (*)(const uint8_t *, uint32_t, uint32_t);
+
+struct Implementation {
+    CountFlatBlocks countFlatBlocks{nullptr};
+    const char *name{nullptr};
+};
+
+Implementation selectImplementation() noexcept {
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return Implementation{countFlatBlocksAVX2, "avx2"};
+    }
+    return Implementation{countFlatBlocksSSE2, "sse2"};
+#else
+    return Implementation{countFlatBlocksScalar, "scalar"};
+#endif
+}
+
+const Implementation &selectedImplementation() noexcept {
+    static const Implementation IMPLEMENTATION{selectImplementation()};
+    return IMPLEMENTATION;
+}
+
+} // namespace
+
+ContentClassifier::ContentClassifier(uint32_t width, uint32_t height) noexcept
+    : m_width{width}
+    , m_height{height}
+    , m_colors(COLOR_SLOTS) {
+}
+
+ContentClassifier::Statistics ContentClassifier::classify(const uint8_t *planes[3], const uint32_t strides[3]) noexcept {
+    const CountFlatBlocks COUNT_FLAT_BLOCKS{selectedImplementation().countFlatBlocks};
+    const uint32_t BLOCKS_PER_ROW{m_width / BLOCK};
+    const uint32_t BLOCK_ROWS{m_height / BLOCK};
+    uint32_t flat{0};
+    for (uint32_t y{0}; y < BLOCK_ROWS; y++) {
+        flat += COUNT_FLAT_BLOCKS(planes[0] + y * BLOCK * strides[0], strides[0], BLOCKS_PER_ROW);
+    }
+
+    Statistics statistics;
+    statistics.flatBlockRatio = (0 < BLOCKS_PER_ROW * BLOCK_ROWS) ? static_cast<float>(flat) / static_cast<float>(BLOCKS_PER_ROW * BLOCK_ROWS) : 0.0f;
+    statistics.paletteSize = countColors(planes, strides);
+    statistics.screenContent = (0 < statistics.paletteSize) || (FLAT_BLOCK_RATIO <= statistics.flatBlockRatio);
+    return statistics;
+}
+
+uint32_t ContentClassifier::countColors(const uint8_t *planes[3], const uint32_t strides[3]) noexcept {
+    // Colors of the top-left luma sample with its chroma samples; the table
+    // holds color + 1 so that 0 marks a free slot.
+    std::fill(m_colors.begin(), m_colors.end(), 0);
+    uint32_t colors{0};
+    for (uint32_t y{0}; y < m_height / 2; y++) {
+        const uint8_t *Y{planes[0] + 2 * y * strides[0]};
+        const uint8_t *U{planes[1] + y * strides[1]};
+        const uint8_t *V{planes[2] + y * strides[2]};
+        uint32_t previous{0};
+        for (uint32_t x{0}; x < m_width / 2; x++) {
+            const uint32_t COLOR{((static_cast<uint32_t>(Y[2 * x]) << 16) | (static_cast<uint32_t>(U[x]) << 8) | V[x]) + 1};
+            // Screen content consists of runs of the same color.
+            if (COLOR == previous) {
+                continue;
+            }
+            previous = COLOR;
+            uint32_t slot{(COLOR * 2654435761u) >> (32 - COLOR_SLOT_BITS)};
+            while ((0 != m_colors[slot]) && (COLOR != m_colors[slot])) {
+                slot = (slot + 1) & (COLOR_SLOTS - 1);
+            }
+            if (0 == m_colors[slot]) {
+                m_colors[slot] = COLOR;
+                if (MAX_PALETTE < ++colors) {
+                    return 0;
+                }
+            }
+        }
+    }
+    return colors;
+}
+
+const char *ContentClassifier::implementation() const noexcept {
+    return selectedImplementation().name;
+}
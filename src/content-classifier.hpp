@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef CONTENT_CLASSIFIER_HPP
+#define CONTENT_CLASSIFIER_HPP
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Classifier telling screen content (e.g., simulator renders or captures of
+ * user interfaces) from camera video by two statistics of an I420 frame:
+ * the ratio of 16x16 luma blocks of a single value, which camera noise
+ * rules out, and the number of distinct colors. The blocks are compared on
+ * AVX2 or SSE2 if available.
+ */
+class ContentClassifier {
+   private:
+    ContentClassifier(const ContentClassifier &) = delete;
+    ContentClassifier(ContentClassifier &&)      = delete;
+    ContentClassifier &operator=(const ContentClassifier &) = delete;
+    ContentClassifier &operator=(ContentClassifier &&) = delete;
+
+   public:
+    struct Statistics {
+        float flatBlockRatio{0.0f};
+        uint32_t paletteSize{0}; // 0 for more than 256 colors.
+        bool screenContent{false};
+    };
+
+   public:
+    /**
+     * @param width Width of the frames.
+     * @param height Height of the frames.
+     */
+    ContentClassifier(uint32_t width, uint32_t height) noexcept;
+
+   public:
+    /**
+     * @param planes Y, U, and V planes of the frame, e.g., in the shared memory area.
+     * @param strides Strides of the Y, U, and V planes.
+     * @return Statistics of the frame and whether it is screen content.
+     */
+    Statistics classify(const uint8_t *planes[3], const uint32_t strides[3]) noexcept;
+
+    /**
+     * @return Name of the used instruction set (avx2, sse2, or scalar).
+     */
+    const char *implementation() const noexcept;
+
+   private:
+    uint32_t countColors(const uint8_t *planes[3], const uint32_t strides[3]) noexcept;
+
+   private:
+    uint32_t m_width{0};
+    uint32_t m_height{0};
+    std::vector<uint32_t> m_colors{};
+};
+
+#endif
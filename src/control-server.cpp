@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "control-server.hpp"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace {
+// Clients sending longer lines are disconnected.
+const size_t MAX_LINE_LENGTH{64 * 1024};
+}
+
+ControlServer::ControlServer(const std::string &path, std::function<std::string(const std::string &)> delegate) noexcept
+    : m_path{path}
+    , m_delegate{delegate} {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (m_path.empty() || (m_path.size() >= sizeof(address.sun_path))) {
+        std::cerr << "[ControlServer] Invalid socket path '" << m_path << "'." << std::endl;
+        return;
+    }
+    strncpy(address.sun_path, m_path.c_str(), sizeof(address.sun_path) - 1);
+
+    m_socket = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (-1 == m_socket) {
+        std::cerr << "[ControlServer] Failed to create socket: " << strerror(errno) << std::endl;
+        return;
+    }
+    // Only a stale socket of a previous instance is removed.
+    struct stat status;
+    if (0 == ::lstat(m_path.c_str(), &status)) {
+        if (!S_ISSOCK(status.st_mode)) {
+            std::cerr << "[ControlServer] '" << m_path << "' exists and is not a socket." << std::endl;
+            ::close(m_socket);
+            m_socket = -1;
+            return;
+        }
+        ::unlink(m_path.c_str());
+    }
+    if ((0 != ::bind(m_socket, reinterpret_cast<struct sockaddr*>(&address), sizeof(address))) || (0 != ::listen(m_socket, 4))) {
+        std::cerr << "[ControlServer] Failed to listen on '" << m_path << "': " << strerror(errno) << std::endl;
+        ::close(m_socket);
+        m_socket = -1;
+        return;
+    }
+    m_thread = std::thread(&ControlServer::run, this);
+}
+
+ControlServer::~ControlServer() {
+    m_stop = true;
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    if (-1 != m_socket) {
+        ::close(m_socket);
+        ::unlink(m_path.c_str());
+    }
+}
+
+bool ControlServer::isRunning() const noexcept {
+    return (-1 != m_socket) && !m_stop.load();
+}
+
+void ControlServer::run() noexcept {
+    struct Client {
+        int fd;
+        std::string pending;
+    };
+    std::vector<Client> clients;
+    std::vector<struct pollfd> pfds;
+    while (!m_stop.load()) {
+        pfds.clear();
+        pfds.push_back(pollfd{m_socket, POLLIN, 0});
+        for (auto &client : clients) {
+            pfds.push_back(pollfd{client.fd, POLLIN, 0});
+        }
+        // Regular timeout to notice a stop request.
+        if (0 >= ::poll(pfds.data(), pfds.size(), 250)) {
+            continue;
+        }
+
+        for (size_t i{1}; i < pfds.size(); i++) {
+            if (0 == pfds[i].revents) {
+                continue;
+            }
+            Client &client{clients[i - 1]};
+            char buffer[1024];
+            const ssize_t length{::read(client.fd, buffer, sizeof(buffer))};
+            if (0 >= length) {
+                ::close(client.fd);
+                client.fd = -1;
+                continue;
+            }
+            client.pending.append(buffer, static_cast<size_t>(length));
+            std::string::size_type end;
+            while (std::string::npos != (end = client.pending.find('\n'))) {
+                std::string line{client.pending.substr(0, end)};
+                client.pending.erase(0, end + 1);
+                if (!line.empty() && ('\r' == line.back())) {
+                    line.pop_back();
+                }
+                // Clients that do not read their responses are disconnected
+                // instead of blocking the other clients.
+                const std::string RESPONSE{m_delegate(line) + "\n"};
+                if (static_cast<ssize_t>(RESPONSE.size()) != ::send(client.fd, RESPONSE.c_str(), RESPONSE.size(), MSG_NOSIGNAL | MSG_DONTWAIT)) {
+                    ::close(client.fd);
+                    client.fd = -1;
+                    break;
+                }
+            }
+            if ((-1 != client.fd) && (MAX_LINE_LENGTH < client.pending.size())) {
+                const std::string RESPONSE{"ERROR line too long\n"};
+                ::send(client.fd, RESPONSE.c_str(), RESPONSE.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+                ::close(client.fd);
+                client.fd = -1;
+            }
+        }
+        for (auto it = clients.begin(); it != clients.end();) {
+            it = (-1 == it->fd) ? clients.erase(it) : it + 1;
+        }
+
+        if (0 != (pfds[0].revents & POLLIN)) {
+            const int fd{::accept4(m_socket, nullptr, nullptr, SOCK_CLOEXEC)};
+            if (-1 != fd) {
+                clients.push_back(Client{fd, ""});
+            }
+        }
+    }
+    for (auto &client : clients) {
+        ::close(client.fd);
+    }
+}
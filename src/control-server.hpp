@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CONTROL_SERVER_HPP
+#define CONTROL_SERVER_HPP
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+/**
+ * Line-based control channel on a local (Unix domain) socket: every line
+ * received from a client is passed to the delegate and its response is
+ * sent back followed by a newline. Clients sending lines longer than 64 KiB
+ * are disconnected.
+ */
+class ControlServer {
+   private:
+    ControlServer(const ControlServer &) = delete;
+    ControlServer(ControlServer &&)      = delete;
+    ControlServer &operator=(const ControlServer &) = delete;
+    ControlServer &operator=(ControlServer &&) = delete;
+
+   public:
+    /**
+     * @param path Path of the socket; an existing socket file is replaced.
+     * @param delegate Function to handle one command line and to return the response.
+     */
+    ControlServer(const std::string &path, std::function<std::string(const std::string &)> delegate) noexcept;
+    ~ControlServer();
+
+   public:
+    bool isRunning() const noexcept;
+
+   private:
+    void run() noexcept;
+
+   private:
+    std::string m_path{};
+    std::function<std::string(const std::string &)> m_delegate{};
+    int m_socket{-1};
+    std::atomic<bool> m_stop{false};
+    std::thread m_thread{};
+};
+
+#endif
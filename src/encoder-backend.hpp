@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ENCODER_BACKEND_HPP
+#define ENCODER_BACKEND_HPP
+
+#include <wels/codec_api.h>
+
+#include <cstdint>
+#include <string>
+
+/**
+ * Encoded h264 access unit; the data is owned by the encoder and remains
+ * valid until the next call to encode.
+ */
+struct AccessUnit {
+    const char *data{nullptr};
+    uint32_t size{0};
+    int32_t frameType{videoFrameTypeInvalid}; // EVideoFrameType.
+    uint32_t reencodings{0};                   // Encodings after the first one to fit the frame budget.
+    uint32_t reencodingTime{0};                // Microseconds added by the re-encodings.
+};
+
+/**
+ * Feedback of a decoder about the reference frames of an h264 stream; the
+ * frame numbers are the frame_num of the slice headers.
+ */
+struct ReferenceFeedback {
+    enum Type {
+        RECOVERY_REQUEST, // A frame after lastCorrectFrameNumber was lost.
+        MARKING_SUCCESS,  // The long-term reference frame frameNumber was decoded.
+        MARKING_FAILURE,  // The long-term reference frame frameNumber was lost.
+    };
+    Type type{RECOVERY_REQUEST};
+    uint32_t idrPictureId{0};
+    int32_t frameNumber{-1};
+    int32_t currentFrameNumber{-1};
+};
+
+/**
+ * Interface of the h264 encoder libraries behind StreamEncoder.
+ */
+class EncoderBackend {
+   public:
+    virtual ~EncoderBackend() = default;
+
+    /**
+     * @return true if the encoder was successfully initialized.
+     */
+    virtual bool valid() const noexcept = 0;
+
+    /**
+     * @return FourCC of the encoded frames for ImageReading.
+     */
+    virtual const char *fourcc() const noexcept = 0;
+
+    /**
+     * @return Target bitrate in bit/s.
+     */
+    virtual int32_t targetBitrate() const noexcept = 0;
+
+    /**
+     * @return Effective encoder parameters in one line (empty if not applicable).
+     */
+    virtual std::string configuration() const noexcept {
+        return "";
+    }
+
+    /**
+     * This method requests the next frame to be encoded as IDR frame.
+     */
+    virtual void forceIntraFrame() noexcept = 0;
+
+    /**
+     * This method lets the encoder recover from a loss reported by a decoder;
+     * encoders without long-term reference frames encode an IDR frame.
+     *
+     * @param feedback Feedback of the decoder.
+     */
+    virtual void feedback(const ReferenceFeedback &feedback) noexcept {
+        if (ReferenceFeedback::RECOVERY_REQUEST == feedback.type) {
+            forceIntraFrame();
+        }
+    }
+
+    /**
+     * This method re-initializes the encoder for the given type of content
+     * if it differs from the current one; the next frame is an IDR frame.
+     *
+     * @param screenContent The frames are screen content (e.g., simulator renders) instead of camera video.
+     * @return true if the encoder is set up for the given type of content.
+     */
+    virtual bool setScreenContent(bool screenContent) noexcept {
+        return !screenContent;
+    }
+
+    /**
+     * @return true if coarsenNextFrame is implemented, i.e., the backend can enforce a frame budget.
+     */
+    virtual bool supportsCoarsening() const noexcept {
+        return false;
+    }
+
+    /**
+     * This method makes the encoder encode the next frame as IDR frame with a
+     * QP that is higher by the given steps than the one of the last frame,
+     * e.g., to encode a frame again that exceeded its byte budget; the encoder
+     * returns to its regular QP range with the frame after it.
+     *
+     * @param steps QP steps to add (six steps roughly halve the frame size).
+     * @return true if the next frame is encoded with a higher QP.
+     */
+    virtual bool coarsenNextFrame(uint32_t /*steps*/) noexcept {
+        return false;
+    }
+
+    /**
+     * @param planes Y, U, and V planes of the frame.
+     * @param strides Strides of the Y, U, and V planes.
+     * @param accessUnit Encoded frame; its size is 0 for skipped frames.
+     * @param timeStamp Timestamp of the frame in milliseconds.
+     * @return true if the frame was encoded or skipped without errors.
+     */
+    virtual bool encode(const uint8_t *planes[3], const uint32_t strides[3], AccessUnit &accessUnit, int64_t timeStamp) noexcept = 0;
+};
+
+#endif
@@ -0,0 +1,325 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "encoder-daemon.hpp"
+#include "encoder-parameters.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+EncoderDaemon::EncoderDaemon(const std::map<std::string, std::string> &defaults, uint32_t poolCapacity, bool verbose) noexcept
+    : m_defaults{defaults}
+    , m_verbose{verbose}
+    , m_pool{poolCapacity} {
+    if (m_defaults["profiles"].size() != 0) {
+        for (auto &profile : loadNamedArguments(m_defaults["profiles"])) {
+            m_profiles[profile.first] = getCommandlineArgumentsFromString(profile.second);
+        }
+        std::clog << "Loaded " << m_profiles.size() << " profile(s) from '" << m_defaults["profiles"] << "'." << std::endl;
+    }
+}
+
+EncoderDaemon::~EncoderDaemon() {
+    std::lock_guard<std::mutex> lck(m_streamsMutex);
+    while (!m_streams.empty()) {
+        remove(m_streams.begin()->first);
+    }
+}
+
+std::string EncoderDaemon::handle(const std::string &command) noexcept {
+    std::vector<std::string> tokens{splitString(command, ' ')};
+    if (tokens.empty()) {
+        return "ERROR empty command";
+    }
+    const std::string VERB{tokens[0]};
+    const std::string STREAM{(1 < tokens.size()) ? tokens[1] : ""};
+    std::string rest;
+    for (size_t i{2}; i < tokens.size(); i++) {
+        rest += tokens[i] + " ";
+    }
+    std::map<std::string, std::string> arguments{getCommandlineArgumentsFromString(rest)};
+
+    std::lock_guard<std::mutex> lck(m_streamsMutex);
+    if ("list" == VERB) {
+        std::stringstream sstr;
+        for (auto &entry : m_streams) {
+            EncodingStream &s{*entry.second.stream};
+            sstr << entry.first << ": name=" << s.name() << " id=" << s.senderStamp() << " attached=" << (s.isAttached() ? "yes" : "no")
+                 << " frames=" << s.frames() << " bytes=" << s.bytes() << std::endl;
+        }
+        sstr << "OK " << m_streams.size() << " stream(s), " << m_pool.idle() << " idle encoder(s)";
+        return sstr.str();
+    }
+    if (("add" != VERB) && ("modify" != VERB) && ("remove" != VERB) && ("profile" != VERB)) {
+        return "ERROR unknown command '" + VERB + "'";
+    }
+    if (STREAM.empty()) {
+        return "ERROR missing stream for '" + VERB + "'";
+    }
+    auto it = m_streams.find(STREAM);
+    if ("add" == VERB) {
+        if (m_streams.end() != it) {
+            return "ERROR stream '" + STREAM + "' exists";
+        }
+        std::map<std::string, std::string> merged{m_defaults};
+        for (auto &argument : arguments) {
+            merged[argument.first] = argument.second;
+        }
+        return add(STREAM, merged);
+    }
+    if (m_streams.end() == it) {
+        return "ERROR unknown stream '" + STREAM + "'";
+    }
+    if ("profile" == VERB) {
+        return switchProfile(it->second, (2 < tokens.size()) ? tokens[2] : "");
+    }
+    if ("modify" == VERB) {
+        const std::map<std::string, std::string> PREVIOUS{it->second.arguments};
+        std::map<std::string, std::string> merged{PREVIOUS};
+        for (auto &argument : arguments) {
+            merged[argument.first] = argument.second;
+        }
+        remove(STREAM);
+        const std::string RESPONSE{add(STREAM, merged)};
+        if (0 != RESPONSE.find("OK")) {
+            // Keep the stream running with its previous configuration.
+            add(STREAM, PREVIOUS);
+        }
+        return RESPONSE;
+    }
+    remove(STREAM);
+    return "OK";
+}
+
+std::string EncoderDaemon::add(const std::string &stream, std::map<std::string, std::string> arguments) noexcept {
+    if ((0 == arguments["name"].size()) || (0 == arguments["width"].size()) || (0 == arguments["height"].size()) || (0 == arguments["cid"].size())) {
+        return "ERROR --name, --width, --height, and --cid are required";
+    }
+    if ((0 != arguments.count("failover")) || (0 != arguments.count("standby"))) {
+        return "ERROR --failover and --standby are not supported for daemon streams";
+    }
+    uint32_t width{0};
+    uint32_t height{0};
+    uint16_t cid{0};
+    uint32_t id{0};
+    uint32_t timeout{0};
+    uint32_t instances{1};
+    uint32_t gop{10};
+    uint32_t temporalDenoise{0};
+    int32_t maskRadius{16};
+    try {
+        width = static_cast<uint32_t>(std::stoi(arguments["width"]));
+        height = static_cast<uint32_t>(std::stoi(arguments["height"]));
+        cid = static_cast<uint16_t>(std::stoi(arguments["cid"]));
+        id = (arguments["id"].size() != 0) ? static_cast<uint32_t>(std::stoi(arguments["id"])) : 0;
+        timeout = (arguments["timeout"].size() != 0) ? static_cast<uint32_t>(std::stoi(arguments["timeout"])) : 0;
+        instances = (arguments["gop-parallel"].size() != 0) ? std::max(static_cast<uint32_t>(std::stoi(arguments["gop-parallel"])), 1u) : 1;
+        gop = (arguments["gop"].size() != 0) ? static_cast<uint32_t>(std::stoi(arguments["gop"])) : gop;
+        temporalDenoise = (arguments["temporal-denoise"].size() != 0) ? static_cast<uint32_t>(std::max(std::stoi(arguments["temporal-denoise"]), 0)) : 0;
+        maskRadius = (arguments["mask-radius"].size() != 0) ? std::stoi(arguments["mask-radius"]) : maskRadius;
+    }
+    catch (...) {
+        return "ERROR invalid argument";
+    }
+    if ((1 > maskRadius) || (32 < maskRadius)) {
+        return "ERROR --mask-radius must be between 1 and 32";
+    }
+
+    if ((arguments["profile"].size() != 0) && (0 == m_profiles.count(arguments["profile"]))) {
+        return "ERROR unknown profile '" + arguments["profile"] + "'";
+    }
+
+    std::vector<RegionOfInterest> regions;
+    if ((arguments["roi"].size() != 0) && !parseRegionsOfInterest(arguments["roi"], width, height, regions)) {
+        return "ERROR invalid regions of interest '" + arguments["roi"] + "'";
+    }
+    std::vector<MaskPolygon> masks;
+    if ((arguments["mask"].size() != 0) && !parseMaskPolygons(arguments["mask"], width, height, masks)) {
+        return "ERROR invalid privacy masks '" + arguments["mask"] + "'";
+    }
+    std::vector<EncodingVariant> variants;
+    if ((arguments["variants"].size() != 0) && !parseEncodingVariants(arguments["variants"], variants)) {
+        return "ERROR invalid variants '" + arguments["variants"] + "'";
+    }
+    for (auto &variant : variants) {
+        if (0 == m_profiles.count(variant.profile)) {
+            return "ERROR unknown profile '" + variant.profile + "'";
+        }
+    }
+    // The variants replace the full frame encoded with the stream's arguments.
+    const bool ROI_ONLY{((arguments.count("roi-only") != 0) && !regions.empty()) || !variants.empty()};
+
+    const std::map<std::string, std::string> encoderArguments{encoderArgumentsOf(arguments)};
+    Stream entry;
+    entry.arguments = arguments;
+    entry.width = width;
+    entry.height = height;
+    entry.encoderKey = EncoderPool::keyOf(width, height, encoderArguments);
+    std::vector<std::unique_ptr<StreamEncoder>> encoders;
+    for (uint32_t i{0}; !ROI_ONLY && (i < instances); i++) {
+        encoders.push_back(m_pool.acquire(width, height, encoderArguments, m_verbose));
+        if (!encoders.back()->valid()) {
+            return "ERROR failed to set up " + encoders.back()->backend() + " encoder";
+        }
+    }
+    const std::string CONFIGURATION{encoders.empty() ? "" : encoders[0]->configuration()};
+    std::shared_ptr<cluon::OD4Session> od4{sessionFor(cid)};
+    if (ROI_ONLY) {
+        entry.stream.reset(new EncodingStream(arguments["name"], width, height, od4, m_verbose));
+    }
+    else if (1 < instances) {
+        entry.stream.reset(new EncodingStream(arguments["name"], id, std::move(encoders), gop, od4, m_verbose));
+    }
+    else {
+        entry.stream.reset(new EncodingStream(arguments["name"], id, std::move(encoders[0]), od4, m_verbose));
+    }
+    for (auto &variant : variants) {
+        std::map<std::string, std::string> variantArguments{arguments};
+        variantArguments["profile"] = variant.profile;
+        RegionOfInterest frame;
+        frame.width = width;
+        frame.height = height;
+        frame.senderStamp = variant.senderStamp;
+        const std::map<std::string, std::string> VARIANT_ARGUMENTS{encoderArgumentsOf(variantArguments)};
+        if (!entry.stream->addRegion(frame, m_pool.acquire(width, height, VARIANT_ARGUMENTS, m_verbose), sessionFor((0 != variant.cid) ? variant.cid : cid))) {
+            return "ERROR failed to set up encoder for variant '" + variant.profile + "'";
+        }
+        entry.regionKeys.push_back(EncoderPool::keyOf(width, height, VARIANT_ARGUMENTS));
+    }
+    for (auto &region : regions) {
+        if (!entry.stream->addRegion(region, m_pool.acquire(region.width, region.height, encoderArguments, m_verbose))) {
+            return "ERROR failed to set up encoder for region with senderStamp " + std::to_string(region.senderStamp);
+        }
+        entry.regionKeys.push_back(EncoderPool::keyOf(region.width, region.height, encoderArguments));
+    }
+    if (!masks.empty()) {
+        entry.stream->setPrivacyMasks(masks, "fill" != arguments["mask-style"], static_cast<uint32_t>(maskRadius));
+    }
+    if (arguments["temporal-denoise"].size() != 0) {
+        entry.stream->setTemporalDenoise(temporalDenoise);
+    }
+    // The usage type might be given by the profile.
+    auto usage = encoderArguments.find("usage");
+    if ((encoderArguments.end() != usage) && ("auto" == usage->second)) {
+        entry.stream->setContentDetection();
+    }
+    entry.stream->start(timeout);
+    m_dispatchers[cid]->add(entry.stream.get());
+    for (auto &variant : variants) {
+        m_dispatchers[(0 != variant.cid) ? variant.cid : cid]->add(entry.stream.get());
+    }
+    m_streams[stream] = std::move(entry);
+    std::clog << "Added stream '" << stream << "' from '" << arguments["name"] << "' (" << width << "x" << height << ") to CID " << cid << "." << std::endl;
+    if (!CONFIGURATION.empty()) {
+        std::clog << "Effective configuration of '" << stream << "': " << CONFIGURATION << std::endl;
+    }
+
+    // Keep an encoder warm for every other profile to switch without stalling.
+    if ((1 == instances) && regions.empty() && variants.empty()) {
+        for (auto &profile : m_profiles) {
+            if (profile.first != arguments["profile"]) {
+                std::map<std::string, std::string> profileArguments{arguments};
+                profileArguments["profile"] = profile.first;
+                if (!m_pool.prewarm(width, height, encoderArgumentsOf(profileArguments), m_verbose)) {
+                    std::cerr << "Failed to prepare an encoder for profile '" << profile.first << "' of stream '" << stream << "'." << std::endl;
+                }
+            }
+        }
+    }
+    return "OK";
+}
+
+std::string EncoderDaemon::switchProfile(Stream &entry, const std::string &profile) noexcept {
+    if (0 == m_profiles.count(profile)) {
+        return "ERROR unknown profile '" + profile + "'";
+    }
+    std::map<std::string, std::string> arguments{entry.arguments};
+    if ((arguments["roi"].size() != 0) || (arguments["variants"].size() != 0)) {
+        return "ERROR streams with regions of interest or variants need 'modify <stream> --profile=" + profile + "'";
+    }
+    arguments["profile"] = profile;
+    const std::map<std::string, std::string> ENCODER_ARGUMENTS{encoderArgumentsOf(arguments)};
+    const std::string KEY{EncoderPool::keyOf(entry.width, entry.height, ENCODER_ARGUMENTS)};
+    if (KEY == entry.encoderKey) {
+        entry.arguments = arguments;
+        return "OK";
+    }
+
+    const cluon::data::TimeStamp BEFORE{cluon::time::now()};
+    std::unique_ptr<StreamEncoder> encoder{m_pool.acquire(entry.width, entry.height, ENCODER_ARGUMENTS, m_verbose)};
+    if (!encoder->valid()) {
+        return "ERROR failed to set up " + encoder->backend() + " encoder";
+    }
+    const StreamEncoder *NEXT{encoder.get()};
+    std::unique_ptr<StreamEncoder> previous{entry.stream->swapEncoder(std::move(encoder))};
+    const cluon::data::TimeStamp AFTER{cluon::time::now()};
+    if (NEXT == previous.get()) {
+        m_pool.release(KEY, std::move(previous));
+        return "ERROR streams encoding GOPs in parallel need 'modify <stream> --profile=" + profile + "'";
+    }
+    // The encoder of the previous profile is kept warm to switch back.
+    m_pool.release(entry.encoderKey, std::move(previous));
+    entry.encoderKey = KEY;
+    entry.arguments = arguments;
+
+    std::stringstream sstr;
+    sstr << "OK switched to '" << profile << "' within " << cluon::time::deltaInMicroseconds(AFTER, BEFORE) << " microseconds";
+    return sstr.str();
+}
+
+std::map<std::string, std::string> EncoderDaemon::encoderArgumentsOf(std::map<std::string, std::string> arguments) const noexcept {
+    auto profile = m_profiles.find(arguments["profile"]);
+    if (m_profiles.end() != profile) {
+        for (auto &argument : profile->second) {
+            arguments[argument.first] = argument.second;
+        }
+    }
+    // Only the encoder arguments distinguish pooled encoders.
+    for (auto key : {"name", "width", "height", "cid", "id", "timeout", "verbose", "control", "pool", "gop-parallel", "profiles", "profile", "roi", "roi-only", "variants", "temporal-denoise", "mask", "mask-style", "mask-radius"}) {
+        arguments.erase(key);
+    }
+    return arguments;
+}
+
+void EncoderDaemon::remove(const std::string &stream) noexcept {
+    auto it = m_streams.find(stream);
+    if (m_streams.end() != it) {
+        for (auto &dispatcher : m_dispatchers) {
+            dispatcher.second->remove(it->second.stream.get());
+        }
+        // The encoders of the regions follow the ones of the full frame.
+        std::vector<std::unique_ptr<StreamEncoder>> encoders{it->second.stream->releaseEncoders()};
+        const std::vector<std::string> &REGION_KEYS{it->second.regionKeys};
+        const size_t FULL_FRAME{encoders.size() - std::min(encoders.size(), REGION_KEYS.size())};
+        for (size_t i{0}; i < encoders.size(); i++) {
+            m_pool.release((i < FULL_FRAME) ? it->second.encoderKey : REGION_KEYS[i - FULL_FRAME], std::move(encoders[i]));
+        }
+        m_streams.erase(it);
+        std::clog << "Removed stream '" << stream << "'." << std::endl;
+    }
+}
+
+std::shared_ptr<cluon::OD4Session> EncoderDaemon::sessionFor(uint16_t cid) noexcept {
+    std::shared_ptr<cluon::OD4Session> &od4{m_sessions[cid]};
+    if (!od4) {
+        od4 = std::make_shared<cluon::OD4Session>(cid);
+        m_dispatchers[cid].reset(new FeedbackDispatcher(od4, m_verbose));
+    }
+    return od4;
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ENCODER_DAEMON_HPP
+#define ENCODER_DAEMON_HPP
+
+#include "cluon-complete.hpp"
+#include "encoder-pool.hpp"
+#include "encoding-stream.hpp"
+#include "feedback-dispatcher.hpp"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Encoder for several streams that are added, modified, and removed at
+ * runtime with the following commands:
+ *
+ *   add <stream> --name=<shared memory> --width=<width> --height=<height> [--cid=<cid>] [--id=<senderStamp>] [--gop-parallel=<instances>] [--roi=<regions> [--roi-only]] [--variants=<variants>] [--temporal-denoise=<threshold>] [--mask=<masks> [--mask-style=blur|fill] [--mask-radius=<radius>]] [encoder arguments]
+ *   modify <stream> [arguments to change]
+ *   remove <stream>
+ *   profile <stream> <profile>
+ *   list
+ *
+ * With --profiles=<file> (one "<name>: <encoder arguments>" per line), a
+ * stream is started with the arguments of --profile=<name> and an encoder is
+ * kept warm for each other profile, so that switching the profile swaps the
+ * encoder at the next frame boundary instead of restarting the stream.
+ *
+ * The responses end with a line starting with "OK" or "ERROR".
+ */
+class EncoderDaemon {
+   private:
+    EncoderDaemon(const EncoderDaemon &) = delete;
+    EncoderDaemon(EncoderDaemon &&)      = delete;
+    EncoderDaemon &operator=(const EncoderDaemon &) = delete;
+    EncoderDaemon &operator=(EncoderDaemon &&) = delete;
+
+   public:
+    /**
+     * @param defaults Arguments applying to all streams unless given per stream (e.g., --cid, --bitrate).
+     * @param poolCapacity Maximum number of idle encoders to keep.
+     * @param verbose Print information about every frame.
+     */
+    EncoderDaemon(const std::map<std::string, std::string> &defaults, uint32_t poolCapacity, bool verbose) noexcept;
+    ~EncoderDaemon();
+
+   public:
+    /**
+     * @param command Command line as listed above.
+     * @return Response.
+     */
+    std::string handle(const std::string &command) noexcept;
+
+   private:
+    struct Stream {
+        std::map<std::string, std::string> arguments{};
+        uint32_t width{0};
+        uint32_t height{0};
+        std::string encoderKey{};
+        std::vector<std::string> regionKeys{}; // In the order of EncodingStream::addRegion.
+        std::unique_ptr<EncodingStream> stream{};
+    };
+
+    std::string add(const std::string &stream, std::map<std::string, std::string> arguments) noexcept;
+    std::string switchProfile(Stream &entry, const std::string &profile) noexcept;
+    std::map<std::string, std::string> encoderArgumentsOf(std::map<std::string, std::string> arguments) const noexcept;
+    void remove(const std::string &stream) noexcept;
+    std::shared_ptr<cluon::OD4Session> sessionFor(uint16_t cid) noexcept;
+
+   private:
+    std::map<std::string, std::string> m_defaults{};
+    bool m_verbose{false};
+    std::map<std::string, std::map<std::string, std::string>> m_profiles{};
+    EncoderPool m_pool;
+
+    std::mutex m_streamsMutex{};
+    std::map<std::string, Stream> m_streams{};
+    std::map<uint16_t, std::shared_ptr<cluon::OD4Session>> m_sessions{};
+    std::map<uint16_t, std::unique_ptr<FeedbackDispatcher>> m_dispatchers{};
+};
+
+#endif
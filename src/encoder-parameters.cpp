@@ -0,0 +1,477 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cluon-complete.hpp"
+#include "encoder-parameters.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+// ITU-T H.264, Table A-1; the bitrates and buffer sizes are for the
+// baseline and main profiles in 1000 bit/s and 1000 bit, respectively.
+struct H264Level {
+    uint32_t levelIdc;
+    uint32_t maxMacroblocksPerSecond;
+    uint32_t maxFrameSize; // Macroblocks.
+    uint32_t maxDpbMacroblocks;
+    uint32_t maxBitrate;
+    uint32_t maxCpbSize;
+};
+
+const H264Level H264_LEVELS[]{
+    {10, 1485, 99, 396, 64, 175},
+    {9, 1485, 99, 396, 128, 350}, // 1b
+    {11, 3000, 396, 900, 192, 500},
+    {12, 6000, 396, 2376, 384, 1000},
+    {13, 11880, 396, 2376, 768, 2000},
+    {20, 11880, 396, 2376, 2000, 2000},
+    {21, 19800, 792, 4752, 4000, 4000},
+    {22, 20250, 1620, 8100, 4000, 4000},
+    {30, 40500, 1620, 8100, 10000, 10000},
+    {31, 108000, 3600, 18000, 14000, 14000},
+    {32, 216000, 5120, 20480, 20000, 20000},
+    {40, 245760, 8192, 32768, 20000, 25000},
+    {41, 245760, 8192, 32768, 50000, 62500},
+    {42, 522240, 8704, 34816, 50000, 62500},
+    {50, 589824, 22080, 110400, 135000, 135000},
+    {51, 983040, 36864, 184320, 240000, 240000},
+    {52, 2073600, 36864, 184320, 240000, 240000},
+};
+
+const H264Level *findLevel(uint32_t levelIdc) noexcept {
+    for (auto &level : H264_LEVELS) {
+        if (levelIdc == level.levelIdc) {
+            return &level;
+        }
+    }
+    return nullptr;
+}
+
+// The width and height of a level are limited to sqrt(8 * MaxFS) macroblocks each.
+bool fitsLevel(const H264Level &level, uint32_t width, uint32_t height, float fps) noexcept {
+    const uint32_t WIDTH_MBS{(width + 15) / 16};
+    const uint32_t HEIGHT_MBS{(height + 15) / 16};
+    return (WIDTH_MBS * HEIGHT_MBS <= level.maxFrameSize)
+        && (WIDTH_MBS * WIDTH_MBS <= 8 * level.maxFrameSize)
+        && (HEIGHT_MBS * HEIGHT_MBS <= 8 * level.maxFrameSize)
+        && (static_cast<double>(WIDTH_MBS * HEIGHT_MBS) * fps <= static_cast<double>(level.maxMacroblocksPerSecond));
+}
+
+// cpbBrVclFactor of Table A-2.
+uint32_t bitrateFactor(uint32_t profileIdc) noexcept {
+    return (PRO_HIGH == profileIdc) ? 1250 : 1000;
+}
+
+std::string levelName(uint32_t levelIdc) {
+    if (9 == levelIdc) {
+        return "1b";
+    }
+    return std::to_string(levelIdc / 10) + ((0 != (levelIdc % 10)) ? "." + std::to_string(levelIdc % 10) : "");
+}
+
+std::string profileName(uint32_t profileIdc) {
+    switch (profileIdc) {
+        case PRO_BASELINE: return "baseline";
+        case PRO_MAIN: return "main";
+        case PRO_HIGH: return "high";
+    }
+    return std::to_string(profileIdc);
+}
+
+} // namespace
+
+void setEncoderParameters(ISVCEncoder *encoder, std::map<std::string, std::string> &commandlineArguments, uint32_t width, uint32_t height, SEncParamExt &parameters) {
+    const uint32_t GOP_DEFAULT{10};
+    const uint32_t GOP{(commandlineArguments["gop"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["gop"])) : GOP_DEFAULT};
+    // The frames are triggered by the shared memory; the frame rate only matters for the rate control and the level.
+    const float FPS_DEFAULT{20.0f};
+    const float FPS{(commandlineArguments["fps"].size() != 0) ? std::max(std::stof(commandlineArguments["fps"]), 1.0f) : FPS_DEFAULT};
+    const uint32_t BITRATE_MIN{100000};
+    const uint32_t BITRATE_DEFAULT{1500000};
+    const uint32_t REQUESTED_BITRATE{(commandlineArguments["bitrate"].size() != 0) ? std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["bitrate"])), BITRATE_MIN) : BITRATE_DEFAULT};
+    const uint32_t REQUESTED_BITRATE_MAX{(commandlineArguments["bitrate-max"].size() != 0) ? std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["bitrate-max"])), BITRATE_MIN) : 0};
+    // CABAC needs the main or the high profile.
+    const std::string PROFILE{(commandlineArguments["h264-profile"].size() != 0) ? commandlineArguments["h264-profile"] : (("1" == commandlineArguments["entropy-coding"]) ? "high" : "baseline")};
+    EncoderLimits limits;
+    if (!deriveEncoderLimits(width, height, FPS, std::max(REQUESTED_BITRATE, REQUESTED_BITRATE_MAX), commandlineArguments["level"], PROFILE, limits)) {
+        std::stringstream sstr;
+        sstr << "no H.264 level " << ((commandlineArguments["level"].size() != 0) ? commandlineArguments["level"] + " " : "") << "of the " << PROFILE << " profile allows " << width << "x" << height << " at " << FPS << " fps";
+        throw std::invalid_argument(sstr.str());
+    }
+    const uint32_t BITRATE_MAX{limits.maxBitrate};
+    const uint32_t BITRATE{std::min(REQUESTED_BITRATE, BITRATE_MAX)};
+
+    //Thesis constants
+    const uint32_t ZERO{0};
+    const uint32_t ONE{1};
+    const uint32_t TWO{2};
+    const uint32_t THREE{3};
+    const uint32_t FOUR{4};
+    const uint32_t RC_MODE{(commandlineArguments["rc-mode"].size() != 0) ? std::min(std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["rc-mode"])), ZERO), FOUR): 0}; // RC_MODES::RC_QUALITY_MODE
+    const uint32_t ECOMPLEXITY{(commandlineArguments["ecomplexity"].size() != 0) ? std::min(std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["ecomplexity"])), ZERO), TWO): 0}; // ECOMPLEXITY_MODE::LOW_COMPLEXITY
+    // Validated against the level's decoded picture buffer below instead of being clamped silently.
+    const uint32_t I_NUM_REF_FRAME{(commandlineArguments["num-ref-frame"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["num-ref-frame"])) : 1};
+    const uint32_t SPS_PPS_STRATEGY{(commandlineArguments["sps-pps"].size() != 0) ? std::min(std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["sps-pps"])), ZERO), THREE): 0}; //EParameterSetStrategy::CONSTANT_ID
+    const uint32_t B_PREFIX_NAL{(commandlineArguments["prefix-nal"].size() != 0) ? std::min(std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["prefix-nal"])), ZERO), ONE): 0};
+    const uint32_t B_SSEI{(commandlineArguments["ssei"].size() != 0) ? std::min(std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["ssei"])), ZERO), ONE): 0};
+    const uint32_t I_PADDING{(commandlineArguments["padding"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["padding"])) : 0};
+    const uint32_t I_ENTROPY_CODING{(commandlineArguments["entropy-coding"].size() != 0) ? std::min(std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["entropy-coding"])), ZERO), ONE): 0};
+    const uint32_t B_FRAME_SKIP{(commandlineArguments["frame-skip"].size() != 0) ? std::min(std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["frame-skip"])), ZERO), ONE): 1};
+    const uint32_t I_BITRATE_MAX{(0 != REQUESTED_BITRATE_MAX) ? std::min(REQUESTED_BITRATE_MAX, BITRATE_MAX) : BITRATE_MAX};
+    const uint32_t QP_MIN{0};
+    const uint32_t QP_MAX{51};
+    const uint32_t I_MAX_QP{(commandlineArguments["qp-max"].size() != 0) ? std::min(std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["qp-max"])), QP_MIN), QP_MAX): 42};
+    const uint32_t I_MIN_QP{(commandlineArguments["qp-min"].size() != 0) ? std::min(std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["qp-min"])), QP_MIN), QP_MAX): 12};
+    const uint32_t B_LONG_TERM_REFERENCE{(commandlineArguments["long-term-ref"].size() != 0) ? std::min(std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["long-term-ref"])), ZERO), ONE): 0};
+    const uint32_t I_LOOP_FILTER{(commandlineArguments["loop-filter"].size() != 0) ? std::min(std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["loop-filter"])), ZERO), TWO): 0};
+    const uint32_t B_DENOISE{(commandlineArguments["denoise"].size() != 0) ? std::min(std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["denoise"])), ZERO), ONE): 0};
+    const uint32_t B_BACKGROUND_DETECTION{(commandlineArguments["background-detection"].size() != 0) ? std::min(std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["background-detection"])), ZERO), ONE): 1};
+    const uint32_t B_ADAPTIVE_QUANT{(commandlineArguments["adaptive-quant"].size() != 0) ? std::min(std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["adaptive-quant"])), ZERO), ONE): 1};
+    const uint32_t B_FRAME_CROPPING{(commandlineArguments["frame-cropping"].size() != 0) ? std::min(std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["frame-cropping"])), ZERO), ONE): 1};
+    const uint32_t B_SCENE_CHANGE_DETECT{(commandlineArguments["scene-change-detect"].size() != 0) ? std::min(std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["scene-change-detect"])), ZERO), ONE): 1};
+    const uint32_t I_MULTIPLE_THREADS{(commandlineArguments["threads"].size() != 0) ? std::min(std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["threads"])), ZERO), FOUR): 1};
+
+    memset(&parameters, 0, sizeof(SEncParamBase));
+    encoder->GetDefaultParams(&parameters);
+
+    parameters.fMaxFrameRate = FPS;
+    // With --usage=auto, the stream selects the usage type from the first frame.
+    parameters.iUsageType = ("screen" == commandlineArguments["usage"]) ? EUsageType::SCREEN_CONTENT_REAL_TIME : EUsageType::CAMERA_VIDEO_REAL_TIME;
+    parameters.iPicWidth = width;
+    parameters.iPicHeight = height;
+    parameters.uiIntraPeriod = GOP;
+    parameters.iTargetBitrate = BITRATE;
+    parameters.iSpatialLayerNum = 1;
+    parameters.iTemporalLayerNum = 1;
+    parameters.iLtrMarkPeriod = 30;
+    parameters.iMultipleThreadIdc = I_MULTIPLE_THREADS; // 1 = disable multi threads.
+
+    parameters.sSpatialLayers[0].iVideoWidth = parameters.iPicWidth;
+    parameters.sSpatialLayers[0].iVideoHeight = parameters.iPicHeight;
+    parameters.sSpatialLayers[0].fFrameRate = parameters.fMaxFrameRate;
+    parameters.sSpatialLayers[0].iSpatialBitrate = parameters.iTargetBitrate;
+    parameters.sSpatialLayers[0].iMaxSpatialBitrate = I_BITRATE_MAX;
+    parameters.sSpatialLayers[0].sSliceArgument.uiSliceMode = SliceModeEnum::SM_SIZELIMITED_SLICE;
+    parameters.sSpatialLayers[0].sSliceArgument.uiSliceNum = 1;
+    parameters.sSpatialLayers[0].uiProfileIdc = static_cast<EProfileIdc>(limits.profileIdc);
+    parameters.sSpatialLayers[0].uiLevelIdc = static_cast<ELevelIdc>(limits.levelIdc);
+
+    /*
+     * Thesis parameters
+     * https://github.com/cisco/openh264/wiki/TypesAndStructures
+     * https://github.com/cisco/openh264/blob/master/codec/encoder/core/inc/param_svc.h#L132
+     */
+    if (I_NUM_REF_FRAME == 0) {
+        parameters.iNumRefFrame = AUTO_REF_PIC_COUNT;
+    }
+    else {
+        parameters.iNumRefFrame = I_NUM_REF_FRAME;
+    }
+    parameters.bPrefixNalAddingCtrl = B_PREFIX_NAL;
+    parameters.bEnableSSEI = B_SSEI;
+    parameters.iPaddingFlag = I_PADDING;
+    parameters.iEntropyCodingModeFlag = I_ENTROPY_CODING;
+    parameters.bEnableFrameSkip = B_FRAME_SKIP;
+    parameters.iMaxBitrate = I_BITRATE_MAX;
+    parameters.iMaxQp = I_MAX_QP;
+    parameters.iMinQp = I_MIN_QP;
+    parameters.bEnableLongTermReference = B_LONG_TERM_REFERENCE;
+    parameters.iLoopFilterDisableIdc = I_LOOP_FILTER;
+    parameters.bEnableDenoise = B_DENOISE;
+    parameters.bEnableBackgroundDetection = B_BACKGROUND_DETECTION;
+    parameters.bEnableAdaptiveQuant = B_ADAPTIVE_QUANT;
+    parameters.bEnableFrameCroppingFlag = B_FRAME_CROPPING;
+    parameters.bEnableSceneChangeDetect = B_SCENE_CHANGE_DETECT;
+
+    switch (RC_MODE) {
+        case 0: { parameters.iRCMode = RC_MODES::RC_QUALITY_MODE; break; }
+        case 1: { parameters.iRCMode = RC_MODES::RC_BITRATE_MODE; break; }
+        case 2: { parameters.iRCMode = RC_MODES::RC_BUFFERBASED_MODE; break; }
+        case 3: { parameters.iRCMode = RC_MODES::RC_TIMESTAMP_MODE; break; }
+        case 4: { parameters.iRCMode = RC_MODES::RC_OFF_MODE; break; }
+    }
+
+    switch (SPS_PPS_STRATEGY) {
+        case 0: { parameters.eSpsPpsIdStrategy = EParameterSetStrategy::CONSTANT_ID; break; }
+        case 1: { parameters.eSpsPpsIdStrategy = EParameterSetStrategy::INCREASING_ID; break; }
+        case 2: { parameters.eSpsPpsIdStrategy = EParameterSetStrategy::SPS_LISTING; break; }
+        case 3: { parameters.eSpsPpsIdStrategy = EParameterSetStrategy::SPS_LISTING_AND_PPS_INCREASING; break; }
+    }
+
+    switch (ECOMPLEXITY) {
+        case 0: { parameters.iComplexityMode = ECOMPLEXITY_MODE::LOW_COMPLEXITY;; break; }
+        case 1: { parameters.iComplexityMode = ECOMPLEXITY_MODE::MEDIUM_COMPLEXITY; break; }
+        case 2: { parameters.iComplexityMode = ECOMPLEXITY_MODE::HIGH_COMPLEXITY; break; }
+    }
+
+    // Contradicting arguments are rejected instead of letting openh264 fail without reason.
+    const std::string PROBLEM{validateEncoderParameters(parameters, limits)};
+    if (!PROBLEM.empty()) {
+        throw std::invalid_argument(PROBLEM);
+    }
+}
+
+bool deriveEncoderLimits(uint32_t width, uint32_t height, float fps, uint32_t bitrate, const std::string &level, const std::string &profile, EncoderLimits &limits) noexcept {
+    if ("baseline" == profile) {
+        limits.profileIdc = PRO_BASELINE;
+    }
+    else if ("main" == profile) {
+        limits.profileIdc = PRO_MAIN;
+    }
+    else if ("high" == profile) {
+        limits.profileIdc = PRO_HIGH;
+    }
+    else {
+        return false;
+    }
+    const uint32_t FACTOR{bitrateFactor(limits.profileIdc)};
+
+    const H264Level *selected{nullptr};
+    if (level.empty() || ("auto" == level)) {
+        for (auto &candidate : H264_LEVELS) {
+            if (fitsLevel(candidate, width, height, fps) && (static_cast<uint64_t>(bitrate) <= static_cast<uint64_t>(candidate.maxBitrate) * FACTOR)) {
+                selected = &candidate;
+                break;
+            }
+        }
+    }
+    else {
+        uint32_t levelIdc{0};
+        if ("1b" == level) {
+            levelIdc = 9;
+        }
+        else {
+            try {
+                levelIdc = static_cast<uint32_t>(std::lround(std::stof(level) * 10.0f));
+            }
+            catch (...) {
+                return false;
+            }
+        }
+        selected = findLevel(levelIdc);
+        if ((nullptr != selected) && !fitsLevel(*selected, width, height, fps)) {
+            selected = nullptr;
+        }
+    }
+    if (nullptr == selected) {
+        return false;
+    }
+
+    const uint32_t FRAME_MBS{((width + 15) / 16) * ((height + 15) / 16)};
+    limits.levelIdc = selected->levelIdc;
+    limits.maxBitrate = selected->maxBitrate * FACTOR;
+    limits.maxFrameSize = selected->maxCpbSize * FACTOR / 8;
+    limits.maxReferenceFrames = std::max(std::min(selected->maxDpbMacroblocks / std::max(FRAME_MBS, 1u), 16u), 1u);
+    return true;
+}
+
+std::string validateEncoderParameters(const SEncParamExt &parameters, const EncoderLimits &limits) noexcept {
+    std::stringstream sstr;
+    const H264Level *level{findLevel(limits.levelIdc)};
+    if ((0 >= parameters.iPicWidth) || (0 >= parameters.iPicHeight) || (0 != (parameters.iPicWidth % 2)) || (0 != (parameters.iPicHeight % 2))) {
+        sstr << "the frame size " << parameters.iPicWidth << "x" << parameters.iPicHeight << " is not a positive even size";
+    }
+    else if ((nullptr == level) || !fitsLevel(*level, static_cast<uint32_t>(parameters.iPicWidth), static_cast<uint32_t>(parameters.iPicHeight), parameters.fMaxFrameRate)) {
+        sstr << "level " << levelName(limits.levelIdc) << " does not allow " << parameters.iPicWidth << "x" << parameters.iPicHeight << " at " << parameters.fMaxFrameRate << " fps";
+    }
+    else if ((1 != parameters.iSpatialLayerNum) || (1 != parameters.iTemporalLayerNum)) {
+        sstr << "only one spatial and one temporal layer are supported";
+    }
+    else if ((parameters.iTargetBitrate <= 0) || (parameters.iTargetBitrate > parameters.iMaxBitrate)) {
+        sstr << "the bitrate " << parameters.iTargetBitrate << " exceeds the maximum bitrate " << parameters.iMaxBitrate;
+    }
+    else if (static_cast<uint32_t>(parameters.iMaxBitrate) > limits.maxBitrate) {
+        sstr << "the maximum bitrate " << parameters.iMaxBitrate << " exceeds " << limits.maxBitrate << " of level " << levelName(limits.levelIdc);
+    }
+    else if ((parameters.iMinQp < 0) || (parameters.iMaxQp > 51)) {
+        sstr << "the QP range " << parameters.iMinQp << "-" << parameters.iMaxQp << " is not within 0-51";
+    }
+    else if (parameters.iMinQp > parameters.iMaxQp) {
+        sstr << "the minimum QP " << parameters.iMinQp << " exceeds the maximum QP " << parameters.iMaxQp;
+    }
+    else if ((AUTO_REF_PIC_COUNT != parameters.iNumRefFrame) && ((parameters.iNumRefFrame < 1) || (static_cast<uint32_t>(parameters.iNumRefFrame) > limits.maxReferenceFrames))) {
+        sstr << parameters.iNumRefFrame << " reference frames exceed " << limits.maxReferenceFrames << " of level " << levelName(limits.levelIdc) << " at this frame size";
+    }
+    else if ((0 != parameters.iEntropyCodingModeFlag) && (PRO_BASELINE == limits.profileIdc)) {
+        sstr << "CABAC (--entropy-coding=1) needs the main or the high profile";
+    }
+    else if ((parameters.iLoopFilterDisableIdc < 0) || (parameters.iLoopFilterDisableIdc > 2) || (parameters.iMultipleThreadIdc > 4)) {
+        sstr << "the loop filter mode or the number of threads is out of range";
+    }
+    return sstr.str();
+}
+
+std::string describeEncoderParameters(const SEncParamExt &parameters) noexcept {
+    std::stringstream sstr;
+    sstr << parameters.iPicWidth << "x" << parameters.iPicHeight << " at " << parameters.fMaxFrameRate << " fps, "
+         << profileName(parameters.sSpatialLayers[0].uiProfileIdc) << " profile, level " << levelName(parameters.sSpatialLayers[0].uiLevelIdc)
+         << ", bitrate " << parameters.iTargetBitrate << " (max " << parameters.iMaxBitrate << ")"
+         << ", QP " << parameters.iMinQp << "-" << parameters.iMaxQp
+         << ", " << ((AUTO_REF_PIC_COUNT == parameters.iNumRefFrame) ? std::string("auto") : std::to_string(parameters.iNumRefFrame)) << " reference frame(s)"
+         << (parameters.bEnableLongTermReference ? " with long-term references" : "")
+         << ", GOP " << parameters.uiIntraPeriod
+         << ", RC mode " << static_cast<int32_t>(parameters.iRCMode)
+         << ", " << ((0 != parameters.iEntropyCodingModeFlag) ? "CABAC" : "CAVLC")
+         << ", " << ((SCREEN_CONTENT_REAL_TIME == parameters.iUsageType) ? "screen content" : "camera video")
+         << ", " << parameters.iMultipleThreadIdc << " thread(s)";
+    return sstr.str();
+}
+
+std::map<std::string, std::string> getCommandlineArgumentsFromString(const std::string &arguments) noexcept {
+    // Reuse libcluon's parser by building a regular argv array.
+    std::vector<std::string> tokens{"argv0"};
+    for (auto token : splitString(arguments, ' ')) {
+        token = stringtoolbox::trim(token);
+        if (!token.empty()) {
+            tokens.push_back(token);
+        }
+    }
+    std::vector<char*> argv;
+    for (auto &token : tokens) {
+        argv.push_back(&token[0]);
+    }
+    argv.push_back(nullptr);
+    return cluon::getCommandlineArguments(static_cast<int32_t>(tokens.size()), argv.data());
+}
+
+std::vector<std::string> splitString(const std::string &str, char delimiter) noexcept {
+    std::vector<std::string> parts;
+    std::string::size_type begin{0};
+    while (begin <= str.size()) {
+        std::string::size_type end{str.find(delimiter, begin)};
+        if (std::string::npos == end) {
+            end = str.size();
+        }
+        if (end > begin) {
+            parts.push_back(str.substr(begin, end - begin));
+        }
+        begin = end + 1;
+    }
+    return parts;
+}
+
+std::vector<std::pair<std::string, std::string>> loadNamedArguments(const std::string &filename) noexcept {
+    std::vector<std::pair<std::string, std::string>> namedArguments;
+    std::ifstream in(filename);
+    std::string line;
+    while (std::getline(in, line)) {
+        line = stringtoolbox::trim(line);
+        const auto colon = line.find(':');
+        if (line.empty() || ('#' == line[0]) || (std::string::npos == colon)) {
+            continue;
+        }
+        std::string name{line.substr(0, colon)};
+        std::string arguments{line.substr(colon + 1)};
+        namedArguments.push_back(std::make_pair(stringtoolbox::trim(name), stringtoolbox::trim(arguments)));
+    }
+    return namedArguments;
+}
+
+bool parseRegionsOfInterest(const std::string &regions, uint32_t width, uint32_t height, std::vector<RegionOfInterest> &result) noexcept {
+    result.clear();
+    for (auto region : splitString(regions, ',')) {
+        region = stringtoolbox::trim(region);
+        RegionOfInterest roi;
+        int consumed{0};
+        // %u would accept and wrap negative numbers.
+        if ((std::string::npos != region.find('-'))
+            || (5 != std::sscanf(region.c_str(), "%ux%u+%u+%u@%u%n", &roi.width, &roi.height, &roi.x, &roi.y, &roi.senderStamp, &consumed))
+            || (static_cast<size_t>(consumed) != region.size())) {
+            return false;
+        }
+        roi.x &= ~1u;
+        roi.y &= ~1u;
+        roi.width &= ~1u;
+        roi.height &= ~1u;
+        if ((0 == roi.width) || (0 == roi.height) || (roi.x > width) || (roi.width > width - roi.x) || (roi.y > height) || (roi.height > height - roi.y)) {
+            return false;
+        }
+        result.push_back(roi);
+    }
+    return !result.empty();
+}
+
+bool parseEncodingVariants(const std::string &variants, std::vector<EncodingVariant> &result) noexcept {
+    auto parseNumber = [](const std::string &str, uint32_t &value) {
+        int consumed{0};
+        return (1 == std::sscanf(str.c_str(), "%u%n", &value, &consumed)) && (static_cast<size_t>(consumed) == str.size());
+    };
+
+    result.clear();
+    for (auto variant : splitString(variants, ',')) {
+        variant = stringtoolbox::trim(variant);
+        const auto at = variant.find('@');
+        if ((std::string::npos == at) || (0 == at)) {
+            return false;
+        }
+        EncodingVariant v;
+        v.profile = variant.substr(0, at);
+        const std::vector<std::string> SINK{splitString(variant.substr(at + 1), ':')};
+        uint32_t cid{0};
+        if (SINK.empty() || (2 < SINK.size()) || !parseNumber(SINK[0], v.senderStamp) || ((2 == SINK.size()) && !parseNumber(SINK[1], cid))) {
+            return false;
+        }
+        v.cid = static_cast<uint16_t>(cid);
+        result.push_back(v);
+    }
+    return !result.empty();
+}
+
+bool parseMaskPolygons(const std::string &masks, uint32_t width, uint32_t height, std::vector<MaskPolygon> &result) noexcept {
+    result.clear();
+    for (auto mask : splitString(masks, ',')) {
+        mask = stringtoolbox::trim(mask);
+        MaskPolygon polygon;
+        uint32_t w{0}, h{0}, x{0}, y{0};
+        int consumed{0};
+        // %u would accept and wrap negative numbers.
+        if (std::string::npos != mask.find('-')) {
+            return false;
+        }
+        if ((4 == std::sscanf(mask.c_str(), "%ux%u+%u+%u%n", &w, &h, &x, &y, &consumed)) && (static_cast<size_t>(consumed) == mask.size())) {
+            if ((0 == w) || (0 == h) || (x > width) || (w > width - x) || (y > height) || (h > height - y)) {
+                return false;
+            }
+            polygon.vertices = {{x, y}, {x + w, y}, {x + w, y + h}, {x, y + h}};
+        }
+        else {
+            for (auto &vertex : splitString(mask, '/')) {
+                if ((2 != std::sscanf(vertex.c_str(), "%u:%u%n", &x, &y, &consumed)) || (static_cast<size_t>(consumed) != vertex.size())) {
+                    return false;
+                }
+                polygon.vertices.push_back(std::make_pair(x, y));
+            }
+            if (3 > polygon.vertices.size()) {
+                return false;
+            }
+        }
+        for (auto &vertex : polygon.vertices) {
+            if ((vertex.first > width) || (vertex.second > height)) {
+                return false;
+            }
+        }
+        result.push_back(polygon);
+    }
+    return !result.empty();
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ENCODER_PARAMETERS_HPP
+#define ENCODER_PARAMETERS_HPP
+
+#include <wels/codec_api.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Rectangle of a frame that is encoded as separate stream.
+ */
+struct RegionOfInterest {
+    uint32_t x{0};
+    uint32_t y{0};
+    uint32_t width{0};
+    uint32_t height{0};
+    uint32_t senderStamp{0};
+};
+
+/**
+ * Polygon of a frame that is masked before encoding; rectangles have four vertices.
+ */
+struct MaskPolygon {
+    std::vector<std::pair<uint32_t, uint32_t>> vertices{};
+};
+
+/**
+ * Named encoder parameter set (see loadNamedArguments) to encode the full
+ * frame with as separate stream.
+ */
+struct EncodingVariant {
+    std::string profile{};
+    uint32_t senderStamp{0};
+    uint16_t cid{0}; // 0: CID of the stream.
+};
+
+/**
+ * Limits of the encoder parameters for a stream of an H.264 level and profile.
+ */
+struct EncoderLimits {
+    uint32_t levelIdc{0}; // 10 * level, e.g., 31 for 3.1; 9 for 1b.
+    uint32_t profileIdc{PRO_BASELINE};
+    uint32_t maxBitrate{0}; // bit/s.
+    uint32_t maxFrameSize{0}; // Bytes, i.e., the size of the coded picture buffer.
+    uint32_t maxReferenceFrames{0};
+};
+
+/**
+ * This function fills the openh264 parameters from the commandline arguments
+ * as accepted by the microservice (--gop, --bitrate, --rc-mode, ...); the
+ * bitrates and reference frames are limited by the H.264 level (--level).
+ *
+ * @param encoder openh264 encoder to obtain the default parameters from.
+ * @param commandlineArguments Arguments as returned by cluon::getCommandlineArguments.
+ * @param width Width of the frames to encode.
+ * @param height Height of the frames to encode.
+ * @param parameters Parameters to fill.
+ * @throws std::invalid_argument if the arguments are malformed or contradict each other or the level.
+ */
+void setEncoderParameters(ISVCEncoder *encoder, std::map<std::string, std::string> &commandlineArguments, uint32_t width, uint32_t height, SEncParamExt &parameters);
+
+/**
+ * This function derives the limits of the encoder parameters from an H.264
+ * level and profile (ITU-T H.264, Table A-1); without level, the lowest
+ * level for the resolution, frame rate, and bitrate is chosen.
+ *
+ * @param width Width of the frames.
+ * @param height Height of the frames.
+ * @param fps Frame rate.
+ * @param bitrate Bitrate in bit/s that the level needs to allow (0: any).
+ * @param level Level like "3.1", "4", or "1b"; empty or "auto" to choose one.
+ * @param profile baseline, main, or high.
+ * @param limits Derived limits.
+ * @return false if the level or profile is unknown or the level is too low for the resolution and frame rate.
+ */
+bool deriveEncoderLimits(uint32_t width, uint32_t height, float fps, uint32_t bitrate, const std::string &level, const std::string &profile, EncoderLimits &limits) noexcept;
+
+/**
+ * @param parameters openh264 parameters.
+ * @param limits Limits of the level and profile of the parameters.
+ * @return Empty string if the parameters are valid, or the first problem found.
+ */
+std::string validateEncoderParameters(const SEncParamExt &parameters, const EncoderLimits &limits) noexcept;
+
+/**
+ * @return Effective openh264 parameters in one line.
+ */
+std::string describeEncoderParameters(const SEncParamExt &parameters) noexcept;
+
+/**
+ * @return Commandline arguments parsed from a string like "--gop=10 --bitrate=500000".
+ */
+std::map<std::string, std::string> getCommandlineArgumentsFromString(const std::string &arguments) noexcept;
+
+/**
+ * @return Non-empty parts of the string separated by the delimiter; a string
+ *         without delimiter is returned as its only part.
+ */
+std::vector<std::string> splitString(const std::string &str, char delimiter) noexcept;
+
+/**
+ * @return Named encoder arguments in the order of a file with one
+ *         "<name>: <encoder arguments>" per line; lines starting with # are ignored.
+ */
+std::vector<std::pair<std::string, std::string>> loadNamedArguments(const std::string &filename) noexcept;
+
+/**
+ * This function parses regions of interest given as "<width>x<height>+<x>+<y>@<senderStamp>"
+ * separated by commas; offsets and sizes are rounded down to even values as
+ * the chroma planes are subsampled.
+ *
+ * @param regions Regions of interest as described above.
+ * @param width Width of the frames.
+ * @param height Height of the frames.
+ * @param result Parsed regions.
+ * @return false if a region is malformed, empty, or exceeds the frame.
+ */
+bool parseRegionsOfInterest(const std::string &regions, uint32_t width, uint32_t height, std::vector<RegionOfInterest> &result) noexcept;
+
+/**
+ * This function parses variants given as "<profile>@<senderStamp>[:<cid>]"
+ * separated by commas.
+ *
+ * @param variants Variants as described above.
+ * @param result Parsed variants.
+ * @return false if a variant is malformed.
+ */
+bool parseEncodingVariants(const std::string &variants, std::vector<EncodingVariant> &result) noexcept;
+
+/**
+ * This function parses privacy masks separated by commas, given either as
+ * rectangle "<width>x<height>+<x>+<y>" or as polygon "<x>:<y>/<x>:<y>/<x>:<y>[/...]".
+ *
+ * @param masks Masks as described above.
+ * @param width Width of the frames.
+ * @param height Height of the frames.
+ * @param result Parsed masks.
+ * @return false if a mask is malformed, empty, or exceeds the frame.
+ */
+bool parseMaskPolygons(const std::string &masks, uint32_t width, uint32_t height, std::vector<MaskPolygon> &result) noexcept;
+
+#endif
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "encoder-pool.hpp"
+
+#include <sstream>
+
+EncoderPool::EncoderPool(uint32_t capacity) noexcept
+    : m_capacity{capacity} {
+}
+
+std::string EncoderPool::keyOf(uint32_t width, uint32_t height, const std::map<std::string, std::string> &arguments) noexcept {
+    std::stringstream sstr;
+    sstr << width << "x" << height;
+    for (auto &argument : arguments) {
+        sstr << " --" << argument.first << "=" << argument.second;
+    }
+    return sstr.str();
+}
+
+std::unique_ptr<StreamEncoder> EncoderPool::acquire(uint32_t width, uint32_t height, const std::map<std::string, std::string> &arguments, bool verbose) noexcept {
+    const std::string KEY{keyOf(width, height, arguments)};
+    {
+        std::lock_guard<std::mutex> lck(m_idleMutex);
+        for (auto it = m_idle.begin(); it != m_idle.end(); it++) {
+            if (KEY == it->first) {
+                std::unique_ptr<StreamEncoder> encoder{std::move(it->second)};
+                m_idle.erase(it);
+                encoder->forceIntraFrame();
+                return encoder;
+            }
+        }
+    }
+    std::unique_ptr<StreamEncoder> encoder{new StreamEncoder(width, height, arguments, verbose)};
+    if (encoder->valid()) {
+        encoder->warmUp();
+    }
+    return encoder;
+}
+
+bool EncoderPool::prewarm(uint32_t width, uint32_t height, const std::map<std::string, std::string> &arguments, bool verbose) noexcept {
+    const std::string KEY{keyOf(width, height, arguments)};
+    {
+        std::lock_guard<std::mutex> lck(m_idleMutex);
+        for (auto &idle : m_idle) {
+            if (KEY == idle.first) {
+                return true;
+            }
+        }
+    }
+    std::unique_ptr<StreamEncoder> encoder{new StreamEncoder(width, height, arguments, verbose)};
+    if (!encoder->valid()) {
+        return false;
+    }
+    encoder->warmUp();
+    release(KEY, std::move(encoder));
+    return (0 < m_capacity);
+}
+
+void EncoderPool::release(const std::string &key, std::unique_ptr<StreamEncoder> encoder) noexcept {
+    if (!encoder || !encoder->valid() || (0 == m_capacity)) {
+        return;
+    }
+    std::lock_guard<std::mutex> lck(m_idleMutex);
+    m_idle.push_back(std::make_pair(key, std::move(encoder)));
+    while (m_idle.size() > m_capacity) {
+        m_idle.pop_front();
+    }
+}
+
+uint32_t EncoderPool::idle() const noexcept {
+    std::lock_guard<std::mutex> lck(m_idleMutex);
+    return static_cast<uint32_t>(m_idle.size());
+}
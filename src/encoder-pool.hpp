@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ENCODER_POOL_HPP
+#define ENCODER_POOL_HPP
+
+#include "stream-encoder.hpp"
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+/**
+ * Pool of idle, initialized encoders so that streams that are removed and
+ * added again or modified reuse encoders and their buffers of the same
+ * configuration instead of setting up the encoder library again.
+ */
+class EncoderPool {
+   private:
+    EncoderPool(const EncoderPool &) = delete;
+    EncoderPool(EncoderPool &&)      = delete;
+    EncoderPool &operator=(const EncoderPool &) = delete;
+    EncoderPool &operator=(EncoderPool &&) = delete;
+
+   public:
+    /**
+     * @param capacity Maximum number of idle encoders; the least recently released ones are destroyed first.
+     */
+    explicit EncoderPool(uint32_t capacity) noexcept;
+
+   public:
+    /**
+     * @return Key identifying encoders of the same configuration.
+     */
+    static std::string keyOf(uint32_t width, uint32_t height, const std::map<std::string, std::string> &arguments) noexcept;
+
+    /**
+     * @return Idle encoder of the configuration or a new, warmed-up one; the
+     *         next frame is encoded as IDR frame in both cases.
+     */
+    std::unique_ptr<StreamEncoder> acquire(uint32_t width, uint32_t height, const std::map<std::string, std::string> &arguments, bool verbose) noexcept;
+
+    /**
+     * This method creates and warms up an idle encoder of the configuration
+     * unless one is available already.
+     *
+     * @return true if an idle encoder of the configuration is available.
+     */
+    bool prewarm(uint32_t width, uint32_t height, const std::map<std::string, std::string> &arguments, bool verbose) noexcept;
+
+    /**
+     * This method returns an encoder acquired for the given key to the pool.
+     */
+    void release(const std::string &key, std::unique_ptr<StreamEncoder> encoder) noexcept;
+
+    uint32_t idle() const noexcept;
+
+   private:
+    uint32_t m_capacity{0};
+    mutable std::mutex m_idleMutex{};
+    std::list<std::pair<std::string, std::unique_ptr<StreamEncoder>>> m_idle{};
+};
+
+#endif
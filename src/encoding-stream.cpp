@@ -0,0 +1,532 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cluon-complete.hpp"
+#include "opendlv-standard-message-set.hpp"
+#include "encoding-stream.hpp"
+#include "shared-memory-attach.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <iostream>
+
+EncodingStream::EncodingStream(const std::string &name, uint32_t senderStamp, std::unique_ptr<StreamEncoder> encoder, std::shared_ptr<cluon::OD4Session> od4, bool verbose) noexcept
+    : m_name{name}
+    , m_senderStamp{senderStamp}
+    , m_encoder{std::move(encoder)}
+    , m_od4{od4}
+    , m_verbose{verbose}
+    , m_width{m_encoder ? m_encoder->width() : 0}
+    , m_height{m_encoder ? m_encoder->height() : 0} {
+}
+
+EncodingStream::EncodingStream(const std::string &name, uint32_t senderStamp, std::vector<std::unique_ptr<StreamEncoder>> encoders, uint32_t gop, std::shared_ptr<cluon::OD4Session> od4, bool verbose) noexcept
+    : m_name{name}
+    , m_senderStamp{senderStamp}
+    , m_od4{od4}
+    , m_verbose{verbose}
+    , m_width{(!encoders.empty() && encoders[0]) ? encoders[0]->width() : 0}
+    , m_height{(!encoders.empty() && encoders[0]) ? encoders[0]->height() : 0} {
+    m_parallelEncoder.reset(new GopParallelEncoder(std::move(encoders), gop, [this](EncodedFrame &&frame) {
+        if (!frame.data.empty()) {
+            publish(frame.data, cluon::time::fromMicroseconds(frame.sampleTime));
+        }
+    }));
+}
+
+EncodingStream::EncodingStream(const std::string &name, uint32_t width, uint32_t height, std::shared_ptr<cluon::OD4Session> od4, bool verbose) noexcept
+    : m_name{name}
+    , m_od4{od4}
+    , m_verbose{verbose}
+    , m_width{width}
+    , m_height{height} {
+}
+
+EncodingStream::~EncodingStream() {
+    stop();
+}
+
+bool EncodingStream::addRegion(const RegionOfInterest &region, std::unique_ptr<StreamEncoder> encoder, std::shared_ptr<cluon::OD4Session> od4) noexcept {
+    if (!encoder || !encoder->valid() || (encoder->width() != region.width) || (encoder->height() != region.height)
+        || (region.x > m_width) || (region.width > m_width - region.x) || (region.y > m_height) || (region.height > m_height - region.y)
+        || (0 != (region.x % 2)) || (0 != (region.y % 2))) {
+        return false;
+    }
+    std::unique_ptr<Region> r{new Region()};
+    r->roi = region;
+    r->encoder = std::move(encoder);
+    r->od4 = od4 ? od4 : m_od4;
+    m_regions.push_back(std::move(r));
+    return true;
+}
+
+void EncodingStream::setFailover(std::shared_ptr<FailoverMonitor> failover) noexcept {
+    m_failover = failover;
+}
+
+void EncodingStream::setTemporalDenoise(uint32_t threshold) noexcept {
+    m_denoiser.reset((0 < threshold) ? new TemporalDenoiser(m_width, m_height, threshold) : nullptr);
+}
+
+void EncodingStream::setPrivacyMasks(const std::vector<MaskPolygon> &polygons, bool blur, uint32_t radius) noexcept {
+    m_privacyMask.reset(!polygons.empty() ? new PrivacyMask(m_width, m_height, polygons, blur, radius) : nullptr);
+}
+
+void EncodingStream::setContentDetection() noexcept {
+    m_classifier.reset(new ContentClassifier(m_width, m_height));
+    m_classify = true;
+}
+
+void EncodingStream::feedback(const cluon::OD4Session *od4, uint32_t senderStamp, const ReferenceFeedback &feedback) noexcept {
+    // Only the latest feedback matters if the stream does not consume it.
+    const size_t MAX_PENDING_FEEDBACK{16};
+    PendingFeedback pending;
+    pending.od4 = od4;
+    pending.senderStamp = senderStamp;
+    pending.feedback = feedback;
+    std::lock_guard<std::mutex> lck(m_feedbackMutex);
+    if (MAX_PENDING_FEEDBACK <= m_feedback.size()) {
+        m_feedback.erase(m_feedback.begin());
+    }
+    m_feedback.push_back(pending);
+}
+
+bool EncodingStream::run(uint32_t timeout) noexcept {
+    const bool VALID{(m_encoder && m_encoder->valid()) || (m_parallelEncoder && m_parallelEncoder->valid()) || !m_regions.empty()};
+    if (!VALID || !m_od4) {
+        return false;
+    }
+    {
+        std::unique_ptr<cluon::SharedMemory> sharedMemory{attachSharedMemory(m_name, timeout, &m_stop)};
+        if (!sharedMemory || !sharedMemory->valid()) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lck(m_sharedMemoryMutex);
+        m_sharedMemory = std::move(sharedMemory);
+    }
+    if (m_parallelEncoder) {
+        std::clog << m_name << ": Attached (" << m_sharedMemory->size() << " bytes), encoding GOPs with " << m_parallelEncoder->instances() << " encoders in parallel." << std::endl;
+    }
+    else if (m_encoder) {
+        std::clog << m_name << ": Attached (" << m_sharedMemory->size() << " bytes), encoding with " << m_encoder->backend() << "." << std::endl;
+    }
+    if (m_denoiser) {
+        std::clog << m_name << ": Filtering frames with the temporal denoiser (" << m_denoiser->implementation() << ")." << std::endl;
+    }
+    if (m_privacyMask) {
+        std::clog << m_name << ": Masking frames (" << m_privacyMask->implementation() << ")." << std::endl;
+    }
+    for (auto &region : m_regions) {
+        std::clog << m_name << ": Encoding region " << region->roi.width << "x" << region->roi.height << "+" << region->roi.x << "+" << region->roi.y
+                  << " with " << region->encoder->backend() << " at " << region->encoder->targetBitrate() << " bps as senderStamp " << region->roi.senderStamp << "." << std::endl;
+    }
+    startRegionWorkers();
+    m_attached = true;
+
+    const uint32_t WIDTH{m_width};
+    const uint32_t HEIGHT{m_height};
+    cluon::SharedMemory *sharedMemory{m_sharedMemory.get()};
+    cluon::data::TimeStamp before, after, sampleTimeStamp, lastSampleTimeStamp;
+    while (!m_stop.load() && sharedMemory->valid() && m_od4->isRunning()) {
+        // Wait for incoming frame.
+        sharedMemory->wait();
+        if (m_stop.load()) {
+            break;
+        }
+
+        sampleTimeStamp = cluon::time::now();
+
+        sharedMemory->lock();
+        {
+            // Read notification timestamp.
+            auto r = sharedMemory->getTimeStamp();
+            sampleTimeStamp = (r.first ? r.second : sampleTimeStamp);
+            // Spurious wake-up without a new frame (e.g., when the producer was preempted during notifyAll).
+            if (r.first && (cluon::time::toMicroseconds(sampleTimeStamp) == cluon::time::toMicroseconds(lastSampleTimeStamp))) {
+                sharedMemory->unlock();
+                continue;
+            }
+            lastSampleTimeStamp = sampleTimeStamp;
+        }
+        if (m_failover) {
+            const FailoverMonitor::Role ROLE{m_failover->onFrame(sampleTimeStamp)};
+            if (FailoverMonitor::STANDBY == ROLE) {
+                sharedMemory->unlock();
+                continue;
+            }
+            if (FailoverMonitor::TAKEOVER == ROLE) {
+                std::lock_guard<std::mutex> lck(m_encoderMutex);
+                if (m_encoder) {
+                    m_encoder->forceIntraFrame();
+                }
+                if (m_parallelEncoder) {
+                    m_parallelEncoder->forceIntraFrame();
+                }
+                for (auto &region : m_regions) {
+                    region->encoder->forceIntraFrame();
+                }
+                // The last filtered frame is outdated after standing by.
+                if (m_denoiser) {
+                    m_denoiser->reset();
+                }
+            }
+            m_failover->heartbeat(sampleTimeStamp);
+        }
+        applyFeedback();
+        const uint8_t *data{reinterpret_cast<const uint8_t*>(sharedMemory->data())};
+        const uint32_t strides[3]{WIDTH, WIDTH/2, WIDTH/2};
+        if (m_classifier && m_classify.load()) {
+            const uint8_t *input[3]{data, data + (WIDTH * HEIGHT), data + (WIDTH * HEIGHT + ((WIDTH * HEIGHT) >> 2))};
+            detectContent(input, strides);
+        }
+        if (m_denoiser) {
+            const uint8_t *input[3]{data, data + (WIDTH * HEIGHT), data + (WIDTH * HEIGHT + ((WIDTH * HEIGHT) >> 2))};
+            data = m_denoiser->filter(input, strides);
+        }
+        // Masked before anything is encoded from the frame.
+        if (m_privacyMask) {
+            const uint8_t *input[3]{data, data + (WIDTH * HEIGHT), data + (WIDTH * HEIGHT + ((WIDTH * HEIGHT) >> 2))};
+            data = m_privacyMask->apply(input, strides);
+        }
+        const uint8_t *planes[3]{data, data + (WIDTH * HEIGHT), data + (WIDTH * HEIGHT + ((WIDTH * HEIGHT) >> 2))};
+        // The regions are encoded in parallel to the full frame.
+        startRegions(planes);
+        if (m_parallelEncoder) {
+            // The frames are published in order by the parallel encoder.
+            if (!m_parallelEncoder->push(planes, strides, cluon::time::toMicroseconds(sampleTimeStamp))) {
+                std::cerr << m_name << ": Warning, dropping frame as the encoders fall behind." << std::endl;
+            }
+            waitForRegions();
+            sharedMemory->unlock();
+            publishRegions(sampleTimeStamp);
+            continue;
+        }
+        if (!m_encoder) {
+            waitForRegions();
+            sharedMemory->unlock();
+            publishRegions(sampleTimeStamp);
+            continue;
+        }
+
+        // Held until the frame is published as the encoder might be swapped.
+        std::unique_lock<std::mutex> encoderLock(m_encoderMutex);
+        AccessUnit accessUnit;
+        {
+            if (m_verbose) {
+                before = cluon::time::now();
+            }
+            const bool encoded{m_encoder->encode(planes, strides, accessUnit)};
+            if (m_verbose) {
+                after = cluon::time::now();
+            }
+            if (!encoded) {
+                std::cerr << m_name << ": Failed to encode frame." << std::endl;
+            }
+            else if ((videoFrameTypeSkip == accessUnit.frameType) && (0 < m_encoder->frameBudget())) {
+                std::cerr << m_name << ": Warning, skipping frame exceeding the frame budget of " << m_encoder->frameBudget() << " bytes after " << accessUnit.reencodings << " re-encoding(s)." << std::endl;
+            }
+            else if (videoFrameTypeSkip == accessUnit.frameType) {
+                std::cerr << m_name << ": Warning, skipping frame." << std::endl;
+            }
+        }
+        waitForRegions();
+        sharedMemory->unlock();
+        publishRegions(sampleTimeStamp);
+
+        if (0 < accessUnit.size) {
+            publish(std::string(accessUnit.data, accessUnit.size), sampleTimeStamp);
+
+            if (m_verbose && (0 < accessUnit.reencodings)) {
+                std::clog << m_name << ": Frame size = " << accessUnit.size << " bytes; sample time = " << cluon::time::toMicroseconds(sampleTimeStamp) << " microseconds; encoding took " << cluon::time::deltaInMicroseconds(after, before) << " microseconds, of which " << accessUnit.reencodingTime << " for " << accessUnit.reencodings << " re-encoding(s) to fit the frame budget." << std::endl;
+            }
+            else if (m_verbose) {
+                std::clog << m_name << ": Frame size = " << accessUnit.size << " bytes; sample time = " << cluon::time::toMicroseconds(sampleTimeStamp) << " microseconds; encoding took " << cluon::time::deltaInMicroseconds(after, before) << " microseconds." << std::endl;
+            }
+        }
+    }
+
+    stopRegionWorkers();
+    m_attached = false;
+    {
+        std::lock_guard<std::mutex> lck(m_encoderMutex);
+        if (m_encoder && (0 < m_encoder->frameBudget())) {
+            const StreamEncoder::FrameBudgetStatistics STATISTICS{m_encoder->frameBudgetStatistics()};
+            std::clog << m_name << ": " << STATISTICS.exceeded << " of " << STATISTICS.frames << " frames exceeded the frame budget of " << m_encoder->frameBudget() << " bytes; "
+                      << STATISTICS.reencodings << " re-encoding(s) added " << ((0 < STATISTICS.exceeded) ? STATISTICS.addedTime / STATISTICS.exceeded : 0) << " microseconds per exceeding frame on average (max " << STATISTICS.maxAddedTime << "), "
+                      << STATISTICS.skipped << " frame(s) skipped." << std::endl;
+        }
+    }
+    std::lock_guard<std::mutex> lck(m_sharedMemoryMutex);
+    m_sharedMemory.reset();
+    return true;
+}
+
+void EncodingStream::start(uint32_t timeout) noexcept {
+    if (!m_thread.joinable()) {
+        m_stop = false;
+        m_thread = std::thread([this, timeout]() { run(timeout); });
+    }
+}
+
+void EncodingStream::stop() noexcept {
+    m_stop = true;
+    if (m_thread.joinable()) {
+        // The producer might have stopped; hence, the waiting thread is woken
+        // up until it noticed the request as a notification might be missed.
+        auto joiner = std::async(std::launch::async, [this]() { m_thread.join(); });
+        while (std::future_status::ready != joiner.wait_for(std::chrono::milliseconds(20))) {
+            std::lock_guard<std::mutex> lck(m_sharedMemoryMutex);
+            if (m_sharedMemory) {
+                m_sharedMemory->notifyAll();
+            }
+        }
+    }
+}
+
+std::unique_ptr<StreamEncoder> EncodingStream::swapEncoder(std::unique_ptr<StreamEncoder> encoder) noexcept {
+    if (m_parallelEncoder || !encoder || (encoder->width() != m_width) || (encoder->height() != m_height)) {
+        return encoder;
+    }
+    std::lock_guard<std::mutex> lck(m_encoderMutex);
+    m_encoder.swap(encoder);
+    // The new encoder is set up for the content at its first frame.
+    m_classify = static_cast<bool>(m_classifier);
+    return encoder;
+}
+
+void EncodingStream::detectContent(const uint8_t *planes[3], const uint32_t strides[3]) noexcept {
+    const uint32_t AGREEING_FRAMES{3};
+    const uint32_t MAX_FRAMES{100};
+    const ContentClassifier::Statistics STATISTICS{m_classifier->classify(planes, strides)};
+    m_classifiedFrames++;
+    // Uniform frames, e.g., black frames while a camera starts, would be
+    // taken for screen content; the type of content is set only when
+    // several frames in a row agree on it.
+    if (1 != STATISTICS.paletteSize) {
+        m_agreeingFrames = ((0 < m_agreeingFrames) && (m_screenContent == STATISTICS.screenContent)) ? m_agreeingFrames + 1 : 1;
+        m_screenContent = STATISTICS.screenContent;
+    }
+    if (AGREEING_FRAMES > m_agreeingFrames) {
+        if (MAX_FRAMES <= m_classifiedFrames) {
+            std::clog << m_name << ": No type of content detected within " << MAX_FRAMES << " frames, keeping the usage type of the encoders." << std::endl;
+            m_classify = false;
+            m_classifiedFrames = 0;
+            m_agreeingFrames = 0;
+        }
+        return;
+    }
+    m_classify = false;
+    m_classifiedFrames = 0;
+    m_agreeingFrames = 0;
+
+    bool supported{true};
+    {
+        std::lock_guard<std::mutex> lck(m_encoderMutex);
+        if (m_encoder) {
+            supported = m_encoder->setScreenContent(STATISTICS.screenContent) && supported;
+        }
+    }
+    if (m_parallelEncoder) {
+        supported = m_parallelEncoder->setScreenContent(STATISTICS.screenContent) && supported;
+    }
+    for (auto &region : m_regions) {
+        supported = region->encoder->setScreenContent(STATISTICS.screenContent) && supported;
+    }
+    std::clog << m_name << ": Detected " << (STATISTICS.screenContent ? "screen content" : "camera video") << " (" << static_cast<uint32_t>(STATISTICS.flatBlockRatio * 100.0f) << "% flat blocks, palette of "
+              << ((0 < STATISTICS.paletteSize) ? std::to_string(STATISTICS.paletteSize) : "more than 256") << "; " << m_classifier->implementation() << ")"
+              << (supported ? "." : ", but the encoder does not support it.") << std::endl;
+}
+
+void EncodingStream::applyFeedback() noexcept {
+    std::vector<PendingFeedback> pending;
+    {
+        std::lock_guard<std::mutex> lck(m_feedbackMutex);
+        if (m_feedback.empty()) {
+            return;
+        }
+        pending.swap(m_feedback);
+    }
+    // The region workers are idle between two frames.
+    for (auto &entry : pending) {
+        bool applied{false};
+        if ((m_od4.get() == entry.od4) && (m_senderStamp == entry.senderStamp) && m_parallelEncoder) {
+            // The encoders of the other GOPs do not know the long-term reference
+            // frames of an instance; hence, the next pushed frame is an IDR frame.
+            if (!m_parallelFeedbackReported) {
+                std::clog << m_name << ": Long-term reference recovery is not supported with encoders for GOPs in parallel; recovering from losses with IDR frames." << std::endl;
+                m_parallelFeedbackReported = true;
+            }
+            if (ReferenceFeedback::RECOVERY_REQUEST == entry.feedback.type) {
+                m_parallelEncoder->forceIntraFrame();
+                applied = true;
+            }
+        }
+        else if ((m_od4.get() == entry.od4) && (m_senderStamp == entry.senderStamp)) {
+            std::lock_guard<std::mutex> lck(m_encoderMutex);
+            if (m_encoder) {
+                m_encoder->feedback(entry.feedback);
+                applied = true;
+            }
+        }
+        for (auto &region : m_regions) {
+            if ((region->od4.get() == entry.od4) && (region->roi.senderStamp == entry.senderStamp)) {
+                region->encoder->feedback(entry.feedback);
+                applied = true;
+            }
+        }
+        if (m_verbose && applied && (ReferenceFeedback::RECOVERY_REQUEST == entry.feedback.type)) {
+            std::clog << m_name << ": Recovering senderStamp " << entry.senderStamp << " from a loss after frame " << entry.feedback.frameNumber << "." << std::endl;
+        }
+    }
+}
+
+std::vector<std::unique_ptr<StreamEncoder>> EncodingStream::releaseEncoders() noexcept {
+    stop();
+    std::vector<std::unique_ptr<StreamEncoder>> encoders;
+    if (m_parallelEncoder) {
+        encoders = m_parallelEncoder->releaseEncoders();
+    }
+    else if (m_encoder) {
+        std::lock_guard<std::mutex> lck(m_encoderMutex);
+        encoders.push_back(std::move(m_encoder));
+    }
+    for (auto &region : m_regions) {
+        encoders.push_back(std::move(region->encoder));
+    }
+    m_regions.clear();
+    return encoders;
+}
+
+void EncodingStream::startRegionWorkers() noexcept {
+    uint64_t first{0};
+    {
+        std::lock_guard<std::mutex> lck(m_regionsMutex);
+        m_regionsStop = false;
+        m_regionsPending = 0;
+        first = m_regionsGeneration;
+    }
+    for (auto &r : m_regions) {
+        Region *region{r.get()};
+        region->worker = std::thread([this, region, first]() {
+            uint64_t generation{first};
+            while (true) {
+                const uint8_t *planes[3]{nullptr, nullptr, nullptr};
+                {
+                    std::unique_lock<std::mutex> lck(m_regionsMutex);
+                    m_regionsStart.wait(lck, [this, &generation]() { return m_regionsStop || (generation != m_regionsGeneration); });
+                    if (m_regionsStop) {
+                        break;
+                    }
+                    generation = m_regionsGeneration;
+                    std::copy(m_regionPlanes, m_regionPlanes + 3, planes);
+                }
+                encodeRegion(*region, planes);
+                std::lock_guard<std::mutex> lck(m_regionsMutex);
+                if (0 == --m_regionsPending) {
+                    m_regionsDone.notify_all();
+                }
+            }
+        });
+    }
+}
+
+void EncodingStream::stopRegionWorkers() noexcept {
+    {
+        std::lock_guard<std::mutex> lck(m_regionsMutex);
+        m_regionsStop = true;
+    }
+    m_regionsStart.notify_all();
+    for (auto &region : m_regions) {
+        if (region->worker.joinable()) {
+            region->worker.join();
+        }
+    }
+}
+
+void EncodingStream::encodeRegion(Region &region, const uint8_t *planes[3]) noexcept {
+    // The regions are encoded directly from the shared memory area by
+    // offsetting the plane pointers while keeping the strides of the frame.
+    const uint32_t strides[3]{m_width, m_width / 2, m_width / 2};
+    const RegionOfInterest &roi{region.roi};
+    const uint8_t *regionPlanes[3]{planes[0] + roi.y * strides[0] + roi.x,
+                                   planes[1] + (roi.y / 2) * strides[1] + roi.x / 2,
+                                   planes[2] + (roi.y / 2) * strides[2] + roi.x / 2};
+    region.accessUnit = AccessUnit{};
+    if (!region.encoder->encode(regionPlanes, strides, region.accessUnit)) {
+        std::cerr << m_name << ": Failed to encode region for senderStamp " << roi.senderStamp << "." << std::endl;
+    }
+}
+
+void EncodingStream::startRegions(const uint8_t *planes[3]) noexcept {
+    if (!m_regions.empty()) {
+        {
+            std::lock_guard<std::mutex> lck(m_regionsMutex);
+            std::copy(planes, planes + 3, m_regionPlanes);
+            m_regionsPending = static_cast<uint32_t>(m_regions.size());
+            m_regionsGeneration++;
+        }
+        m_regionsStart.notify_all();
+    }
+}
+
+void EncodingStream::waitForRegions() noexcept {
+    std::unique_lock<std::mutex> lck(m_regionsMutex);
+    m_regionsDone.wait(lck, [this]() { return 0 == m_regionsPending; });
+}
+
+void EncodingStream::publishRegions(const cluon::data::TimeStamp &sampleTimeStamp) noexcept {
+    // The encoded data stays valid until the region's encoder is called again.
+    for (auto &region : m_regions) {
+        if (0 < region->accessUnit.size) {
+            publish(*region->od4, std::string(region->accessUnit.data, region->accessUnit.size), sampleTimeStamp, region->roi.senderStamp,
+                    region->roi.width, region->roi.height, region->encoder->fourcc());
+        }
+    }
+}
+
+void EncodingStream::publish(const std::string &data, const cluon::data::TimeStamp &sampleTimeStamp) noexcept {
+    publish(*m_od4, data, sampleTimeStamp, m_senderStamp, m_width, m_height, m_parallelEncoder ? m_parallelEncoder->fourcc() : m_encoder->fourcc());
+}
+
+void EncodingStream::publish(cluon::OD4Session &od4, const std::string &data, const cluon::data::TimeStamp &sampleTimeStamp, uint32_t senderStamp, uint32_t width, uint32_t height, const std::string &fourcc) noexcept {
+    opendlv::proxy::ImageReading ir;
+    ir.fourcc(fourcc).width(width).height(height).data(data);
+    od4.send(ir, sampleTimeStamp, senderStamp);
+    m_frames++;
+    m_bytes += data.size();
+}
+
+const std::string &EncodingStream::name() const noexcept {
+    return m_name;
+}
+
+uint32_t EncodingStream::senderStamp() const noexcept {
+    return m_senderStamp;
+}
+
+bool EncodingStream::isAttached() const noexcept {
+    return m_attached.load();
+}
+
+uint64_t EncodingStream::frames() const noexcept {
+    return m_frames.load();
+}
+
+uint64_t EncodingStream::bytes() const noexcept {
+    return m_bytes.load();
+}
@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ENCODING_STREAM_HPP
+#define ENCODING_STREAM_HPP
+
+#include "cluon-complete.hpp"
+#include "content-classifier.hpp"
+#include "encoder-parameters.hpp"
+#include "failover-monitor.hpp"
+#include "gop-parallel-encoder.hpp"
+#include "privacy-mask.hpp"
+#include "stream-encoder.hpp"
+#include "temporal-denoiser.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * One stream from a shared memory area holding I420 frames to an OD4Session:
+ * it attaches to the area, encodes every new frame, and publishes it as
+ * ImageReading with the given senderStamp.
+ */
+class EncodingStream {
+   private:
+    EncodingStream(const EncodingStream &) = delete;
+    EncodingStream(EncodingStream &&)      = delete;
+    EncodingStream &operator=(const EncodingStream &) = delete;
+    EncodingStream &operator=(EncodingStream &&) = delete;
+
+   public:
+    /**
+     * @param name Name of the shared memory area.
+     * @param senderStamp senderStamp for the published frames.
+     * @param encoder Encoder matching the geometry of the frames in the shared memory area.
+     * @param od4 OD4Session to publish the frames to.
+     * @param verbose Print information about every frame.
+     */
+    EncodingStream(const std::string &name, uint32_t senderStamp, std::unique_ptr<StreamEncoder> encoder, std::shared_ptr<cluon::OD4Session> od4, bool verbose) noexcept;
+
+    /**
+     * Stream that encodes consecutive GOPs with several encoder instances in parallel.
+     *
+     * @param encoders Encoder instances of the same configuration.
+     * @param gop Length of the GOPs as configured for the encoders.
+     */
+    EncodingStream(const std::string &name, uint32_t senderStamp, std::vector<std::unique_ptr<StreamEncoder>> encoders, uint32_t gop, std::shared_ptr<cluon::OD4Session> od4, bool verbose) noexcept;
+
+    /**
+     * Stream that only encodes the regions of interest added with addRegion.
+     *
+     * @param width Width of the frames in the shared memory area.
+     * @param height Height of the frames in the shared memory area.
+     */
+    EncodingStream(const std::string &name, uint32_t width, uint32_t height, std::shared_ptr<cluon::OD4Session> od4, bool verbose) noexcept;
+    ~EncodingStream();
+
+   public:
+    /**
+     * This method adds a rectangle of the frames that is encoded from the
+     * same frame as separate stream; it must be called before run. All
+     * regions are encoded in parallel while the frame is locked once.
+     *
+     * @param region Rectangle and senderStamp of the region; the full frame for a variant with other encoder parameters.
+     * @param encoder Encoder matching the size of the region.
+     * @param od4 OD4Session to publish the region to instead of the stream's one.
+     * @return true if the region lies within the frame and matches the encoder.
+     */
+    bool addRegion(const RegionOfInterest &region, std::unique_ptr<StreamEncoder> encoder, std::shared_ptr<cluon::OD4Session> od4 = nullptr) noexcept;
+
+    /**
+     * This method lets the stream encode and publish only while it is the
+     * active instance of a hot-standby pair; it must be called before run.
+     *
+     * @param failover Arbitration with the other instance.
+     */
+    void setFailover(std::shared_ptr<FailoverMonitor> failover) noexcept;
+
+    /**
+     * This method filters every frame with a temporal denoiser before the
+     * frame and its regions are encoded; it must be called before run.
+     *
+     * @param threshold Largest difference to the previous frame that is considered noise (0: off).
+     */
+    void setTemporalDenoise(uint32_t threshold) noexcept;
+
+    /**
+     * This method masks the given areas of every frame before the frame and
+     * its regions are encoded; it must be called before run.
+     *
+     * @param polygons Areas to mask.
+     * @param blur Blur the areas instead of filling them with black.
+     * @param radius Radius of the blur.
+     */
+    void setPrivacyMasks(const std::vector<MaskPolygon> &polygons, bool blur, uint32_t radius) noexcept;
+
+    /**
+     * This method lets the stream classify the first frames and the first
+     * frames of every swapped encoder as screen content or camera video and
+     * set up the encoders of the frame and its regions accordingly once
+     * three non-uniform frames in a row agree; it must be called before run.
+     */
+    void setContentDetection() noexcept;
+
+    /**
+     * This method passes the feedback of a decoder to the encoder of the
+     * frame or region published with the given senderStamp to the given
+     * OD4Session; it is applied before the next frame is encoded. Streams
+     * encoding GOPs in parallel ignore the feedback for the full frame.
+     *
+     * @param od4 OD4Session the feedback was received from.
+     * @param senderStamp senderStamp of the ImageReadings the feedback refers to.
+     * @param feedback Feedback of the decoder.
+     */
+    void feedback(const cluon::OD4Session *od4, uint32_t senderStamp, const ReferenceFeedback &feedback) noexcept;
+
+    /**
+     * This method attaches to the shared memory area and encodes its frames
+     * until stop is called or the area or the OD4Session vanishes.
+     *
+     * @param timeout Seconds to wait for the shared memory area to appear (0: no limit).
+     * @return true if the shared memory area was attached.
+     */
+    bool run(uint32_t timeout) noexcept;
+
+    /**
+     * This method calls run in a separate thread.
+     */
+    void start(uint32_t timeout) noexcept;
+
+    /**
+     * This method stops encoding and waits for the thread started by start.
+     */
+    void stop() noexcept;
+
+    /**
+     * This method replaces the encoder of a running stream at the next frame
+     * boundary; the given encoder needs to start with an IDR frame.
+     *
+     * @param encoder Encoder of the same geometry.
+     * @return Previous encoder or the given one if the stream encodes GOPs in parallel.
+     */
+    std::unique_ptr<StreamEncoder> swapEncoder(std::unique_ptr<StreamEncoder> encoder) noexcept;
+
+    /**
+     * @return Encoders of a stopped stream for reuse.
+     */
+    std::vector<std::unique_ptr<StreamEncoder>> releaseEncoders() noexcept;
+
+    const std::string &name() const noexcept;
+    uint32_t senderStamp() const noexcept;
+    bool isAttached() const noexcept;
+    uint64_t frames() const noexcept;
+    uint64_t bytes() const noexcept;
+
+   private:
+    struct Region {
+        RegionOfInterest roi{};
+        std::unique_ptr<StreamEncoder> encoder{};
+        std::shared_ptr<cluon::OD4Session> od4{};
+        AccessUnit accessUnit{};
+        std::thread worker{};
+    };
+
+    struct PendingFeedback {
+        const cluon::OD4Session *od4{nullptr};
+        uint32_t senderStamp{0};
+        ReferenceFeedback feedback{};
+    };
+
+    void applyFeedback() noexcept;
+    void detectContent(const uint8_t *planes[3], const uint32_t strides[3]) noexcept;
+    void startRegionWorkers() noexcept;
+    void stopRegionWorkers() noexcept;
+    void encodeRegion(Region &region, const uint8_t *planes[3]) noexcept;
+    void startRegions(const uint8_t *planes[3]) noexcept;
+    void waitForRegions() noexcept;
+    void publishRegions(const cluon::data::TimeStamp &sampleTimeStamp) noexcept;
+    void publish(const std::string &data, const cluon::data::TimeStamp &sampleTimeStamp) noexcept;
+    void publish(cluon::OD4Session &od4, const std::string &data, const cluon::data::TimeStamp &sampleTimeStamp, uint32_t senderStamp, uint32_t width, uint32_t height, const std::string &fourcc) noexcept;
+
+   private:
+    std::string m_name{};
+    uint32_t m_senderStamp{0};
+    std::mutex m_encoderMutex{};
+    std::unique_ptr<StreamEncoder> m_encoder{};
+    std::shared_ptr<cluon::OD4Session> m_od4{};
+    std::shared_ptr<FailoverMonitor> m_failover{};
+    std::unique_ptr<TemporalDenoiser> m_denoiser{};
+    std::unique_ptr<PrivacyMask> m_privacyMask{};
+    std::unique_ptr<ContentClassifier> m_classifier{};
+    std::atomic<bool> m_classify{false};
+    uint32_t m_classifiedFrames{0};
+    uint32_t m_agreeingFrames{0}; // Consecutive frames classified as m_screenContent.
+    bool m_screenContent{false};
+    bool m_verbose{false};
+    uint32_t m_width{0};
+    uint32_t m_height{0};
+    std::vector<std::unique_ptr<Region>> m_regions{};
+    std::mutex m_regionsMutex{};
+    std::condition_variable m_regionsStart{};
+    std::condition_variable m_regionsDone{};
+    const uint8_t *m_regionPlanes[3]{nullptr, nullptr, nullptr};
+    uint64_t m_regionsGeneration{0};
+    uint32_t m_regionsPending{0};
+    bool m_regionsStop{false};
+    std::mutex m_feedbackMutex{};
+    std::vector<PendingFeedback> m_feedback{};
+    bool m_parallelFeedbackReported{false};
+
+    std::atomic<bool> m_stop{false};
+    std::atomic<bool> m_attached{false};
+    std::atomic<uint64_t> m_frames{0};
+    std::atomic<uint64_t> m_bytes{0};
+    std::mutex m_sharedMemoryMutex{};
+    std::unique_ptr<cluon::SharedMemory> m_sharedMemory{};
+    std::thread m_thread{};
+    std::unique_ptr<GopParallelEncoder> m_parallelEncoder{};
+};
+
+#endif
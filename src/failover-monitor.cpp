@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cluon-complete.hpp"
+#include "opendlv-video-h264-feedback.hpp"
+#include "failover-monitor.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+FailoverMonitor::FailoverMonitor(std::shared_ptr<cluon::OD4Session> od4, uint32_t senderStamp, bool standby) noexcept
+    : m_od4{od4}
+    , m_senderStamp{senderStamp}
+    , m_active{!standby} {
+    // The token orders the instances by their start time to resolve two active instances.
+    std::stringstream sstr;
+    sstr << std::setw(20) << std::setfill('0') << cluon::time::toMicroseconds(cluon::time::now()) << "/" << ::getpid();
+    m_token = sstr.str();
+
+    if (m_od4) {
+        m_od4->dataTrigger(opendlv::proxy::ImageReadingEncoderHeartbeat::ID(), [this](cluon::data::Envelope &&envelope) { onHeartbeat(std::move(envelope)); });
+    }
+    std::clog << "Failover: starting as " << (m_active ? "active" : "standby") << " instance for senderStamp " << m_senderStamp << "." << std::endl;
+}
+
+FailoverMonitor::~FailoverMonitor() {
+    if (m_od4) {
+        m_od4->dataTrigger(opendlv::proxy::ImageReadingEncoderHeartbeat::ID(), nullptr);
+    }
+}
+
+FailoverMonitor::Role FailoverMonitor::onFrame(const cluon::data::TimeStamp &sampleTimeStamp) noexcept {
+    std::lock_guard<std::mutex> lck(m_mutex);
+    Role role{m_active ? ACTIVE : STANDBY};
+    // The active instance missed the heartbeat for the previous frame.
+    if (!m_active && (0 != m_previousSampleTime) && (m_peerSampleTime < m_previousSampleTime)) {
+        m_active = true;
+        role = TAKEOVER;
+        std::clog << "Failover: no heartbeat for the frame at " << m_previousSampleTime << " microseconds, taking over." << std::endl;
+    }
+    m_previousSampleTime = cluon::time::toMicroseconds(sampleTimeStamp);
+    return role;
+}
+
+void FailoverMonitor::heartbeat(const cluon::data::TimeStamp &sampleTimeStamp) noexcept {
+    if (m_od4 && isActive()) {
+        opendlv::proxy::ImageReadingEncoderHeartbeat heartbeat;
+        heartbeat.token(m_token);
+        m_od4->send(heartbeat, sampleTimeStamp, m_senderStamp);
+    }
+}
+
+bool FailoverMonitor::isActive() const noexcept {
+    std::lock_guard<std::mutex> lck(m_mutex);
+    return m_active;
+}
+
+void FailoverMonitor::onHeartbeat(cluon::data::Envelope &&envelope) noexcept {
+    if (m_senderStamp != envelope.senderStamp()) {
+        return;
+    }
+    const int64_t SAMPLE_TIME{cluon::time::toMicroseconds(envelope.sampleTimeStamp())};
+    opendlv::proxy::ImageReadingEncoderHeartbeat heartbeat = cluon::extractMessage<opendlv::proxy::ImageReadingEncoderHeartbeat>(std::move(envelope));
+    // Our own heartbeats are received as well.
+    if (m_token == heartbeat.token()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lck(m_mutex);
+    m_peerSampleTime = std::max(m_peerSampleTime, SAMPLE_TIME);
+    if (m_active && (heartbeat.token() < m_token)) {
+        m_active = false;
+        std::clog << "Failover: instance " << heartbeat.token() << " is active, returning to standby." << std::endl;
+    }
+}
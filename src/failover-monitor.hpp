@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FAILOVER_MONITOR_HPP
+#define FAILOVER_MONITOR_HPP
+
+#include "cluon-complete.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+/**
+ * Hot-standby arbitration between two instances encoding the same shared
+ * memory area for the same senderStamp: the active instance sends a heartbeat
+ * (ImageReadingEncoderHeartbeat) for every frame it took from the shared memory area;
+ * the standby instance takes over as soon as the heartbeat for the previous
+ * frame is missing. When two instances are active, the one started later
+ * returns to standby.
+ */
+class FailoverMonitor {
+   private:
+    FailoverMonitor(const FailoverMonitor &) = delete;
+    FailoverMonitor(FailoverMonitor &&)      = delete;
+    FailoverMonitor &operator=(const FailoverMonitor &) = delete;
+    FailoverMonitor &operator=(FailoverMonitor &&) = delete;
+
+   public:
+    enum Role {
+        STANDBY,
+        ACTIVE,
+        TAKEOVER, // Active from this frame on; the encoder needs to start with an IDR frame.
+    };
+
+   public:
+    /**
+     * @param od4 OD4Session for the heartbeats; the frames are published there as well.
+     * @param senderStamp senderStamp of the published frames.
+     * @param standby Start as standby instead of as active instance.
+     */
+    FailoverMonitor(std::shared_ptr<cluon::OD4Session> od4, uint32_t senderStamp, bool standby) noexcept;
+    ~FailoverMonitor();
+
+   public:
+    /**
+     * This method decides whether this instance encodes the given frame.
+     *
+     * @param sampleTimeStamp Sample time of the frame from the shared memory area.
+     * @return Role of this instance for this frame.
+     */
+    Role onFrame(const cluon::data::TimeStamp &sampleTimeStamp) noexcept;
+
+    /**
+     * This method sends the heartbeat for a frame taken by the active instance.
+     *
+     * @param sampleTimeStamp Sample time of the frame from the shared memory area.
+     */
+    void heartbeat(const cluon::data::TimeStamp &sampleTimeStamp) noexcept;
+
+    bool isActive() const noexcept;
+
+   private:
+    void onHeartbeat(cluon::data::Envelope &&envelope) noexcept;
+
+   private:
+    std::shared_ptr<cluon::OD4Session> m_od4{};
+    uint32_t m_senderStamp{0};
+    std::string m_token{};
+
+    mutable std::mutex m_mutex{};
+    bool m_active{false};
+    int64_t m_previousSampleTime{0};
+    int64_t m_peerSampleTime{0};
+};
+
+#endif
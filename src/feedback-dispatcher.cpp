@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "cluon-complete.hpp"
+#include "opendlv-video-h264-feedback.hpp"
+#include "feedback-dispatcher.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+FeedbackDispatcher::FeedbackDispatcher(std::shared_ptr<cluon::OD4Session> od4, bool verbose) noexcept
+    : m_od4{od4}
+    , m_verbose{verbose} {
+    if (!m_od4) {
+        return;
+    }
+    m_od4->dataTrigger(opendlv::proxy::ImageReadingLossRecoveryRequest::ID(), [this](cluon::data::Envelope &&envelope) {
+        const uint32_t SENDER_STAMP{envelope.senderStamp()};
+        auto request = cluon::extractMessage<opendlv::proxy::ImageReadingLossRecoveryRequest>(std::move(envelope));
+        ReferenceFeedback feedback;
+        feedback.type = ReferenceFeedback::RECOVERY_REQUEST;
+        feedback.idrPictureId = request.idrPictureId();
+        feedback.frameNumber = request.lastCorrectFrameNumber();
+        feedback.currentFrameNumber = request.currentFrameNumber();
+        dispatch(SENDER_STAMP, feedback);
+    });
+    m_od4->dataTrigger(opendlv::proxy::ImageReadingLtrMarkingFeedback::ID(), [this](cluon::data::Envelope &&envelope) {
+        const uint32_t SENDER_STAMP{envelope.senderStamp()};
+        auto marking = cluon::extractMessage<opendlv::proxy::ImageReadingLtrMarkingFeedback>(std::move(envelope));
+        ReferenceFeedback feedback;
+        feedback.type = marking.decoded() ? ReferenceFeedback::MARKING_SUCCESS : ReferenceFeedback::MARKING_FAILURE;
+        feedback.idrPictureId = marking.idrPictureId();
+        feedback.frameNumber = marking.ltrFrameNumber();
+        dispatch(SENDER_STAMP, feedback);
+    });
+}
+
+FeedbackDispatcher::~FeedbackDispatcher() {
+    if (m_od4) {
+        m_od4->dataTrigger(opendlv::proxy::ImageReadingLossRecoveryRequest::ID(), nullptr);
+        m_od4->dataTrigger(opendlv::proxy::ImageReadingLtrMarkingFeedback::ID(), nullptr);
+    }
+}
+
+void FeedbackDispatcher::add(EncodingStream *stream) noexcept {
+    std::lock_guard<std::mutex> lck(m_streamsMutex);
+    if ((nullptr != stream) && (m_streams.end() == std::find(m_streams.begin(), m_streams.end(), stream))) {
+        m_streams.push_back(stream);
+    }
+}
+
+void FeedbackDispatcher::remove(EncodingStream *stream) noexcept {
+    std::lock_guard<std::mutex> lck(m_streamsMutex);
+    m_streams.erase(std::remove(m_streams.begin(), m_streams.end(), stream), m_streams.end());
+}
+
+void FeedbackDispatcher::dispatch(uint32_t senderStamp, const ReferenceFeedback &feedback) noexcept {
+    if (m_verbose) {
+        std::clog << ((ReferenceFeedback::RECOVERY_REQUEST == feedback.type) ? "Loss recovery request" : "Long-term reference marking feedback")
+                  << " for senderStamp " << senderStamp << " (IDR " << feedback.idrPictureId << ", frame " << feedback.frameNumber << ")." << std::endl;
+    }
+    std::lock_guard<std::mutex> lck(m_streamsMutex);
+    for (auto stream : m_streams) {
+        stream->feedback(m_od4.get(), senderStamp, feedback);
+    }
+}
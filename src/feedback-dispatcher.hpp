@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef FEEDBACK_DISPATCHER_HPP
+#define FEEDBACK_DISPATCHER_HPP
+
+#include "cluon-complete.hpp"
+#include "encoding-stream.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * Receiver of the loss recovery requests and the long-term reference marking
+ * feedback sent by decoders to an OD4Session; the feedback is passed to the
+ * streams publishing to that OD4Session.
+ */
+class FeedbackDispatcher {
+   private:
+    FeedbackDispatcher(const FeedbackDispatcher &) = delete;
+    FeedbackDispatcher(FeedbackDispatcher &&)      = delete;
+    FeedbackDispatcher &operator=(const FeedbackDispatcher &) = delete;
+    FeedbackDispatcher &operator=(FeedbackDispatcher &&) = delete;
+
+   public:
+    /**
+     * @param od4 OD4Session to receive the feedback from.
+     * @param verbose Print every received feedback.
+     */
+    FeedbackDispatcher(std::shared_ptr<cluon::OD4Session> od4, bool verbose) noexcept;
+    ~FeedbackDispatcher();
+
+   public:
+    /**
+     * @param stream Stream to pass the feedback to; it must be removed before it is released.
+     */
+    void add(EncodingStream *stream) noexcept;
+    void remove(EncodingStream *stream) noexcept;
+
+   private:
+    void dispatch(uint32_t senderStamp, const ReferenceFeedback &feedback) noexcept;
+
+   private:
+    std::shared_ptr<cluon::OD4Session> m_od4{};
+    bool m_verbose{false};
+    std::mutex m_streamsMutex{};
+    std::vector<EncodingStream*> m_streams{};
+};
+
+#endif
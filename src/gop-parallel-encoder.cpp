@@ -0,0 +1,240 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gop-parallel-encoder.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+GopParallelEncoder::GopParallelEncoder(std::vector<std::unique_ptr<StreamEncoder>> encoders, uint32_t gop, std::function<void(EncodedFrame &&)> delivery, bool dropWhenBehind) noexcept
+    : m_gop{std::max(gop, 1u)}
+    , m_dropWhenBehind{dropWhenBehind}
+    , m_delivery{delivery}
+    , m_instances(encoders.size()) {
+    for (size_t i{0}; i < encoders.size(); i++) {
+        m_instances[i].encoder = std::move(encoders[i]);
+    }
+    if (!valid()) {
+        return;
+    }
+    m_width = m_instances[0].encoder->width();
+    m_height = m_instances[0].encoder->height();
+    for (auto &instance : m_instances) {
+        Instance *i{&instance};
+        instance.thread = std::thread([this, i]() { encode(*i); });
+    }
+}
+
+GopParallelEncoder::~GopParallelEncoder() {
+    stop();
+}
+
+bool GopParallelEncoder::valid() const noexcept {
+    bool valid{!m_instances.empty()};
+    for (auto &instance : m_instances) {
+        valid &= (instance.encoder && instance.encoder->valid());
+    }
+    return valid;
+}
+
+uint32_t GopParallelEncoder::instances() const noexcept {
+    return static_cast<uint32_t>(m_instances.size());
+}
+
+const char *GopParallelEncoder::fourcc() const noexcept {
+    return (m_instances.empty() || !m_instances[0].encoder) ? "" : m_instances[0].encoder->fourcc();
+}
+
+bool GopParallelEncoder::push(const uint8_t *planes[3], const uint32_t strides[3], int64_t sampleTime) noexcept {
+    if (m_stop.load() || !valid()) {
+        return false;
+    }
+    const uint32_t WIDTHS[3]{m_width, m_width / 2, m_width / 2};
+    const uint32_t HEIGHTS[3]{m_height, m_height / 2, m_height / 2};
+    bool queued{false};
+    {
+        std::unique_lock<std::mutex> lck(m_mutex);
+        const uint64_t NUMBER{m_nextInput++};
+        Instance &instance{m_instances[(NUMBER / m_gop) % m_instances.size()]};
+        if (!m_dropWhenBehind) {
+            m_progress.wait(lck, [this, &instance]() { return m_stop.load() || (instance.queue.size() < m_gop); });
+            if (m_stop.load()) {
+                return false;
+            }
+        }
+        if (instance.queue.size() >= m_gop) {
+            // This instance is more than one GOP behind; drop the frame to bound the latency.
+            EncodedFrame dropped;
+            dropped.number = NUMBER;
+            dropped.sampleTime = sampleTime;
+            dropped.frameType = videoFrameTypeSkip;
+            m_reorderBuffer[NUMBER] = std::move(dropped);
+            // The instance must not continue the GOP with P frames referring
+            // to its previous GOP, which the decoder has already left.
+            instance.intraPending |= (0 == (NUMBER % m_gop));
+        }
+        else {
+            Frame frame;
+            frame.number = NUMBER;
+            frame.sampleTime = sampleTime;
+            frame.intra = (0 == (NUMBER % m_gop)) || instance.intraPending || m_intraRequested;
+            instance.intraPending = false;
+            m_intraRequested = false;
+            if (!m_freeBuffers.empty()) {
+                frame.data = std::move(m_freeBuffers.back());
+                m_freeBuffers.pop_back();
+            }
+            lck.unlock();
+
+            // The frame is copied outside of the lock as the shared memory area is reused for the next frame.
+            frame.data.resize(m_width * m_height * 3 / 2);
+            uint8_t *destination{frame.data.data()};
+            for (uint8_t plane{0}; plane < 3; plane++) {
+                for (uint32_t y{0}; y < HEIGHTS[plane]; y++) {
+                    memcpy(destination, planes[plane] + y * strides[plane], WIDTHS[plane]);
+                    destination += WIDTHS[plane];
+                }
+            }
+
+            lck.lock();
+            instance.queue.push_back(std::move(frame));
+            queued = true;
+        }
+    }
+    if (queued) {
+        m_frameQueued.notify_all();
+    }
+    else {
+        deliver();
+    }
+    return queued;
+}
+
+void GopParallelEncoder::forceIntraFrame() noexcept {
+    std::lock_guard<std::mutex> lck(m_mutex);
+    m_intraRequested = true;
+}
+
+bool GopParallelEncoder::setScreenContent(bool screenContent) noexcept {
+    bool supported{true};
+    for (auto &instance : m_instances) {
+        std::lock_guard<std::mutex> lck(instance.encoderMutex);
+        supported = instance.encoder && instance.encoder->setScreenContent(screenContent) && supported;
+    }
+    return supported;
+}
+
+void GopParallelEncoder::flush() noexcept {
+    std::unique_lock<std::mutex> lck(m_mutex);
+    m_progress.wait(lck, [this]() { return m_stop.load() || (m_nextOutput == m_nextInput); });
+}
+
+std::vector<std::unique_ptr<StreamEncoder>> GopParallelEncoder::releaseEncoders() noexcept {
+    stop();
+    std::vector<std::unique_ptr<StreamEncoder>> encoders;
+    for (auto &instance : m_instances) {
+        encoders.push_back(std::move(instance.encoder));
+    }
+    return encoders;
+}
+
+void GopParallelEncoder::encode(Instance &instance) noexcept {
+    const uint32_t WIDTH{m_width};
+    const uint32_t HEIGHT{m_height};
+    while (!m_stop.load()) {
+        Frame frame;
+        {
+            std::unique_lock<std::mutex> lck(m_mutex);
+            m_frameQueued.wait(lck, [this, &instance]() { return m_stop.load() || !instance.queue.empty(); });
+            if (m_stop.load()) {
+                break;
+            }
+            frame = std::move(instance.queue.front());
+            instance.queue.pop_front();
+        }
+        m_progress.notify_all();
+
+        const uint8_t *planes[3]{frame.data.data(), frame.data.data() + WIDTH * HEIGHT, frame.data.data() + WIDTH * HEIGHT + ((WIDTH * HEIGHT) >> 2)};
+        const uint32_t strides[3]{WIDTH, WIDTH / 2, WIDTH / 2};
+        AccessUnit accessUnit;
+        EncodedFrame encoded;
+        encoded.number = frame.number;
+        encoded.sampleTime = frame.sampleTime;
+        {
+            std::lock_guard<std::mutex> encoderLock(instance.encoderMutex);
+            // Every GOP is closed, i.e., it starts with an IDR frame.
+            if (frame.intra) {
+                instance.encoder->forceIntraFrame();
+            }
+            if (instance.encoder->encode(planes, strides, accessUnit)) {
+                encoded.frameType = accessUnit.frameType;
+                encoded.data = std::string(accessUnit.data, accessUnit.size);
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lck(m_mutex);
+            m_reorderBuffer[encoded.number] = std::move(encoded);
+            m_freeBuffers.push_back(std::move(frame.data));
+        }
+        deliver();
+    }
+}
+
+void GopParallelEncoder::deliver() noexcept {
+    // One thread at a time delivers the frames that are complete in order;
+    // the others leave their frames to it instead of waiting, so that neither
+    // push nor the encoders block on a slow delivery.
+    m_deliveryRequested = true;
+    while (m_deliveryRequested.load()) {
+        std::unique_lock<std::mutex> deliveryLock(m_deliveryMutex, std::try_to_lock);
+        if (!deliveryLock.owns_lock()) {
+            break;
+        }
+        m_deliveryRequested = false;
+        while (true) {
+            EncodedFrame next;
+            {
+                std::lock_guard<std::mutex> lck(m_mutex);
+                auto it = m_reorderBuffer.find(m_nextOutput);
+                if (m_reorderBuffer.end() == it) {
+                    break;
+                }
+                next = std::move(it->second);
+                m_reorderBuffer.erase(it);
+                m_nextOutput++;
+            }
+            if (m_delivery) {
+                m_delivery(std::move(next));
+            }
+        }
+    }
+    m_progress.notify_all();
+}
+
+void GopParallelEncoder::stop() noexcept {
+    {
+        std::lock_guard<std::mutex> lck(m_mutex);
+        m_stop = true;
+    }
+    m_frameQueued.notify_all();
+    m_progress.notify_all();
+    for (auto &instance : m_instances) {
+        if (instance.thread.joinable()) {
+            instance.thread.join();
+        }
+    }
+}
@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GOP_PARALLEL_ENCODER_HPP
+#define GOP_PARALLEL_ENCODER_HPP
+
+#include "stream-encoder.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Encoded frame in the order of the input frames.
+ */
+struct EncodedFrame {
+    uint64_t number{0};
+    int64_t sampleTime{0}; // Microseconds.
+    int32_t frameType{videoFrameTypeInvalid}; // EVideoFrameType; skipped or dropped frames have no data.
+    std::string data{};
+};
+
+/**
+ * Encoder that distributes consecutive closed GOPs round-robin to several
+ * encoder instances running in parallel and delivers their output in the
+ * order of the input frames from a reorder buffer. The throughput scales
+ * with the number of instances at the cost of an added latency of up to one
+ * GOP; frames for an instance that is already one GOP behind are dropped or,
+ * for offline use, wait for the instance.
+ */
+class GopParallelEncoder {
+   private:
+    GopParallelEncoder(const GopParallelEncoder &) = delete;
+    GopParallelEncoder(GopParallelEncoder &&)      = delete;
+    GopParallelEncoder &operator=(const GopParallelEncoder &) = delete;
+    GopParallelEncoder &operator=(GopParallelEncoder &&) = delete;
+
+   public:
+    /**
+     * @param encoders Encoder instances of the same configuration.
+     * @param gop Length of the GOPs, i.e., the intra period of the encoders.
+     * @param delivery Function called in frame order from the encoding threads.
+     * @param dropWhenBehind Drop frames for an instance that is one GOP behind instead of waiting.
+     */
+    GopParallelEncoder(std::vector<std::unique_ptr<StreamEncoder>> encoders, uint32_t gop, std::function<void(EncodedFrame &&)> delivery, bool dropWhenBehind = true) noexcept;
+    ~GopParallelEncoder();
+
+   public:
+    bool valid() const noexcept;
+    uint32_t instances() const noexcept;
+    const char *fourcc() const noexcept;
+
+    /**
+     * This method copies the frame and queues it for its encoder instance.
+     *
+     * @param planes Y, U, and V planes of the frame.
+     * @param strides Strides of the Y, U, and V planes.
+     * @param sampleTime Sample time of the frame in microseconds.
+     * @return false if the frame was dropped.
+     */
+    bool push(const uint8_t *planes[3], const uint32_t strides[3], int64_t sampleTime) noexcept;
+
+    /**
+     * This method requests the next pushed frame to be encoded as IDR frame,
+     * e.g., to recover from a loss reported by a decoder.
+     */
+    void forceIntraFrame() noexcept;
+
+    /**
+     * This method re-initializes the encoders for the given type of content
+     * between two of their frames; their next frames are IDR frames.
+     *
+     * @param screenContent The frames are screen content instead of camera video.
+     * @return true if all encoders are set up for the given type of content.
+     */
+    bool setScreenContent(bool screenContent) noexcept;
+
+    /**
+     * This method waits until all pushed frames were delivered.
+     */
+    void flush() noexcept;
+
+    /**
+     * @return Encoder instances after the threads were stopped.
+     */
+    std::vector<std::unique_ptr<StreamEncoder>> releaseEncoders() noexcept;
+
+   private:
+    struct Frame {
+        uint64_t number{0};
+        int64_t sampleTime{0};
+        bool intra{false};
+        std::vector<uint8_t> data{};
+    };
+
+    struct Instance {
+        std::mutex encoderMutex{}; // Held while the encoder encodes a frame.
+        std::unique_ptr<StreamEncoder> encoder{};
+        std::deque<Frame> queue{};
+        bool intraPending{false}; // The first frame of the current GOP was dropped.
+        std::thread thread{};
+    };
+
+    void encode(Instance &instance) noexcept;
+    void deliver() noexcept;
+    void stop() noexcept;
+
+   private:
+    uint32_t m_gop{1};
+    bool m_dropWhenBehind{true};
+    uint32_t m_width{0};
+    uint32_t m_height{0};
+    std::function<void(EncodedFrame &&)> m_delivery{};
+    std::vector<Instance> m_instances{};
+
+    std::atomic<bool> m_stop{false};
+    std::mutex m_mutex{};
+    std::condition_variable m_frameQueued{};
+    std::condition_variable m_progress{};
+    bool m_intraRequested{false};
+    uint64_t m_nextInput{0};
+    uint64_t m_nextOutput{0};
+    std::map<uint64_t, EncodedFrame> m_reorderBuffer{};
+    std::vector<std::vector<uint8_t>> m_freeBuffers{};
+
+    std::mutex m_deliveryMutex{};
+    std::atomic<bool> m_deliveryRequested{false};
+};
+
+#endif
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "h264-decoder.hpp"
+
+#include <cstring>
+
+H264Decoder::H264Decoder() noexcept {
+    if ((0 != WelsCreateDecoder(&m_decoder)) || (nullptr == m_decoder)) {
+        m_decoder = nullptr;
+        return;
+    }
+
+    SDecodingParam decodingParameters;
+    memset(&decodingParameters, 0, sizeof(SDecodingParam));
+    decodingParameters.eEcActiveIdc = ERROR_CON_IDC::ERROR_CON_SLICE_MV_COPY_CROSS_IDR_FREEZE_RES_CHANGE;
+    decodingParameters.sVideoProperty.eVideoBsType = VIDEO_BITSTREAM_TYPE::VIDEO_BITSTREAM_AVC;
+    if (cmResultSuccess != m_decoder->Initialize(&decodingParameters)) {
+        WelsDestroyDecoder(m_decoder);
+        m_decoder = nullptr;
+    }
+}
+
+H264Decoder::~H264Decoder() {
+    if (nullptr != m_decoder) {
+        m_decoder->Uninitialize();
+        WelsDestroyDecoder(m_decoder);
+    }
+}
+
+bool H264Decoder::valid() const noexcept {
+    return (nullptr != m_decoder);
+}
+
+bool H264Decoder::decode(const uint8_t *data, uint32_t size, DecodedPicture &picture) noexcept {
+    if (nullptr == m_decoder) {
+        return false;
+    }
+
+    SBufferInfo bufferInfo;
+    memset(&bufferInfo, 0, sizeof(SBufferInfo));
+    unsigned char *yuv[3]{nullptr, nullptr, nullptr};
+    const DECODING_STATE state{m_decoder->DecodeFrameNoDelay(data, static_cast<int>(size), yuv, &bufferInfo)};
+    if ((dsErrorFree != state) || (1 != bufferInfo.iBufferStatus)) {
+        return false;
+    }
+
+    picture.planes[0] = yuv[0];
+    picture.planes[1] = yuv[1];
+    picture.planes[2] = yuv[2];
+    picture.strides[0] = static_cast<uint32_t>(bufferInfo.UsrData.sSystemBuffer.iStride[0]);
+    picture.strides[1] = static_cast<uint32_t>(bufferInfo.UsrData.sSystemBuffer.iStride[1]);
+    picture.strides[2] = static_cast<uint32_t>(bufferInfo.UsrData.sSystemBuffer.iStride[1]);
+    picture.width = static_cast<uint32_t>(bufferInfo.UsrData.sSystemBuffer.iWidth);
+    picture.height = static_cast<uint32_t>(bufferInfo.UsrData.sSystemBuffer.iHeight);
+    return true;
+}
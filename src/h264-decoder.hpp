@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef H264_DECODER_HPP
+#define H264_DECODER_HPP
+
+#include <wels/codec_api.h>
+
+#include <cstdint>
+
+/**
+ * Decoded I420 picture; the planes are owned by the decoder and remain
+ * valid until the next call to decode.
+ */
+struct DecodedPicture {
+    const uint8_t *planes[3]{nullptr, nullptr, nullptr};
+    uint32_t strides[3]{0, 0, 0};
+    uint32_t width{0};
+    uint32_t height{0};
+};
+
+/**
+ * Thin wrapper around openh264's decoder to verify encoded frames.
+ */
+class H264Decoder {
+   private:
+    H264Decoder(const H264Decoder &) = delete;
+    H264Decoder(H264Decoder &&)      = delete;
+    H264Decoder &operator=(const H264Decoder &) = delete;
+    H264Decoder &operator=(H264Decoder &&) = delete;
+
+   public:
+    H264Decoder() noexcept;
+    ~H264Decoder();
+
+   public:
+    bool valid() const noexcept;
+
+    /**
+     * @param data h264 access unit.
+     * @param size Length of the access unit in bytes.
+     * @param picture Decoded picture if one is available.
+     * @return true if the access unit was decoded without errors and a picture is available.
+     */
+    bool decode(const uint8_t *data, uint32_t size, DecodedPicture &picture) noexcept;
+
+   private:
+    ISVCDecoder *m_decoder{nullptr};
+};
+
+#endif
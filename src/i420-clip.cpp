@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cluon-complete.hpp"
+#include "opendlv-standard-message-set.hpp"
+#include "i420-clip.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+void generateSyntheticI420(uint8_t *dst, uint32_t width, uint32_t height, uint32_t frameNumber) noexcept {
+    uint8_t *y{dst};
+    uint8_t *u{dst + width * height};
+    uint8_t *v{u + (width / 2) * (height / 2)};
+
+    // Object moving along the diagonal.
+    const uint32_t OBJECT_SIZE{height / 6 + 1};
+    const uint32_t objectX{(frameNumber * 7) % (width > OBJECT_SIZE ? width - OBJECT_SIZE : 1)};
+    const uint32_t objectY{(frameNumber * 3) % (height > OBJECT_SIZE ? height - OBJECT_SIZE : 1)};
+
+    // xorshift32 seeded per frame to add reproducible sensor-like noise.
+    uint32_t state{2463534242u ^ (frameNumber * 2654435761u)};
+    for (uint32_t row{0}; row < height; row++) {
+        for (uint32_t col{0}; col < width; col++) {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            const int32_t noise{static_cast<int32_t>(state & 0x7) - 4};
+
+            int32_t value{static_cast<int32_t>(((col + frameNumber * 2) + (row / 2)) & 0xFF)};
+            if ((row > height / 2) && (col < width / 3)) {
+                // Static texture in the lower left corner.
+                value = (((row / 4) + (col / 4)) & 0x1) ? 200 : 40;
+            }
+            if ((col >= objectX) && (col < objectX + OBJECT_SIZE) && (row >= objectY) && (row < objectY + OBJECT_SIZE)) {
+                value = 235;
+            }
+            value += noise;
+            y[row * width + col] = static_cast<uint8_t>(value < 0 ? 0 : (value > 255 ? 255 : value));
+        }
+    }
+    for (uint32_t row{0}; row < height / 2; row++) {
+        for (uint32_t col{0}; col < width / 2; col++) {
+            u[row * (width / 2) + col] = static_cast<uint8_t>(128 + ((col + frameNumber) & 0x3F) - 32);
+            v[row * (width / 2) + col] = static_cast<uint8_t>(128 + ((row + frameNumber) & 0x1F) - 16);
+        }
+    }
+}
+
+bool I420Clip::load(const std::string &filename, uint32_t width, uint32_t height, uint32_t maxFrames) noexcept {
+    m_name = filename;
+    m_width = width;
+    m_height = height;
+    m_data.clear();
+
+    std::ifstream in(filename, std::ios::binary);
+    if (in.good()) {
+        std::vector<uint8_t> buffer(frameSize());
+        for (uint32_t i{0}; ((0 == maxFrames) || (i < maxFrames)); i++) {
+            if (!in.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()))) {
+                break;
+            }
+            m_data.insert(m_data.end(), buffer.begin(), buffer.end());
+        }
+    }
+    return (0 < frames());
+}
+
+bool I420Clip::loadRecording(const std::string &filename, uint32_t maxFrames) noexcept {
+    m_name = filename;
+    m_width = 0;
+    m_height = 0;
+    m_data.clear();
+
+    cluon::Player player(filename, false /*autoRewind*/, false /*threading*/);
+    while (player.hasMoreData() && ((0 == maxFrames) || (frames() < maxFrames))) {
+        auto next = player.getNextEnvelopeToBeReplayed();
+        if (!next.first) {
+            break;
+        }
+        if (opendlv::proxy::ImageReading::ID() != next.second.dataType()) {
+            continue;
+        }
+        opendlv::proxy::ImageReading ir = cluon::extractMessage<opendlv::proxy::ImageReading>(std::move(next.second));
+        std::string fourcc{ir.fourcc()};
+        std::transform(fourcc.begin(), fourcc.end(), fourcc.begin(), ::tolower);
+        if (("i420" != fourcc) && ("yu12" != fourcc)) {
+            continue;
+        }
+        if (0 == m_width) {
+            m_width = ir.width();
+            m_height = ir.height();
+        }
+        const std::string FRAME{ir.data()};
+        if ((m_width == ir.width()) && (m_height == ir.height()) && (FRAME.size() >= frameSize())) {
+            m_data.insert(m_data.end(), FRAME.begin(), FRAME.begin() + frameSize());
+        }
+    }
+    return (0 < frames());
+}
+
+void I420Clip::generate(uint32_t width, uint32_t height, uint32_t frames) noexcept {
+    std::stringstream sstr;
+    sstr << "synthetic-" << width << "x" << height;
+    m_name = sstr.str();
+    m_width = width;
+    m_height = height;
+    m_data.resize(static_cast<size_t>(frameSize()) * frames);
+    for (uint32_t i{0}; i < frames; i++) {
+        generateSyntheticI420(&m_data[static_cast<size_t>(frameSize()) * i], width, height, i);
+    }
+}
+
+std::string I420Clip::name() const noexcept {
+    return m_name;
+}
+
+uint32_t I420Clip::width() const noexcept {
+    return m_width;
+}
+
+uint32_t I420Clip::height() const noexcept {
+    return m_height;
+}
+
+uint32_t I420Clip::frames() const noexcept {
+    return (0 < frameSize()) ? static_cast<uint32_t>(m_data.size() / frameSize()) : 0;
+}
+
+uint32_t I420Clip::frameSize() const noexcept {
+    return m_width * m_height + 2 * ((m_width / 2) * (m_height / 2));
+}
+
+const uint8_t *I420Clip::frame(uint32_t index) const noexcept {
+    return &m_data[static_cast<size_t>(frameSize()) * (index % frames())];
+}
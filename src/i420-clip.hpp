@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef I420_CLIP_HPP
+#define I420_CLIP_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * This function renders a deterministic synthetic I420 frame (moving
+ * gradient, moving object, texture, and sensor-like noise) into dst.
+ *
+ * @param dst Buffer of at least width * height * 3 / 2 bytes.
+ * @param width Width of the frame.
+ * @param height Height of the frame.
+ * @param frameNumber Number of the frame to render.
+ */
+void generateSyntheticI420(uint8_t *dst, uint32_t width, uint32_t height, uint32_t frameNumber) noexcept;
+
+/**
+ * In-memory sequence of I420 frames that is either loaded from a raw .yuv
+ * file or generated synthetically.
+ */
+class I420Clip {
+   public:
+    I420Clip() = default;
+
+   public:
+    /**
+     * @return true if at least one frame could be loaded from the raw I420 file.
+     */
+    bool load(const std::string &filename, uint32_t width, uint32_t height, uint32_t maxFrames) noexcept;
+
+    /**
+     * @return true if at least one frame could be loaded from the ImageReadings
+     *         with fourcc i420 of a recording; the geometry is taken from the first one.
+     */
+    bool loadRecording(const std::string &filename, uint32_t maxFrames) noexcept;
+
+    void generate(uint32_t width, uint32_t height, uint32_t frames) noexcept;
+
+    std::string name() const noexcept;
+    uint32_t width() const noexcept;
+    uint32_t height() const noexcept;
+    uint32_t frames() const noexcept;
+    uint32_t frameSize() const noexcept;
+    const uint8_t *frame(uint32_t index) const noexcept;
+
+   private:
+    std::string m_name{};
+    uint32_t m_width{0};
+    uint32_t m_height{0};
+    std::vector<uint8_t> m_data{};
+};
+
+#endif
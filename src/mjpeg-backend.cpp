@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mjpeg-backend.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+/**
+ * @return Scaling of the quantization tables in percent for a JPEG quality (see jpeg_quality_scaling).
+ */
+uint32_t qualityToScale(uint32_t quality) noexcept {
+    return (quality < 50) ? 5000 / quality : 200 - 2 * quality;
+}
+
+/**
+ * @return JPEG quality for a scaling of the quantization tables in percent.
+ */
+uint32_t scaleToQuality(uint32_t scale) noexcept {
+    return (scale <= 100) ? (200 - scale) / 2 : std::max(5000 / scale, 1u);
+}
+
+} // namespace
+
+MjpegBackend::MjpegBackend(uint32_t width, uint32_t height, std::map<std::string, std::string> &arguments) noexcept
+    : m_width{width}
+    , m_height{height}
+    , m_paddedWidth{(width + 15) & ~15u} {
+    const uint32_t QUALITY_MIN{1};
+    const uint32_t QUALITY_MAX{100};
+    uint32_t quality{80};
+    try {
+        quality = (arguments["jpeg-quality"].size() != 0) ? std::min(std::max(static_cast<uint32_t>(std::stoi(arguments["jpeg-quality"])), QUALITY_MIN), QUALITY_MAX) : quality;
+    }
+    catch (...) {
+        return;
+    }
+    // Only members are used after setjmp as longjmp may clobber locals.
+    m_quality = quality;
+    m_lastQuality = quality;
+
+    // libjpeg reports errors via error_exit, which would terminate the process by default.
+    m_compressor.err = jpeg_std_error(&m_errorManager);
+    m_errorManager.error_exit = &MjpegBackend::onError;
+    m_compressor.client_data = this;
+    if (0 != setjmp(m_jump)) {
+        jpeg_destroy_compress(&m_compressor);
+        return;
+    }
+    jpeg_create_compress(&m_compressor);
+
+    m_destination.init_destination = &MjpegBackend::onInitDestination;
+    m_destination.empty_output_buffer = &MjpegBackend::onEmptyOutputBuffer;
+    m_destination.term_destination = &MjpegBackend::onTermDestination;
+    m_compressor.dest = &m_destination;
+
+    m_compressor.image_width = m_width;
+    m_compressor.image_height = m_height;
+    m_compressor.input_components = 3;
+    m_compressor.in_color_space = JCS_YCbCr;
+    jpeg_set_defaults(&m_compressor);
+    jpeg_set_colorspace(&m_compressor, JCS_YCbCr);
+    jpeg_set_quality(&m_compressor, static_cast<int>(m_quality), TRUE);
+
+    // I420 is 4:2:0, i.e., one MCU covers 16x16 luma and 8x8 chroma samples.
+    m_compressor.raw_data_in = TRUE;
+    m_compressor.dct_method = JDCT_IFAST;
+    m_compressor.comp_info[0].h_samp_factor = 2;
+    m_compressor.comp_info[0].v_samp_factor = 2;
+    m_compressor.comp_info[1].h_samp_factor = 1;
+    m_compressor.comp_info[1].v_samp_factor = 1;
+    m_compressor.comp_info[2].h_samp_factor = 1;
+    m_compressor.comp_info[2].v_samp_factor = 1;
+
+    if (m_paddedWidth != m_width) {
+        m_padded.resize(m_paddedWidth * 16 + 2 * (m_paddedWidth / 2) * 8);
+    }
+    m_buffer.resize(m_width * m_height / 2);
+    m_valid = true;
+}
+
+MjpegBackend::~MjpegBackend() {
+    if (m_valid) {
+        jpeg_destroy_compress(&m_compressor);
+    }
+}
+
+bool MjpegBackend::valid() const noexcept {
+    return m_valid;
+}
+
+const char *MjpegBackend::fourcc() const noexcept {
+    return "MJPG";
+}
+
+int32_t MjpegBackend::targetBitrate() const noexcept {
+    return 0; // Quality-based without rate control.
+}
+
+void MjpegBackend::forceIntraFrame() noexcept {
+    // Every frame is an intra frame.
+}
+
+bool MjpegBackend::supportsCoarsening() const noexcept {
+    return true;
+}
+
+bool MjpegBackend::coarsenNextFrame(uint32_t steps) noexcept {
+    if (!m_valid || (1 >= m_lastQuality)) {
+        return false;
+    }
+    // Like the quantizer of h264 for six QP steps, the quantization tables
+    // double with every six steps.
+    const double SCALE{std::min(qualityToScale(m_lastQuality) * std::pow(2.0, static_cast<double>(std::max(steps, 1u)) / 6.0), 5000.0)};
+    m_nextQuality = std::min(scaleToQuality(static_cast<uint32_t>(std::lround(SCALE))), m_lastQuality - 1);
+    return true;
+}
+
+bool MjpegBackend::encode(const uint8_t *planes[3], const uint32_t strides[3], AccessUnit &accessUnit, int64_t /*timeStamp*/) noexcept {
+    accessUnit = AccessUnit{};
+    if (!m_valid) {
+        return false;
+    }
+    if (0 != setjmp(m_jump)) {
+        jpeg_abort_compress(&m_compressor);
+        return false;
+    }
+
+    // Only the re-encoded frame has the lower quality.
+    const uint32_t QUALITY{(0 < m_nextQuality) ? m_nextQuality : m_quality};
+    m_nextQuality = 0;
+    if (QUALITY != m_lastQuality) {
+        jpeg_set_quality(&m_compressor, static_cast<int>(QUALITY), TRUE);
+        m_lastQuality = QUALITY;
+    }
+
+    jpeg_start_compress(&m_compressor, TRUE);
+    JSAMPROW rows[3][16];
+    JSAMPARRAY mcuRows[3]{rows[0], rows[1], rows[2]};
+    for (uint32_t y{0}; y < m_height; y += 16) {
+        for (uint8_t plane{0}; plane < 3; plane++) {
+            const uint32_t LINES{(0 == plane) ? 16u : 8u};
+            const uint32_t WIDTH{(0 == plane) ? m_width : m_width / 2};
+            const uint32_t HEIGHT{(0 == plane) ? m_height : m_height / 2};
+            const uint32_t PADDED_WIDTH{(0 == plane) ? m_paddedWidth : m_paddedWidth / 2};
+            uint8_t *padded{m_padded.data() + ((0 == plane) ? 0 : m_paddedWidth * 16 + (plane - 1) * PADDED_WIDTH * 8)};
+            for (uint32_t line{0}; line < LINES; line++) {
+                // Repeat the last line below the picture.
+                const uint32_t row{std::min(y * LINES / 16 + line, HEIGHT - 1)};
+                const uint8_t *source{planes[plane] + row * strides[plane]};
+                if (m_padded.empty()) {
+                    rows[plane][line] = const_cast<JSAMPROW>(source);
+                }
+                else {
+                    // Repeat the last column right of the picture.
+                    memcpy(padded + line * PADDED_WIDTH, source, WIDTH);
+                    memset(padded + line * PADDED_WIDTH + WIDTH, source[WIDTH - 1], PADDED_WIDTH - WIDTH);
+                    rows[plane][line] = padded + line * PADDED_WIDTH;
+                }
+            }
+        }
+        jpeg_write_raw_data(&m_compressor, mcuRows, 16);
+    }
+    jpeg_finish_compress(&m_compressor);
+
+    accessUnit.data = m_buffer.data();
+    accessUnit.size = static_cast<uint32_t>(m_buffer.size() - m_destination.free_in_buffer);
+    accessUnit.frameType = videoFrameTypeIDR; // Every frame is decodable on its own.
+    return true;
+}
+
+void MjpegBackend::onError(j_common_ptr compressor) {
+    MjpegBackend *backend{reinterpret_cast<MjpegBackend*>(compressor->client_data)};
+    longjmp(backend->m_jump, 1);
+}
+
+void MjpegBackend::onInitDestination(j_compress_ptr compressor) {
+    MjpegBackend *backend{reinterpret_cast<MjpegBackend*>(compressor->client_data)};
+    backend->m_destination.next_output_byte = reinterpret_cast<JOCTET*>(backend->m_buffer.data());
+    backend->m_destination.free_in_buffer = backend->m_buffer.size();
+}
+
+boolean MjpegBackend::onEmptyOutputBuffer(j_compress_ptr compressor) {
+    // The buffer is full; it grows and keeps its size for the next frames.
+    MjpegBackend *backend{reinterpret_cast<MjpegBackend*>(compressor->client_data)};
+    const size_t used{backend->m_buffer.size()};
+    backend->m_buffer.resize(used * 2);
+    backend->m_destination.next_output_byte = reinterpret_cast<JOCTET*>(backend->m_buffer.data() + used);
+    backend->m_destination.free_in_buffer = backend->m_buffer.size() - used;
+    return TRUE;
+}
+
+void MjpegBackend::onTermDestination(j_compress_ptr /*compressor*/) {
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MJPEG_BACKEND_HPP
+#define MJPEG_BACKEND_HPP
+
+#include "encoder-backend.hpp"
+
+#include <csetjmp>
+#include <cstdint>
+#include <cstdio>
+#include <jpeglib.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * Intra-only encoder backend using libjpeg(-turbo) that compresses the I420
+ * planes directly (raw data input) into one JPEG per frame ("MJPG").
+ */
+class MjpegBackend : public EncoderBackend {
+   private:
+    MjpegBackend(const MjpegBackend &) = delete;
+    MjpegBackend(MjpegBackend &&)      = delete;
+    MjpegBackend &operator=(const MjpegBackend &) = delete;
+    MjpegBackend &operator=(MjpegBackend &&) = delete;
+
+   public:
+    MjpegBackend(uint32_t width, uint32_t height, std::map<std::string, std::string> &arguments) noexcept;
+    ~MjpegBackend() override;
+
+   public:
+    bool valid() const noexcept override;
+    const char *fourcc() const noexcept override;
+    int32_t targetBitrate() const noexcept override;
+    void forceIntraFrame() noexcept override;
+    bool supportsCoarsening() const noexcept override;
+    bool coarsenNextFrame(uint32_t steps) noexcept override;
+    bool encode(const uint8_t *planes[3], const uint32_t strides[3], AccessUnit &accessUnit, int64_t timeStamp) noexcept override;
+
+   private:
+    [[noreturn]] static void onError(j_common_ptr compressor);
+    static void onInitDestination(j_compress_ptr compressor);
+    static boolean onEmptyOutputBuffer(j_compress_ptr compressor);
+    static void onTermDestination(j_compress_ptr compressor);
+
+   private:
+    struct jpeg_compress_struct m_compressor{};
+    struct jpeg_error_mgr m_errorManager{};
+    struct jpeg_destination_mgr m_destination{};
+    jmp_buf m_jump{};
+    bool m_valid{false};
+    uint32_t m_width{0};
+    uint32_t m_height{0};
+    uint32_t m_paddedWidth{0};
+    uint32_t m_quality{0};
+    uint32_t m_lastQuality{0}; // Quality of the last encoded frame.
+    uint32_t m_nextQuality{0}; // Lower quality for the next frame (0: none).
+    std::vector<uint8_t> m_padded{}; // Rows of one MCU padded to a multiple of 16 pixels.
+    std::vector<char> m_buffer{};
+};
+
+#endif
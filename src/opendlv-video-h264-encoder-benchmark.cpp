@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cluon-complete.hpp"
+#include "benchmark.hpp"
+
+#include <cstdint>
+#include <iostream>
+
+int32_t main(int32_t argc, char **argv) {
+    int32_t retCode{1};
+    auto commandlineArguments = cluon::getCommandlineArguments(argc, argv);
+    const std::string SUITE{commandlineArguments["suite"]};
+    if ("rd" == SUITE) {
+        retCode = runRateDistortionSuite(argv[0], commandlineArguments);
+    }
+    else if ("scaling" == SUITE) {
+        retCode = runScalingSuite(argv[0], commandlineArguments);
+    }
+    else if ("replay" == SUITE) {
+        retCode = runReplaySuite(argv[0], commandlineArguments);
+    }
+    else if ("tune" == SUITE) {
+        retCode = runTuneSuite(argv[0], commandlineArguments);
+    }
+    else if ("loopback" == SUITE) {
+        retCode = runLoopbackSuite(argv[0], commandlineArguments);
+    }
+    else if ("startup" == SUITE) {
+        retCode = runStartupSuite(argv[0], commandlineArguments);
+    }
+    else if ("switch" == SUITE) {
+        retCode = runSwitchSuite(argv[0], commandlineArguments);
+    }
+    else if ("denoise" == SUITE) {
+        retCode = runDenoiseSuite(argv[0], commandlineArguments);
+    }
+    else if ("parallel" == SUITE) {
+        retCode = runParallelSuite(argv[0], commandlineArguments);
+    }
+    else if ("budget" == SUITE) {
+        retCode = runBudgetSuite(argv[0], commandlineArguments);
+    }
+    else {
+        std::cerr << argv[0] << " benchmarks the h264 encoder used by opendlv-video-h264-encoder." << std::endl;
+        std::cerr << "Usage:   " << argv[0] << " --suite=<suite> [suite-specific options]" << std::endl;
+        std::cerr << "         --suite=rd:      rate-distortion-speed regression suite on reference clips" << std::endl;
+        std::cerr << "             [--clips=<file.yuv@WxH>[,<file.yuv@WxH>...]]: raw I420 reference clips (default: synthetic clips)" << std::endl;
+        std::cerr << "             [--synthetic=<WxH>[,<WxH>...]]: sizes of synthetic clips when no clips are given (default: 640x480,1280x720)" << std::endl;
+        std::cerr << "             [--frames=<frames>]: maximum number of frames per clip (default: 60)" << std::endl;
+        std::cerr << "             [--fps=<fps>]: frame rate of the clips to compute the bitrate (default: 30)" << std::endl;
+        std::cerr << "             [--presets=<file>]: one preset per line as '<name>: <encoder arguments>' (default: built-in presets)" << std::endl;
+        std::cerr << "             [--save=<file.csv>]: store the results as new baseline" << std::endl;
+        std::cerr << "             [--baseline=<file.csv>]: compare the results against a stored baseline" << std::endl;
+        std::cerr << "             [--max-bitrate-increase=<percent>]: regression threshold for bitrate (default: 5)" << std::endl;
+        std::cerr << "             [--max-psnr-drop=<dB>]: regression threshold for PSNR (default: 0.25)" << std::endl;
+        std::cerr << "             [--max-ssim-drop=<value>]: regression threshold for SSIM (default: 0.005)" << std::endl;
+        std::cerr << "             [--max-fps-drop=<percent>]: regression threshold for encoding speed (default: 15)" << std::endl;
+        std::cerr << "         --suite=scaling: multi-stream scalability with synthetic shared memory producers" << std::endl;
+        std::cerr << "             [--width=<width>] [--height=<height>] [--fps=<fps>]: geometry and frame rate per stream (default: 1920x1080@30)" << std::endl;
+        std::cerr << "             [--streams=<N>[,<N>...]]: numbers of concurrent streams to test (default: 1,2,4,8)" << std::endl;
+        std::cerr << "             [--threads=<T>[,<T>...]]: openh264 threads per encoder to test (default: 1)" << std::endl;
+        std::cerr << "             [--pinning=<0|1>[,<0|1>...]]: pin each encoder to its own cores (default: 0,1)" << std::endl;
+        std::cerr << "             [--duration=<seconds>]: duration per configuration (default: 10)" << std::endl;
+        std::cerr << "             [--max-miss-rate=<percent>]: deadline miss rate that counts as sustained (default: 1)" << std::endl;
+        std::cerr << "             [--encoder-args=<arguments>]: further encoder arguments, e.g. \"--ecomplexity=1\"" << std::endl;
+        std::cerr << "         --suite=replay:  replay the I420 ImageReadings of a recording through the encoder" << std::endl;
+        std::cerr << "             --rec=<file.rec>: recording with ImageReadings in fourcc i420" << std::endl;
+        std::cerr << "             [--realtime]: replay at recorded speed (default: maximum speed)" << std::endl;
+        std::cerr << "             [--sender-stamp=<id>]: only replay ImageReadings with this senderStamp" << std::endl;
+        std::cerr << "             [--name=<name>]: additionally replay the frames into this shared memory area" << std::endl;
+        std::cerr << "             [--csv=<file.csv>]: store per-frame encoding time, size, and content statistics" << std::endl;
+        std::cerr << "             [--top=<N>]: number of slowest frames to list (default: 10)" << std::endl;
+        std::cerr << "             [--encoder-args=<arguments>]: further encoder arguments, e.g. \"--ecomplexity=1\"" << std::endl;
+        std::cerr << "         --suite=tune:    search encoder parameters for Pareto-optimal speed/bitrate/quality trade-offs" << std::endl;
+        std::cerr << "             [--rec=<file.rec>[,<file.rec>...]]: recordings with ImageReadings in fourcc i420 (default: synthetic 640x480 clip)" << std::endl;
+        std::cerr << "             [--frames=<frames>]: maximum number of frames per clip (default: 120)" << std::endl;
+        std::cerr << "             [--fps=<fps>]: frame rate of the clips to compute the bitrate (default: 30)" << std::endl;
+        std::cerr << "             [--knobs=<name>:<v1>|<v2>...[,...]]: parameters and values to search (default: ecomplexity, num-ref-frame, adaptive-quant, background-detection, scene-change-detect, denoise, loop-filter, long-term-ref)" << std::endl;
+        std::cerr << "             [--budget=<N>]: evaluate N random configurations instead of the full grid" << std::endl;
+        std::cerr << "             [--seed=<seed>]: seed for the random search (default: 1)" << std::endl;
+        std::cerr << "             [--jobs=<N>]: configurations evaluated in parallel (default: number of cores)" << std::endl;
+        std::cerr << "             [--cid=<cid>] [--name=<name>]: used in the printed command lines" << std::endl;
+        std::cerr << "             [--encoder-args=<arguments>]: fixed encoder arguments, e.g. \"--bitrate=800000\"" << std::endl;
+        std::cerr << "         --suite=loopback: run the encoder against a synthetic producer and verify the decoded envelopes" << std::endl;
+        std::cerr << "             [--encoder=<path>]: encoder executable to test (default: opendlv-video-h264-encoder from PATH)" << std::endl;
+        std::cerr << "             [--cid=<cid>] [--id=<id>]: OD4Session and senderStamp to use (default: 253, 0)" << std::endl;
+        std::cerr << "             [--width=<width>] [--height=<height>] [--fps=<fps>]: geometry and frame rate (default: 640x480@20)" << std::endl;
+        std::cerr << "             [--frames=<frames>]: number of frames to verify (default: 100)" << std::endl;
+        std::cerr << "             [--loss=<percent>] [--reorder=<percent>] [--duplicate=<percent>]: transport impairments (default: 0)" << std::endl;
+        std::cerr << "             [--seed=<seed>]: seed for the impairments (default: 1)" << std::endl;
+        std::cerr << "             [--max-missing=<percent>]: frames that may not be published (default: 0)" << std::endl;
+        std::cerr << "             [--timeout=<seconds>]: time to wait for the first frame (default: 10)" << std::endl;
+        std::cerr << "             [--encoder-args=<arguments>]: encoder arguments (default: \"--gop=10 --frame-skip=0\")" << std::endl;
+        std::cerr << "         --suite=startup: time to the first published frame when starting the encoder before or after the producer" << std::endl;
+        std::cerr << "             [--encoder=<path>]: encoder executable to test (default: opendlv-video-h264-encoder from PATH)" << std::endl;
+        std::cerr << "             [--cid=<cid>]: OD4Session to use (default: 253)" << std::endl;
+        std::cerr << "             [--width=<width>] [--height=<height>] [--fps=<fps>]: geometry and frame rate (default: 1280x720@30)" << std::endl;
+        std::cerr << "             [--runs=<N>]: runs per scenario (default: 5)" << std::endl;
+        std::cerr << "             [--delay=<ms>]: delay between starting the first and the second process (default: 500)" << std::endl;
+        std::cerr << "             [--timeout=<seconds>]: time to wait for the first frame (default: 10)" << std::endl;
+        std::cerr << "             [--encoder-args=<arguments>]: further encoder arguments" << std::endl;
+        std::cerr << "         --suite=switch:  stall when switching between encoder profiles with and without pre-initialized encoders" << std::endl;
+        std::cerr << "             [--width=<width>] [--height=<height>]: geometry (default: 1280x720)" << std::endl;
+        std::cerr << "             [--frames=<frames>]: number of frames to encode per mode (default: 300)" << std::endl;
+        std::cerr << "             [--interval=<frames>]: frames between two switches (default: 30)" << std::endl;
+        std::cerr << "             [--profiles=<file>]: one profile per line as '<name>: <encoder arguments>' (default: teleop and recording)" << std::endl;
+        std::cerr << "             [--encoder-args=<arguments>]: further encoder arguments for all profiles" << std::endl;
+        std::cerr << "         --suite=denoise: bitrate saved by the temporal denoiser at constant QP against its CPU time" << std::endl;
+        std::cerr << "             [--rec=<file.rec>]: recording with ImageReadings in fourcc i420 (default: synthetic clip)" << std::endl;
+        std::cerr << "             [--width=<width>] [--height=<height>]: geometry of the synthetic clip (default: 1280x720)" << std::endl;
+        std::cerr << "             [--frames=<frames>]: maximum number of frames (default: 120)" << std::endl;
+        std::cerr << "             [--fps=<fps>]: frame rate of the clip to compute the bitrate (default: 30)" << std::endl;
+        std::cerr << "             [--noise=<sigma>]: standard deviation of the noise added to the luma plane (default: 8, 0 for recordings)" << std::endl;
+        std::cerr << "             [--qp=<qp>]: constant quantization parameter (default: 28)" << std::endl;
+        std::cerr << "             [--threshold=<threshold>]: threshold of the denoiser as for --temporal-denoise (default: 24)" << std::endl;
+        std::cerr << "             [--encoder-args=<arguments>]: further encoder arguments" << std::endl;
+        std::cerr << "         --suite=parallel: stall the GOP-parallel encoders until an IDR frame is dropped and verify the published GOPs" << std::endl;
+        std::cerr << "             [--width=<width>] [--height=<height>]: geometry (default: 640x480)" << std::endl;
+        std::cerr << "             [--gop=<GOP>] [--instances=<instances>]: GOP length and encoder instances (default: 10, 2)" << std::endl;
+        std::cerr << "             [--encoder-args=<arguments>]: further encoder arguments" << std::endl;
+        std::cerr << "         --suite=budget:  re-encode an IDR frame exceeding the frame budget and verify that the QP and frame sizes return to normal" << std::endl;
+        std::cerr << "             [--width=<width>] [--height=<height>]: geometry of the synthetic clip (default: 640x480)" << std::endl;
+        std::cerr << "             [--frames=<frames>]: number of frames (default: 60)" << std::endl;
+        std::cerr << "             [--gop=<GOP>]: GOP length; 0 for no periodic IDR frames (default: 0)" << std::endl;
+        std::cerr << "             [--budget=<bytes>]: frame budget (default: twice the largest P frame)" << std::endl;
+        std::cerr << "             [--encoder-args=<arguments>]: further encoder arguments" << std::endl;
+        std::cerr << "Example: " << argv[0] << " --suite=rd --synthetic=1280x720 --frames=120 --baseline=rd.csv" << std::endl;
+    }
+    return retCode;
+}
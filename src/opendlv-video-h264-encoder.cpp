@@ -17,35 +17,77 @@
 
 #include "cluon-complete.hpp"
 #include "opendlv-standard-message-set.hpp"
-
-#include <wels/codec_api.h>
+#include "batch-transcoder.hpp"
+#include "control-server.hpp"
+#include "encoder-daemon.hpp"
+#include "encoder-parameters.hpp"
+#include "encoding-stream.hpp"
+#include "failover-monitor.hpp"
+#include "feedback-dispatcher.hpp"
+#include "stream-discovery.hpp"
+#include "stream-encoder.hpp"
+#include "synchronized-group.hpp"
 
 #include <algorithm>
+#include <chrono>
 #include <cstdint>
 #include <cstring>
 #include <iostream>
+#include <thread>
 #include <vector>
 
 
 int32_t main(int32_t argc, char **argv) {
     int32_t retCode{1};
     auto commandlineArguments = cluon::getCommandlineArguments(argc, argv);
-    if ( (0 == commandlineArguments.count("cid")) ||
-         (0 == commandlineArguments.count("name")) ||
-         (0 == commandlineArguments.count("width")) ||
-         (0 == commandlineArguments.count("height")) ) {
+    const bool DAEMON{(commandlineArguments["control"].size() != 0) || (commandlineArguments["discover"].size() != 0)};
+    const bool BATCH{commandlineArguments["rec"].size() != 0};
+    const bool GROUP{!DAEMON && !BATCH && (commandlineArguments["group"].size() != 0)};
+    // Options of a stream that neither the offline transcoder nor the
+    // synchronized groups apply; they are rejected instead of being ignored.
+    std::string unsupported;
+    if (BATCH || GROUP) {
+        for (std::string key : {"mask", "mask-style", "mask-radius", "temporal-denoise", "failover", "standby", "roi", "roi-only", "variants", "gop-parallel", "profile", "profiles"}) {
+            if (0 != commandlineArguments.count(key)) {
+                unsupported = "--" + key;
+            }
+        }
+        if ("auto" == commandlineArguments["usage"]) {
+            unsupported = "--usage=auto";
+        }
+    }
+    // The streams of a daemon share their OD4Sessions, which deliver the
+    // heartbeats to one receiver only.
+    if (DAEMON) {
+        for (std::string key : {"failover", "standby"}) {
+            if (0 != commandlineArguments.count(key)) {
+                unsupported = "--" + key;
+            }
+        }
+    }
+    if ( (!BATCH && (0 == commandlineArguments.count("cid"))) ||
+         (BATCH && (0 == commandlineArguments["out"].size())) ||
+         (!DAEMON && !BATCH && !GROUP && (0 == commandlineArguments.count("name"))) ||
+         (GROUP && (2 > splitString(commandlineArguments["group"], ',').size())) ||
+         (!DAEMON && !BATCH && (0 == commandlineArguments.count("width"))) ||
+         (!DAEMON && !BATCH && (0 == commandlineArguments.count("height"))) ) {
         std::cerr << argv[0] << " attaches to an I420-formatted image residing in a shared memory area to convert it into a corresponding h264 frame for publishing to a running OD4 session." << std::endl;
         std::cerr << "Usage:   " << argv[0] << " --cid=<OpenDaVINCI session> --name=<name of shared memory area> --width=<width> --height=<height> [--gop=<GOP>] [--bitrate=<bitrate>] [--id=<identifier in case of multiple instances]"
-                "[--bitrate-max=<bitrate-max>] [--rc-mode=<rc-mode>] [--ecomplexity=<ecomplexity>] [--sps-pps=<sps-pps>] [--num-ref-frame=<num-ref-frame>] [--ssei=<ssei>] [--prefix-nal=<prefix-nal>] [--entropy-coding=<entropy-coding>] "
+                "[--bitrate-max=<bitrate-max>] [--fps=<fps>] [--level=<level>] [--h264-profile=<profile>] [--rc-mode=<rc-mode>] [--ecomplexity=<ecomplexity>] [--sps-pps=<sps-pps>] [--num-ref-frame=<num-ref-frame>] [--ssei=<ssei>] [--prefix-nal=<prefix-nal>] [--entropy-coding=<entropy-coding>] "
                 "[--frame-skip=<frame-skip>] [--qp-max=<qp-max>] [--qp-min=<qp-min>] [--long-term-ref=<long-term-ref>] [--loop-filter=<loop-filter>] [--denoise=<denoise>] [--background-detection=<background-detection>] "
-                "[--adaptive-quant=<adaptive-quant>] [--frame-cropping=<frame-cropping>] [--scene-change-detect=<scene-change-detect>] [--threads=<threads>] [--verbose]" << std::endl;
+                "[--adaptive-quant=<adaptive-quant>] [--frame-cropping=<frame-cropping>] [--scene-change-detect=<scene-change-detect>] [--threads=<threads>] [--usage=camera|screen|auto] [--frame-budget=<bytes> [--frame-budget-retries=<retries>]] [--backend=<backend>] [--x264-preset=<preset>] [--x264-profile=<profile>] [--jpeg-quality=<quality>] [--timeout=<timeout>] [--gop-parallel=<instances>] [--roi=<WxH+X+Y@id>[,...] [--roi-only]] [--variants=<profile>@<id>[:<cid>][,...]] [--temporal-denoise=<threshold>] [--mask=<masks> [--mask-style=blur|fill] [--mask-radius=<radius>]] [--failover|--standby] [--control=<socket>] [--discover=<pattern> [--discover-timeout=<seconds>]] [--pool=<idle encoders>] [--profiles=<file> [--profile=<name>]] [--verbose]" << std::endl;
+        std::cerr << "         " << argv[0] << " --cid=<OpenDaVINCI session> --group=<name>,<name>[,...] --width=<width> --height=<height> [--sync-tolerance=<milliseconds>] [--side-by-side] [encoder arguments]" << std::endl;
+        std::cerr << "         " << argv[0] << " --rec=<recording with I420 frames> --out=<recording to write> [--jobs=<encoders per stream>] [encoder arguments]" << std::endl;
         std::cerr << "         --cid:           CID of the OD4Session to send h264 frames" << std::endl;
         std::cerr << "         --id:            when using several instances, this identifier is used as senderStamp" << std::endl;
         std::cerr << "         --name:          name of the shared memory area to attach" << std::endl;
         std::cerr << "         --width:         width of the frame" << std::endl;
         std::cerr << "         --height:        height of the frame" << std::endl;
-        std::cerr << "         --bitrate:       optional: desired bitrate (default: 1,500,000, min: 100,000 max: 5,000,000)" << std::endl;
-        std::cerr << "         --bitrate-max:   optional: maximum bitrate (default: 5,000,000, min: 100,000 max: 5,000,000)" << std::endl;
+        std::cerr << "         --bitrate:       optional: desired bitrate (default: 1,500,000, min: 100,000, max: maximum bitrate of the level)" << std::endl;
+        std::cerr << "         --bitrate-max:   optional: maximum bitrate (default and max: maximum bitrate of the level, min: 100,000)" << std::endl;
+        std::cerr << "         --fps:           optional: expected frame rate for the rate control and the level (default: 20)" << std::endl;
+        std::cerr << "         --level:         optional: H.264 level limiting the bitrates and reference frames, e.g., 3.1, 4, or 1b (default: auto, i.e., the lowest level for the frame size, frame rate, and bitrate)" << std::endl;
+        std::cerr << "         --h264-profile:  optional: H.264 profile of openh264, baseline, main, or high (default: baseline, high with --entropy-coding=1)" << std::endl;
         std::cerr << "         --gop:           optional: length of group of pictures (default = 10)" << std::endl;
         std::cerr << "         --rc-mode:       optional: rate control mode (default: RC_QUALITY_MODE (0), min: 0, max: 4)" << std::endl;
         std::cerr << "         --ecomplexity:   optional: complexity mode (default: LOW_COMPLEXITY (0), min: 0, max: 2)" << std::endl;
@@ -57,7 +99,7 @@ int32_t main(int32_t argc, char **argv) {
         std::cerr << "         --frame-skip:    optional: toggle fram-skipping to keep the bitrate within limits (default: 1)" << std::endl;
         std::cerr << "         --qp-max:        optional: Quantization Parameter max (default: 42, min: 0 max: 51)" << std::endl;
         std::cerr << "         --qp-min:        optional: Quantization Parameter min (default: 12, min: 0 max: 51)" << std::endl;
-        std::cerr << "         --long-term-ref: optional: toggle long term reference control (default: 0)" << std::endl;
+        std::cerr << "         --long-term-ref: optional: toggle long term reference control to recover from losses reported by decoders without IDR frames (default: 0)" << std::endl;
         std::cerr << "         --loop-filter:   optional: deblocking loop filter (default: 0, 0: on, 1: off, 2: on except for slice boundaries)" << std::endl;
         std::cerr << "         --denoise:       optional: toggle denoise control (default: 0)" << std::endl;
         std::cerr << "         --background-detection: optional: toggle background detection control (default: 1)" << std::endl;
@@ -65,226 +107,298 @@ int32_t main(int32_t argc, char **argv) {
         std::cerr << "         --frame-cropping: optional: toggle frame cropping (default: 1)" << std::endl;
         std::cerr << "         --scene-change-detect: optional: toggle scene change detection control (default: 1)" << std::endl;
         std::cerr << "         --threads        :optional: number of threads (default: 1, O: auto, >1: number of theads, max 4)" << std::endl;
+        std::cerr << "         --usage:         optional: type of content; screen for simulator renders and user interfaces, auto to detect it from the first frames (default: camera)" << std::endl;
+        std::cerr << "         --frame-budget:  optional: maximum size of an encoded frame in bytes; larger frames are encoded again with a higher QP up to --frame-budget-retries times (default: 2) or skipped (default: 0, no limit)" << std::endl;
+        std::cerr << "         --backend:       optional: encoder library (default: openh264, x264 or mjpeg if built with x264 or libjpeg-turbo)" << std::endl;
+        std::cerr << "         --x264-preset:   optional: x264 speed preset used with tune=zerolatency (default: veryfast)" << std::endl;
+        std::cerr << "         --x264-profile:  optional: x264 profile (default: baseline)" << std::endl;
+        std::cerr << "         --jpeg-quality:  optional: JPEG quality for mjpeg (default: 80, min: 1, max: 100)" << std::endl;
+        std::cerr << "         --timeout:       optional: seconds to wait for the shared memory area to appear (default: 0, 0: no limit)" << std::endl;
+        std::cerr << "         --gop-parallel:  optional: number of encoders that encode consecutive GOPs in parallel at the cost of up to one GOP of latency (default: 1)" << std::endl;
+        std::cerr << "         --roi:           optional: regions of interest encoded from the same frame as separate streams, each with its own senderStamp (e.g., 640x480+1600+200@11,1920x540+960+1200@12)" << std::endl;
+        std::cerr << "         --roi-only:      optional: encode only the regions of interest but not the full frame" << std::endl;
+        std::cerr << "         --variants:      optional: encode the full frame once per listed profile from --profiles in parallel instead of with the stream's arguments, each published with its own senderStamp and optionally to another CID (e.g., recording@1,teleop@2:112)" << std::endl;
+        std::cerr << "         --temporal-denoise: optional: blend every frame with the previous one where they differ by at most this threshold to remove sensor noise before encoding (default: 0, 0: off, about three times the standard deviation of the noise, e.g., 24)" << std::endl;
+        std::cerr << "         --mask:          optional: areas to mask before encoding, as rectangles or polygons separated by commas (e.g., 400x300+1500+100,0:700/300:500/300:1080/0:1080)" << std::endl;
+        std::cerr << "         --mask-style:    optional: blur or fill the masked areas with black (default: blur)" << std::endl;
+        std::cerr << "         --mask-radius:   optional: radius of the box blur in pixels (default: 16, min: 1, max: 32)" << std::endl;
+        std::cerr << "         --failover:      optional: send a heartbeat for every frame so that an instance started with --standby can take over" << std::endl;
+        std::cerr << "         --standby:       optional: attach and prepare the encoder but publish only when the heartbeat of the active instance with the same --cid and --id is missing" << std::endl;
+        std::cerr << "         --control:       optional: run as daemon to add, modify, and remove streams with commands on this local socket" << std::endl;
+        std::cerr << "         --discover:      optional: run as daemon and encode all shared memory areas announced by ImageReadingShared whose name matches this pattern (e.g., video*.i420)" << std::endl;
+        std::cerr << "         --discover-timeout: optional: seconds without announcement to stop encoding a discovered area (default: 5)" << std::endl;
+        std::cerr << "         --pool:          optional: number of idle encoders kept for reuse in daemon mode (default: 4)" << std::endl;
+        std::cerr << "         --profiles:      optional: file with one '<name>: <encoder arguments>' per line; in daemon mode, an encoder is kept warm for every profile to switch with 'profile <stream> <name>'" << std::endl;
+        std::cerr << "         --profile:       optional: profile from --profiles to start with" << std::endl;
+        std::cerr << "         --group:         encode the frames of these shared memory areas (e.g., a stereo pair) paired by their sample timestamps; the i-th area is published with senderStamp --id + i" << std::endl;
+        std::cerr << "         --sync-tolerance: optional: maximum difference of the sample timestamps of paired frames in milliseconds (default: 10)" << std::endl;
+        std::cerr << "         --side-by-side:  optional: pack the paired frames side by side into one frame encoded as senderStamp --id" << std::endl;
+        std::cerr << "         --rec:           transcode the I420 ImageReadings of this recording offline instead of attaching to a shared memory area" << std::endl;
+        std::cerr << "         --out:           recording to write the transcoded ImageReadings and all other envelopes to" << std::endl;
+        std::cerr << "         --jobs:          optional: number of encoders per senderStamp that encode consecutive GOPs of a recording in parallel (default: number of cores)" << std::endl;
         std::cerr << "         --verbose: print encoding information" << std::endl;
         std::cerr << "Example: " << argv[0] << " --cid=111 --name=data --width=640 --height=480 --verbose" << std::endl;
+        std::cerr << "         " << argv[0] << " --cid=111 --control=/tmp/h264-encoder.sock" << std::endl;
+        std::cerr << "         " << argv[0] << " --cid=111 --discover=video*.i420" << std::endl;
+        std::cerr << "         " << argv[0] << " --cid=111 --group=left.i420,right.i420 --width=1280 --height=720 --side-by-side" << std::endl;
+        std::cerr << "         " << argv[0] << " --rec=drive-i420.rec --out=drive-h264.rec --bitrate=2000000" << std::endl;
+        std::cerr << "         echo \"add front --name=video0.i420 --width=640 --height=480 --id=1\" | nc -U /tmp/h264-encoder.sock" << std::endl;
     }
-    else {
-        const std::string NAME{commandlineArguments["name"]};
+    else if (!unsupported.empty()) {
+        std::cerr << argv[0] << ": " << unsupported << " is not supported with " << (DAEMON ? "--control or --discover" : (BATCH ? "--rec" : "--group")) << "." << std::endl;
+    }
+    else if (BATCH) {
+        const uint32_t JOBS{(commandlineArguments["jobs"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["jobs"])) : std::max(std::thread::hardware_concurrency(), 1u)};
+        std::map<std::string, std::string> arguments{commandlineArguments};
+        for (auto key : {"rec", "out", "jobs", "verbose"}) {
+            arguments.erase(key);
+        }
+        retCode = transcodeRecording(commandlineArguments["rec"], commandlineArguments["out"], arguments, JOBS) ? 0 : 1;
+    }
+    else if (GROUP) {
+        const std::vector<std::string> NAMES{splitString(commandlineArguments["group"], ',')};
         const uint32_t WIDTH{static_cast<uint32_t>(std::stoi(commandlineArguments["width"]))};
         const uint32_t HEIGHT{static_cast<uint32_t>(std::stoi(commandlineArguments["height"]))};
-        const uint32_t GOP_DEFAULT{10};
-        const uint32_t GOP{(commandlineArguments["gop"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["gop"])) : GOP_DEFAULT};
-        const uint32_t BITRATE_MIN{100000};
-        const uint32_t BITRATE_DEFAULT{1500000};
-        const uint32_t BITRATE_MAX{5000000};
-        const uint32_t BITRATE{(commandlineArguments["bitrate"].size() != 0) ? std::min(std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["bitrate"])), BITRATE_MIN), BITRATE_MAX) : BITRATE_DEFAULT};
         const bool VERBOSE{commandlineArguments.count("verbose") != 0};
         const uint32_t ID{(commandlineArguments["id"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["id"])) : 0};
+        const uint32_t TIMEOUT{(commandlineArguments["timeout"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["timeout"])) : 0};
+        const int64_t TOLERANCE{(commandlineArguments["sync-tolerance"].size() != 0) ? static_cast<int64_t>(std::stod(commandlineArguments["sync-tolerance"]) * 1000.0) : 10000};
+        const bool SIDE_BY_SIDE{commandlineArguments.count("side-by-side") != 0};
 
-        //Thesis constants
-        const uint32_t ZERO{0};
-        const uint32_t ONE{1};
-        const uint32_t TWO{2};
-        const uint32_t THREE{3};
-        const uint32_t FOUR{4};
-        const uint32_t RC_MODE{(commandlineArguments["rc-mode"].size() != 0) ? std::min(std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["rc-mode"])), ZERO), FOUR): 0}; // RC_MODES::RC_QUALITY_MODE
-        const uint32_t ECOMPLEXITY{(commandlineArguments["ecomplexity"].size() != 0) ? std::min(std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["ecomplexity"])), ZERO), TWO): 0}; // ECOMPLEXITY_MODE::LOW_COMPLEXITY
-        const uint32_t I_NUM_REF_FRAME{(commandlineArguments["num-ref-frame"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["num-ref-frame"])) : 1};
-        const uint32_t SPS_PPS_STRATEGY{(commandlineArguments["sps-pps"].size() != 0) ? std::min(std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["sps-pps"])), ZERO), THREE): 0}; //EParameterSetStrategy::CONSTANT_ID
-        const uint32_t B_PREFIX_NAL{(commandlineArguments["prefix-nal"].size() != 0) ? std::min(std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["prefix-nal"])), ZERO), ONE): 0};
-        const uint32_t B_SSEI{(commandlineArguments["ssei"].size() != 0) ? std::min(std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["ssei"])), ZERO), ONE): 0};
-        const uint32_t I_PADDING{(commandlineArguments["padding"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["padding"])) : 0};
-        const uint32_t I_ENTROPY_CODING{(commandlineArguments["entropy-coding"].size() != 0) ? std::min(std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["entropy-coding"])), ZERO), ONE): 0};
-        const uint32_t B_FRAME_SKIP{(commandlineArguments["frame-skip"].size() != 0) ? std::min(std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["frame-skip"])), ZERO), ONE): 1};
-        const uint32_t I_BITRATE_MAX{(commandlineArguments["bitrate-max"].size() != 0) ? std::min(std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["bitrate-max"])), BITRATE_MIN), BITRATE_MAX) : BITRATE_MAX};
-        const uint32_t QP_MIN{0};
-        const uint32_t QP_MAX{51};
-        const uint32_t I_MAX_QP{(commandlineArguments["qp-max"].size() != 0) ? std::min(std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["qp-max"])), QP_MIN), QP_MAX): 42};
-        const uint32_t I_MIN_QP{(commandlineArguments["qp-max"].size() != 0) ? std::min(std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["qp-max"])), QP_MIN), QP_MAX): 12};
-        const uint32_t B_LONG_TERM_REFERENCE{(commandlineArguments["long-term-ref"].size() != 0) ? std::min(std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["long-term-ref"])), ZERO), ONE): 0};
-        const uint32_t I_LOOP_FILTER{(commandlineArguments["loop-filter"].size() != 0) ? std::min(std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["loop-filter"])), ZERO), TWO): 0};
-        const uint32_t B_DENOISE{(commandlineArguments["denoise"].size() != 0) ? std::min(std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["denoise"])), ZERO), ONE): 0};
-        const uint32_t B_BACKGROUND_DETECTION{(commandlineArguments["background-detection"].size() != 0) ? std::min(std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["background-detection"])), ZERO), ONE): 1};
-        const uint32_t B_ADAPTIVE_QUANT{(commandlineArguments["adaptive-quant"].size() != 0) ? std::min(std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["adaptive-quant"])), ZERO), ONE): 1};
-        const uint32_t B_FRAME_CROPPING{(commandlineArguments["frame-cropping"].size() != 0) ? std::min(std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["frame-cropping"])), ZERO), ONE): 1};
-        const uint32_t B_SCENE_CHANGE_DETECT{(commandlineArguments["scene-change-detect"].size() != 0) ? std::min(std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["scene-change-detect"])), ZERO), ONE): 1};
-        const uint32_t I_MULTIPLE_THREADS{(commandlineArguments["threads"].size() != 0) ? std::min(std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["threads"])), ZERO), FOUR): 1};
-
-        std::unique_ptr<cluon::SharedMemory> sharedMemory(new cluon::SharedMemory{NAME});
-        if (sharedMemory && sharedMemory->valid()) {
-            std::clog << argv[0] << ": Attached to '" << sharedMemory->name() << "' (" << sharedMemory->size() << " bytes)." << std::endl;
-
-            ISVCEncoder *encoder{nullptr};
-            if (0 != WelsCreateSVCEncoder(&encoder) || (nullptr == encoder)) {
-                std::cerr << argv[0] << ": Failed to create openh264 encoder." << std::endl;
+        // One encoder per area or one for all areas packed side by side.
+        std::vector<std::unique_ptr<StreamEncoder>> streamEncoders;
+        for (size_t i{0}; i < (SIDE_BY_SIDE ? 1 : NAMES.size()); i++) {
+            const uint32_t ENCODED_WIDTH{SIDE_BY_SIDE ? static_cast<uint32_t>(NAMES.size()) * WIDTH : WIDTH};
+            std::unique_ptr<StreamEncoder> streamEncoder{new StreamEncoder(ENCODED_WIDTH, HEIGHT, commandlineArguments, VERBOSE)};
+            if (!streamEncoder->valid()) {
+                std::cerr << argv[0] << ": Failed to set up " << streamEncoder->backend() << " encoder for " << ENCODED_WIDTH << "x" << HEIGHT << "." << std::endl;
                 return retCode;
             }
+            streamEncoder->warmUp();
+            streamEncoders.push_back(std::move(streamEncoder));
+        }
+        std::clog << argv[0] << ": Encoding " << NAMES.size() << " areas with " << streamEncoders[0]->backend() << ", bitrate = " << streamEncoders[0]->targetBitrate()
+                  << ", pairing frames within " << TOLERANCE << " microseconds" << std::endl;
+        if (!streamEncoders[0]->configuration().empty()) {
+            std::clog << argv[0] << ": Effective configuration: " << streamEncoders[0]->configuration() << std::endl;
+        }
 
-            int logLevel{VERBOSE ? WELS_LOG_INFO : WELS_LOG_QUIET};
-            encoder->SetOption(ENCODER_OPTION_TRACE_LEVEL, &logLevel);
-
-            // Configure parameters for openh264 encoder.
-            SEncParamExt parameters;
-            {
-                memset(&parameters, 0, sizeof(SEncParamBase));
-                encoder->GetDefaultParams(&parameters);
-
-                parameters.fMaxFrameRate = 20 /*FPS*/; // This parameter is implicitly given by the notifications from the shared memory.
-                parameters.iUsageType = EUsageType::CAMERA_VIDEO_REAL_TIME;
-                parameters.iPicWidth = WIDTH;
-                parameters.iPicHeight = HEIGHT;
-                parameters.uiIntraPeriod = GOP;
-                parameters.iTargetBitrate = BITRATE;
-                parameters.iSpatialLayerNum = 1;
-                parameters.iTemporalLayerNum = 1;
-                parameters.iLtrMarkPeriod = 30;
-                parameters.iMultipleThreadIdc = I_MULTIPLE_THREADS; // 1 = disable multi threads.
+        std::shared_ptr<cluon::OD4Session> od4{std::make_shared<cluon::OD4Session>(static_cast<uint16_t>(std::stoi(commandlineArguments["cid"])))};
+        SynchronizedGroup group{NAMES, WIDTH, HEIGHT, ID, std::move(streamEncoders), TOLERANCE, od4, VERBOSE};
+        if (group.run(TIMEOUT)) {
+            std::clog << argv[0] << ": Encoded " << group.groups() << " groups, dropped " << group.droppedFrames() << " unpaired frames." << std::endl;
+            retCode = 0;
+        }
+        else {
+            std::cerr << argv[0] << ": Failed to attach to shared memory '" << commandlineArguments["group"] << "'." << std::endl;
+        }
+    }
+    else if (DAEMON) {
+        const bool VERBOSE{commandlineArguments.count("verbose") != 0};
+        const uint32_t POOL{(commandlineArguments["pool"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["pool"])) : 4};
 
-                parameters.sSpatialLayers[0].iVideoWidth = parameters.iPicWidth;
-                parameters.sSpatialLayers[0].iVideoHeight = parameters.iPicHeight;
-                parameters.sSpatialLayers[0].fFrameRate = parameters.fMaxFrameRate;
-                parameters.sSpatialLayers[0].iSpatialBitrate = parameters.iTargetBitrate;
-                parameters.sSpatialLayers[0].iMaxSpatialBitrate = I_BITRATE_MAX;
-                parameters.sSpatialLayers[0].sSliceArgument.uiSliceMode = SliceModeEnum::SM_SIZELIMITED_SLICE;
-                parameters.sSpatialLayers[0].sSliceArgument.uiSliceNum = 1;
+        const uint32_t DISCOVER_TIMEOUT{(commandlineArguments["discover-timeout"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["discover-timeout"])) : 5};
 
-                /*
-                 * Thesis parameters
-                 * https://github.com/cisco/openh264/wiki/TypesAndStructures
-                 * https://github.com/cisco/openh264/blob/master/codec/encoder/core/inc/param_svc.h#L132
-                 */
-                if (I_NUM_REF_FRAME == 0) {
-                    parameters.iNumRefFrame = AUTO_REF_PIC_COUNT;
-                }
-                else {
-                    parameters.iNumRefFrame = I_NUM_REF_FRAME;
-                }
-                parameters.bPrefixNalAddingCtrl = B_PREFIX_NAL;
-                parameters.bEnableSSEI = B_SSEI;
-                parameters.iPaddingFlag = I_PADDING;
-                parameters.iEntropyCodingModeFlag = I_ENTROPY_CODING;
-                parameters.bEnableFrameSkip = B_FRAME_SKIP;
-                parameters.iMaxBitrate = I_BITRATE_MAX;
-                parameters.iMaxQp = I_MAX_QP;
-                parameters.iMinQp = I_MIN_QP;
-                parameters.bEnableLongTermReference = B_LONG_TERM_REFERENCE;
-                parameters.iLoopFilterDisableIdc = I_LOOP_FILTER;
-                parameters.bEnableDenoise = B_DENOISE;
-                parameters.bEnableBackgroundDetection = B_BACKGROUND_DETECTION;
-                parameters.bEnableAdaptiveQuant = B_ADAPTIVE_QUANT;
-                parameters.bEnableFrameCroppingFlag = B_FRAME_CROPPING;
-                parameters.bEnableSceneChangeDetect = B_SCENE_CHANGE_DETECT;
+        // The arguments of the daemon are the defaults for all streams.
+        std::map<std::string, std::string> defaults{commandlineArguments};
+        for (auto key : {"control", "discover", "discover-timeout", "pool", "verbose"}) {
+            defaults.erase(key);
+        }
+        EncoderDaemon daemon{defaults, POOL, VERBOSE};
+        if (commandlineArguments.count("name") != 0) {
+            std::clog << argv[0] << ": " << daemon.handle("add 0") << std::endl;
+        }
 
-                switch (RC_MODE) {
-                    case 0: { parameters.iRCMode = RC_MODES::RC_QUALITY_MODE; break; }
-                    case 1: { parameters.iRCMode = RC_MODES::RC_BITRATE_MODE; break; }
-                    case 2: { parameters.iRCMode = RC_MODES::RC_BUFFERBASED_MODE; break; }
-                    case 3: { parameters.iRCMode = RC_MODES::RC_TIMESTAMP_MODE; break; }
-                    case 4: { parameters.iRCMode = RC_MODES::RC_OFF_MODE; break; }
-                }
+        std::unique_ptr<ControlServer> control;
+        if (commandlineArguments["control"].size() != 0) {
+            control.reset(new ControlServer(commandlineArguments["control"], [&daemon](const std::string &command) { return daemon.handle(command); }));
+            if (!control->isRunning()) {
+                return retCode;
+            }
+            std::clog << argv[0] << ": Waiting for commands on '" << commandlineArguments["control"] << "'." << std::endl;
+        }
 
-                switch (SPS_PPS_STRATEGY) {
-                    case 0: { parameters.eSpsPpsIdStrategy = EParameterSetStrategy::CONSTANT_ID; break; }
-                    case 1: { parameters.eSpsPpsIdStrategy = EParameterSetStrategy::INCREASING_ID; break; }
-                    case 2: { parameters.eSpsPpsIdStrategy = EParameterSetStrategy::SPS_LISTING; break; }
-                    case 3: { parameters.eSpsPpsIdStrategy = EParameterSetStrategy::SPS_LISTING_AND_PPS_INCREASING; break; }
-                }
+        std::unique_ptr<StreamDiscovery> discovery;
+        std::unique_ptr<cluon::OD4Session> announcements;
+        if (commandlineArguments["discover"].size() != 0) {
+            discovery.reset(new StreamDiscovery(daemon, commandlineArguments["discover"], DISCOVER_TIMEOUT));
+            announcements.reset(new cluon::OD4Session(static_cast<uint16_t>(std::stoi(commandlineArguments["cid"]))));
+            StreamDiscovery *d{discovery.get()};
+            announcements->dataTrigger(opendlv::proxy::ImageReadingShared::ID(), [d](cluon::data::Envelope &&envelope) {
+                const uint32_t SENDER_STAMP{envelope.senderStamp()};
+                opendlv::proxy::ImageReadingShared irs = cluon::extractMessage<opendlv::proxy::ImageReadingShared>(std::move(envelope));
+                d->announce(irs.name(), irs.size(), irs.width(), irs.height(), SENDER_STAMP);
+            });
+            std::clog << argv[0] << ": Discovering shared memory areas matching '" << commandlineArguments["discover"] << "'." << std::endl;
+        }
 
-                switch (ECOMPLEXITY) {
-                    case 0: { parameters.iComplexityMode = ECOMPLEXITY_MODE::LOW_COMPLEXITY;; break; }
-                    case 1: { parameters.iComplexityMode = ECOMPLEXITY_MODE::MEDIUM_COMPLEXITY; break; }
-                    case 2: { parameters.iComplexityMode = ECOMPLEXITY_MODE::HIGH_COMPLEXITY; break; }
-                }
+        while (!cluon::TerminateHandler::instance().isTerminated.load()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(250));
+            if (discovery) {
+                discovery->expire();
             }
-            if (cmResultSuccess != encoder->InitializeExt(&parameters)) {
-                std::cerr << argv[0] << ": Failed to set parameters for openh264." << std::endl;
+        }
+        // Stop receiving announcements before the streams are removed.
+        announcements.reset();
+        retCode = 0;
+    }
+    else {
+        const std::string NAME{commandlineArguments["name"]};
+        const uint32_t WIDTH{static_cast<uint32_t>(std::stoi(commandlineArguments["width"]))};
+        const uint32_t HEIGHT{static_cast<uint32_t>(std::stoi(commandlineArguments["height"]))};
+        const bool VERBOSE{commandlineArguments.count("verbose") != 0};
+        const uint32_t ID{(commandlineArguments["id"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["id"])) : 0};
+        const uint32_t TIMEOUT{(commandlineArguments["timeout"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["timeout"])) : 0};
+
+        std::map<std::string, std::map<std::string, std::string>> profiles;
+        for (auto &profile : loadNamedArguments(commandlineArguments["profiles"])) {
+            profiles[profile.first] = getCommandlineArgumentsFromString(profile.second);
+        }
+        if (commandlineArguments["profile"].size() != 0) {
+            if (0 == profiles.count(commandlineArguments["profile"])) {
+                std::cerr << argv[0] << ": Profile '" << commandlineArguments["profile"] << "' not found in '" << commandlineArguments["profiles"] << "'." << std::endl;
                 return retCode;
             }
-            else {
-                std::clog << argv[0] << ": Encoding bitrate = " << BITRATE << std::endl;
+            for (auto &argument : profiles[commandlineArguments["profile"]]) {
+                commandlineArguments[argument.first] = argument.second;
             }
+        }
+        std::vector<EncodingVariant> variants;
+        if ((commandlineArguments["variants"].size() != 0) && !parseEncodingVariants(commandlineArguments["variants"], variants)) {
+            std::cerr << argv[0] << ": Invalid variants '" << commandlineArguments["variants"] << "'." << std::endl;
+            return retCode;
+        }
+        for (auto &variant : variants) {
+            if (0 == profiles.count(variant.profile)) {
+                std::cerr << argv[0] << ": Profile '" << variant.profile << "' not found in '" << commandlineArguments["profiles"] << "'." << std::endl;
+                return retCode;
+            }
+        }
 
-            // Allocate image buffer to hold h264 frame as output.
-            std::vector<char> h264Buffer;
-            h264Buffer.resize(WIDTH * HEIGHT, '0'); // In practice, this is small than WIDTH * HEIGHT
-
-            cluon::data::TimeStamp before, after, sampleTimeStamp;
-
-            // Interface to a running OpenDaVINCI session (ignoring any incoming Envelopes).
-            cluon::OD4Session od4{static_cast<uint16_t>(std::stoi(commandlineArguments["cid"]))};
-
-            while ( (sharedMemory && sharedMemory->valid()) && od4.isRunning() ) {
-                // Wait for incoming frame.
-                sharedMemory->wait();
-
-                sampleTimeStamp = cluon::time::now();
-
-                int totalSize{0};
-                sharedMemory->lock();
-                {
-                    // Read notification timestamp.
-                    auto r = sharedMemory->getTimeStamp();
-                    sampleTimeStamp = (r.first ? r.second : sampleTimeStamp);
-                }
-                {
-                    SFrameBSInfo frameInfo;
-                    memset(&frameInfo, 0, sizeof(SFrameBSInfo));
-
-                    SSourcePicture sourceFrame;
-                    memset(&sourceFrame, 0, sizeof(SSourcePicture));
+        const uint32_t GOP_PARALLEL{(commandlineArguments["gop-parallel"].size() != 0) ? std::max(static_cast<uint32_t>(std::stoi(commandlineArguments["gop-parallel"])), 1u) : 1};
+        const uint32_t GOP{(commandlineArguments["gop"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["gop"])) : 10};
 
-                    sourceFrame.iColorFormat = EVideoFormatType::videoFormatI420;
-                    sourceFrame.iPicWidth = WIDTH;
-                    sourceFrame.iPicHeight = HEIGHT;
-                    sourceFrame.iStride[0] = WIDTH;
-                    sourceFrame.iStride[1] = WIDTH/2;
-                    sourceFrame.iStride[2] = WIDTH/2;
-                    sourceFrame.pData[0] = reinterpret_cast<uint8_t*>(sharedMemory->data());
-                    sourceFrame.pData[1] = reinterpret_cast<uint8_t*>(sharedMemory->data() + (WIDTH * HEIGHT));
-                    sourceFrame.pData[2] = reinterpret_cast<uint8_t*>(sharedMemory->data() + (WIDTH * HEIGHT + ((WIDTH * HEIGHT) >> 2)));
+        std::vector<RegionOfInterest> regions;
+        if ((commandlineArguments["roi"].size() != 0) && !parseRegionsOfInterest(commandlineArguments["roi"], WIDTH, HEIGHT, regions)) {
+            std::cerr << argv[0] << ": Invalid regions of interest '" << commandlineArguments["roi"] << "' for " << WIDTH << "x" << HEIGHT << "." << std::endl;
+            return retCode;
+        }
+        std::vector<MaskPolygon> masks;
+        if ((commandlineArguments["mask"].size() != 0) && !parseMaskPolygons(commandlineArguments["mask"], WIDTH, HEIGHT, masks)) {
+            std::cerr << argv[0] << ": Invalid privacy masks '" << commandlineArguments["mask"] << "' for " << WIDTH << "x" << HEIGHT << "." << std::endl;
+            return retCode;
+        }
+        uint32_t temporalDenoise{0};
+        try {
+            temporalDenoise = (commandlineArguments["temporal-denoise"].size() != 0) ? static_cast<uint32_t>(std::max(std::stoi(commandlineArguments["temporal-denoise"]), 0)) : 0;
+        }
+        catch (...) {
+            std::cerr << argv[0] << ": Invalid threshold for the temporal denoiser '" << commandlineArguments["temporal-denoise"] << "'." << std::endl;
+            return retCode;
+        }
+        int32_t maskRadius{16};
+        try {
+            maskRadius = (commandlineArguments["mask-radius"].size() != 0) ? std::stoi(commandlineArguments["mask-radius"]) : maskRadius;
+        }
+        catch (...) {
+            maskRadius = 0;
+        }
+        if ((1 > maskRadius) || (32 < maskRadius)) {
+            std::cerr << argv[0] << ": Invalid radius of the privacy masks '" << commandlineArguments["mask-radius"] << "', it must be between 1 and 32." << std::endl;
+            return retCode;
+        }
+        // The variants replace the full frame encoded with the stream's arguments.
+        const bool ROI_ONLY{((commandlineArguments.count("roi-only") != 0) && !regions.empty()) || !variants.empty()};
 
-                    if (VERBOSE) {
-                        before = cluon::time::now();
-                    }
-                    auto result = encoder->EncodeFrame(&sourceFrame, &frameInfo);
-                    if (VERBOSE) {
-                        after = cluon::time::now();
-                    }
-                    if (cmResultSuccess == result) {
-                        if (videoFrameTypeSkip == frameInfo.eFrameType) {
-                            std::cerr << argv[0] << ": Warning, skipping frame." << std::endl;
-                        }
-                        else {
-                            for(int layer{0}; layer < frameInfo.iLayerNum; layer++) {
-                                int sizeOfLayer{0};
-                                for(int nal{0}; nal < frameInfo.sLayerInfo[layer].iNalCount; nal++) {
-                                    sizeOfLayer += frameInfo.sLayerInfo[layer].pNalLengthInByte[nal];
-                                }
-                                memcpy(&h264Buffer[totalSize], frameInfo.sLayerInfo[layer].pBsBuf, sizeOfLayer);
-                                totalSize += sizeOfLayer;
-                            }
-                        }
-                    }
-                    else {
-                        std::cerr << argv[0] << ": Failed to encode frame: " << result << std::endl;
-                    }
-                }
-                sharedMemory->unlock();
+        // Create and configure the encoder before attaching to the shared memory area
+        // so that the producer does not need to be running yet.
+        std::vector<std::unique_ptr<StreamEncoder>> streamEncoders;
+        for (uint32_t i{0}; !ROI_ONLY && (i < GOP_PARALLEL); i++) {
+            std::unique_ptr<StreamEncoder> streamEncoder{new StreamEncoder(WIDTH, HEIGHT, commandlineArguments, VERBOSE)};
+            if (!streamEncoder->valid()) {
+                std::cerr << argv[0] << ": Failed to set up " << streamEncoder->backend() << " encoder." << std::endl;
+                return retCode;
+            }
+            streamEncoder->warmUp();
+            streamEncoders.push_back(std::move(streamEncoder));
+        }
+        if (!ROI_ONLY) {
+            std::clog << argv[0] << ": Encoding with " << streamEncoders[0]->backend() << ", bitrate = " << streamEncoders[0]->targetBitrate() << std::endl;
+            if (!streamEncoders[0]->configuration().empty()) {
+                std::clog << argv[0] << ": Effective configuration: " << streamEncoders[0]->configuration() << std::endl;
+            }
+        }
 
-                if (0 < totalSize) {
-                    opendlv::proxy::ImageReading ir;
-                    ir.fourcc("h264").width(WIDTH).height(HEIGHT).data(std::string(&h264Buffer[0], totalSize));
-                    od4.send(ir, sampleTimeStamp, ID);
+        // Interface to a running OpenDaVINCI session (only receiving the heartbeats for --failover and --standby and the feedback of the decoders).
+        std::shared_ptr<cluon::OD4Session> od4{std::make_shared<cluon::OD4Session>(static_cast<uint16_t>(std::stoi(commandlineArguments["cid"])))};
+        std::map<uint16_t, std::shared_ptr<cluon::OD4Session>> sessions{{static_cast<uint16_t>(std::stoi(commandlineArguments["cid"])), od4}};
 
-                    if (VERBOSE) {
-                        std::clog << argv[0] << ": Frame size = " << totalSize << " bytes; sample time = " << cluon::time::toMicroseconds(sampleTimeStamp) << " microseconds; encoding took " << cluon::time::deltaInMicroseconds(after, before) << " microseconds." << std::endl;
-                    }
+        // Wait for the producer if it is not running yet.
+        std::unique_ptr<EncodingStream> stream;
+        if (ROI_ONLY) {
+            stream.reset(new EncodingStream(NAME, WIDTH, HEIGHT, od4, VERBOSE));
+        }
+        else if (1 < GOP_PARALLEL) {
+            stream.reset(new EncodingStream(NAME, ID, std::move(streamEncoders), GOP, od4, VERBOSE));
+        }
+        else {
+            stream.reset(new EncodingStream(NAME, ID, std::move(streamEncoders[0]), od4, VERBOSE));
+        }
+        for (auto &variant : variants) {
+            std::map<std::string, std::string> arguments{commandlineArguments};
+            for (auto &argument : profiles[variant.profile]) {
+                arguments[argument.first] = argument.second;
+            }
+            std::unique_ptr<StreamEncoder> variantEncoder{new StreamEncoder(WIDTH, HEIGHT, arguments, VERBOSE)};
+            if (variantEncoder->valid()) {
+                variantEncoder->warmUp();
+            }
+            RegionOfInterest frame;
+            frame.width = WIDTH;
+            frame.height = HEIGHT;
+            frame.senderStamp = variant.senderStamp;
+            std::shared_ptr<cluon::OD4Session> sink{od4};
+            if (0 != variant.cid) {
+                std::shared_ptr<cluon::OD4Session> &session{sessions[variant.cid]};
+                if (!session) {
+                    session = std::make_shared<cluon::OD4Session>(variant.cid);
                 }
+                sink = session;
             }
-            if (nullptr != encoder) {
-                encoder->Uninitialize();
-                WelsDestroySVCEncoder(encoder);
+            if (!stream->addRegion(frame, std::move(variantEncoder), sink)) {
+                std::cerr << argv[0] << ": Failed to set up encoder for variant '" << variant.profile << "'." << std::endl;
+                return retCode;
+            }
+        }
+        for (auto &region : regions) {
+            std::unique_ptr<StreamEncoder> regionEncoder{new StreamEncoder(region.width, region.height, commandlineArguments, VERBOSE)};
+            if (regionEncoder->valid()) {
+                regionEncoder->warmUp();
             }
+            if (!stream->addRegion(region, std::move(regionEncoder))) {
+                std::cerr << argv[0] << ": Failed to set up encoder for region " << region.width << "x" << region.height << "+" << region.x << "+" << region.y << "." << std::endl;
+                return retCode;
+            }
+        }
+        if ((commandlineArguments.count("failover") != 0) || (commandlineArguments.count("standby") != 0)) {
+            stream->setFailover(std::make_shared<FailoverMonitor>(od4, ID, commandlineArguments.count("standby") != 0));
+        }
+        if (!masks.empty()) {
+            stream->setPrivacyMasks(masks, "fill" != commandlineArguments["mask-style"], static_cast<uint32_t>(maskRadius));
+        }
+        if (commandlineArguments["temporal-denoise"].size() != 0) {
+            stream->setTemporalDenoise(temporalDenoise);
+        }
+        if ("auto" == commandlineArguments["usage"]) {
+            stream->setContentDetection();
+        }
+        // Loss recovery requests and long-term reference marking feedback of the decoders.
+        std::vector<std::unique_ptr<FeedbackDispatcher>> dispatchers;
+        for (auto &session : sessions) {
+            dispatchers.emplace_back(new FeedbackDispatcher(session.second, VERBOSE));
+            dispatchers.back()->add(stream.get());
+        }
+        if (stream->run(TIMEOUT)) {
             retCode = 0;
         }
         else {
@@ -0,0 +1,243 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "encoder-parameters.hpp"
+#include "openh264-backend.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <iostream>
+
+OpenH264Backend::OpenH264Backend(uint32_t width, uint32_t height, std::map<std::string, std::string> &arguments, bool verbose) noexcept
+    : m_width{width}
+    , m_height{height} {
+    if ((0 != WelsCreateSVCEncoder(&m_encoder)) || (nullptr == m_encoder)) {
+        m_encoder = nullptr;
+        return;
+    }
+
+    int logLevel{verbose ? WELS_LOG_INFO : WELS_LOG_QUIET};
+    m_encoder->SetOption(ENCODER_OPTION_TRACE_LEVEL, &logLevel);
+
+    bool initialized{false};
+    try {
+        setEncoderParameters(m_encoder, arguments, m_width, m_height, m_parameters);
+        initialized = (cmResultSuccess == m_encoder->InitializeExt(&m_parameters));
+    }
+    catch (std::exception &e) {
+        std::cerr << "openh264: Invalid encoder arguments, " << e.what() << "." << std::endl;
+    }
+    if (!initialized) {
+        WelsDestroySVCEncoder(m_encoder);
+        m_encoder = nullptr;
+        return;
+    }
+    m_targetBitrate = m_parameters.iTargetBitrate;
+    m_longTermReference = m_parameters.bEnableLongTermReference;
+    m_buffer.resize(m_width * m_height);
+}
+
+OpenH264Backend::~OpenH264Backend() {
+    if (nullptr != m_encoder) {
+        m_encoder->Uninitialize();
+        WelsDestroySVCEncoder(m_encoder);
+    }
+}
+
+bool OpenH264Backend::valid() const noexcept {
+    return (nullptr != m_encoder);
+}
+
+const char *OpenH264Backend::fourcc() const noexcept {
+    return "h264";
+}
+
+int32_t OpenH264Backend::targetBitrate() const noexcept {
+    return m_targetBitrate;
+}
+
+std::string OpenH264Backend::configuration() const noexcept {
+    return describeEncoderParameters(m_parameters);
+}
+
+void OpenH264Backend::forceIntraFrame() noexcept {
+    if (nullptr != m_encoder) {
+        m_encoder->ForceIntraFrame(true);
+    }
+}
+
+void OpenH264Backend::feedback(const ReferenceFeedback &feedback) noexcept {
+    if (nullptr == m_encoder) {
+        return;
+    }
+    if (ReferenceFeedback::RECOVERY_REQUEST == feedback.type) {
+        if (!m_longTermReference) {
+            m_encoder->ForceIntraFrame(true);
+            return;
+        }
+        // The encoder continues with a P frame referring to a long-term
+        // reference frame that the decoder confirmed before the loss; it
+        // falls back to an IDR frame if there is none.
+        SLTRRecoverRequest request;
+        request.uiFeedbackType       = LTR_RECOVERY_REQUEST;
+        request.uiIDRPicId           = feedback.idrPictureId;
+        request.iLastCorrectFrameNum = feedback.frameNumber;
+        request.iCurrentFrameNum     = feedback.currentFrameNumber;
+        request.iLayerId             = 0;
+        if (cmResultSuccess != m_encoder->SetOption(ENCODER_LTR_RECOVERY_REQUEST, &request)) {
+            m_encoder->ForceIntraFrame(true);
+        }
+    }
+    else if (m_longTermReference) {
+        SLTRMarkingFeedback marking;
+        marking.uiFeedbackType = (ReferenceFeedback::MARKING_SUCCESS == feedback.type) ? LTR_MARKING_SUCCESS : LTR_MARKING_FAILED;
+        marking.uiIDRPicId     = feedback.idrPictureId;
+        marking.iLTRFrameNum   = feedback.frameNumber;
+        marking.iLayerId       = 0;
+        m_encoder->SetOption(ENCODER_LTR_MARKING_FEEDBACK, &marking);
+    }
+}
+
+bool OpenH264Backend::setScreenContent(bool screenContent) noexcept {
+    const EUsageType USAGE{screenContent ? EUsageType::SCREEN_CONTENT_REAL_TIME : EUsageType::CAMERA_VIDEO_REAL_TIME};
+    if (nullptr == m_encoder) {
+        return false;
+    }
+    if (USAGE == m_parameters.iUsageType) {
+        return true;
+    }
+    // Setting the parameters of a running encoder re-initializes it.
+    const EUsageType PREVIOUS{m_parameters.iUsageType};
+    m_parameters.iUsageType = USAGE;
+    if (cmResultSuccess != m_encoder->SetOption(ENCODER_OPTION_SVC_ENCODE_PARAM_EXT, &m_parameters)) {
+        m_parameters.iUsageType = PREVIOUS;
+        return false;
+    }
+    return true;
+}
+
+bool OpenH264Backend::supportsCoarsening() const noexcept {
+    return true;
+}
+
+bool OpenH264Backend::coarsenNextFrame(uint32_t steps) noexcept {
+    const int32_t QP_MAX{51};
+    if (nullptr == m_encoder) {
+        return false;
+    }
+    // Without rate control, the QP of the layer is used for all frames;
+    // otherwise, the rate control is kept above the QP of the last frame.
+    const bool FIXED_QP{RC_OFF_MODE == m_parameters.iRCMode};
+    int32_t qp{FIXED_QP ? m_parameters.sSpatialLayers[0].iDLayerQp : m_parameters.iMinQp};
+    if (!FIXED_QP && !m_coarsened) {
+        SEncoderStatistics statistics;
+        memset(&statistics, 0, sizeof(SEncoderStatistics));
+        if (cmResultSuccess == m_encoder->GetOption(ENCODER_OPTION_GET_STATISTICS, &statistics)) {
+            qp = std::max(qp, static_cast<int32_t>(statistics.uiAverageFrameQP));
+        }
+    }
+    if (QP_MAX <= qp) {
+        return false;
+    }
+    qp = std::min(qp + static_cast<int32_t>(std::max(steps, 1u)), QP_MAX);
+
+    const int32_t PREVIOUS_MIN_QP{m_parameters.iMinQp};
+    const int32_t PREVIOUS_MAX_QP{m_parameters.iMaxQp};
+    const int32_t PREVIOUS_LAYER_QP{m_parameters.sSpatialLayers[0].iDLayerQp};
+    m_parameters.iMinQp = qp;
+    m_parameters.iMaxQp = QP_MAX;
+    m_parameters.sSpatialLayers[0].iDLayerQp = qp;
+    // The frame is encoded as IDR frame as the decoder never receives the
+    // rejected frame, which the encoder would refer to otherwise.
+    if (cmResultSuccess != m_encoder->SetOption(ENCODER_OPTION_SVC_ENCODE_PARAM_EXT, &m_parameters)) {
+        m_parameters.iMinQp = PREVIOUS_MIN_QP;
+        m_parameters.iMaxQp = PREVIOUS_MAX_QP;
+        m_parameters.sSpatialLayers[0].iDLayerQp = PREVIOUS_LAYER_QP;
+        return false;
+    }
+    m_encoder->ForceIntraFrame(true);
+    if (!m_coarsened) {
+        m_regularMinQp = PREVIOUS_MIN_QP;
+        m_regularMaxQp = PREVIOUS_MAX_QP;
+        m_regularLayerQp = PREVIOUS_LAYER_QP;
+        m_coarsened = true;
+    }
+    m_coarseFrame = true;
+    return true;
+}
+
+bool OpenH264Backend::encode(const uint8_t *planes[3], const uint32_t strides[3], AccessUnit &accessUnit, int64_t timeStamp) noexcept {
+    accessUnit = AccessUnit{};
+    if (nullptr == m_encoder) {
+        return false;
+    }
+
+    SSourcePicture sourceFrame;
+    memset(&sourceFrame, 0, sizeof(SSourcePicture));
+    sourceFrame.iColorFormat = EVideoFormatType::videoFormatI420;
+    sourceFrame.iPicWidth = static_cast<int>(m_width);
+    sourceFrame.iPicHeight = static_cast<int>(m_height);
+    for (uint8_t plane{0}; plane < 3; plane++) {
+        sourceFrame.iStride[plane] = static_cast<int>(strides[plane]);
+        sourceFrame.pData[plane] = const_cast<uint8_t*>(planes[plane]);
+    }
+    sourceFrame.uiTimeStamp = timeStamp;
+
+    // Only the re-encoded frame is coarser; the regular QP range applies
+    // again from the next frame on, independent of the GOP.
+    if (m_coarsened && !m_coarseFrame) {
+        m_parameters.iMinQp = m_regularMinQp;
+        m_parameters.iMaxQp = m_regularMaxQp;
+        m_parameters.sSpatialLayers[0].iDLayerQp = m_regularLayerQp;
+        m_coarsened = (cmResultSuccess != m_encoder->SetOption(ENCODER_OPTION_SVC_ENCODE_PARAM_EXT, &m_parameters));
+    }
+    m_coarseFrame = false;
+
+    SFrameBSInfo frameInfo;
+    memset(&frameInfo, 0, sizeof(SFrameBSInfo));
+    if (cmResultSuccess != m_encoder->EncodeFrame(&sourceFrame, &frameInfo)) {
+        return false;
+    }
+    accessUnit.frameType = frameInfo.eFrameType;
+    if (videoFrameTypeSkip == frameInfo.eFrameType) {
+        return true;
+    }
+
+    // Concatenate the NAL units of all layers into one access unit.
+    uint32_t totalSize{0};
+    for (int layer{0}; layer < frameInfo.iLayerNum; layer++) {
+        for (int nal{0}; nal < frameInfo.sLayerInfo[layer].iNalCount; nal++) {
+            totalSize += static_cast<uint32_t>(frameInfo.sLayerInfo[layer].pNalLengthInByte[nal]);
+        }
+    }
+    if (m_buffer.size() < totalSize) {
+        m_buffer.resize(totalSize);
+    }
+    uint32_t offset{0};
+    for (int layer{0}; layer < frameInfo.iLayerNum; layer++) {
+        uint32_t sizeOfLayer{0};
+        for (int nal{0}; nal < frameInfo.sLayerInfo[layer].iNalCount; nal++) {
+            sizeOfLayer += static_cast<uint32_t>(frameInfo.sLayerInfo[layer].pNalLengthInByte[nal]);
+        }
+        memcpy(&m_buffer[offset], frameInfo.sLayerInfo[layer].pBsBuf, sizeOfLayer);
+        offset += sizeOfLayer;
+    }
+    accessUnit.data = m_buffer.data();
+    accessUnit.size = totalSize;
+    return true;
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OPENH264_BACKEND_HPP
+#define OPENH264_BACKEND_HPP
+
+#include "encoder-backend.hpp"
+
+#include <wels/codec_api.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * Encoder backend using Cisco's openh264.
+ */
+class OpenH264Backend : public EncoderBackend {
+   private:
+    OpenH264Backend(const OpenH264Backend &) = delete;
+    OpenH264Backend(OpenH264Backend &&)      = delete;
+    OpenH264Backend &operator=(const OpenH264Backend &) = delete;
+    OpenH264Backend &operator=(OpenH264Backend &&) = delete;
+
+   public:
+    OpenH264Backend(uint32_t width, uint32_t height, std::map<std::string, std::string> &arguments, bool verbose) noexcept;
+    ~OpenH264Backend() override;
+
+   public:
+    bool valid() const noexcept override;
+    const char *fourcc() const noexcept override;
+    int32_t targetBitrate() const noexcept override;
+    std::string configuration() const noexcept override;
+    void forceIntraFrame() noexcept override;
+    void feedback(const ReferenceFeedback &feedback) noexcept override;
+    bool setScreenContent(bool screenContent) noexcept override;
+    bool supportsCoarsening() const noexcept override;
+    bool coarsenNextFrame(uint32_t steps) noexcept override;
+    bool encode(const uint8_t *planes[3], const uint32_t strides[3], AccessUnit &accessUnit, int64_t timeStamp) noexcept override;
+
+   private:
+    ISVCEncoder *m_encoder{nullptr};
+    uint32_t m_width{0};
+    uint32_t m_height{0};
+    SEncParamExt m_parameters{};
+    int32_t m_targetBitrate{0};
+    bool m_longTermReference{false};
+    bool m_coarsened{false};
+    bool m_coarseFrame{false}; // The next frame is encoded with the raised QP.
+    int32_t m_regularMinQp{0};
+    int32_t m_regularMaxQp{0};
+    int32_t m_regularLayerQp{0};
+    std::vector<char> m_buffer{};
+};
+
+#endif
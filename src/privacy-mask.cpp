@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "privacy-mask.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+    #define HAVE_X86_SIMD
+#endif
+
+namespace {
+
+// The blurred value is (sum * factor + 2^23) >> 24 with factor = 2^24 / (2 * radius + 1)^2.
+const uint32_t SCALE_BITS{24};
+
+void updateRowScalar(uint32_t *sums, uint16_t *oldest, const uint16_t *newest, uint32_t width, uint32_t factor, uint8_t *output) noexcept {
+    for (uint32_t x{0}; x < width; x++) {
+        sums[x] = sums[x] + newest[x] - oldest[x];
+        oldest[x] = newest[x];
+        output[x] = static_cast<uint8_t>(std::min((sums[x] * factor + (1u << (SCALE_BITS - 1))) >> SCALE_BITS, 255u));
+    }
+}
+
+#ifdef HAVE_X86_SIMD
+__attribute__((target("avx2")))
+void updateRowAVX2(uint32_t *sums, uint16_t *oldest, const uint16_t *newest, uint32_t width, uint32_t factor, uint8_t *output) noexcept {
+    const __m256i FACTOR{_mm256_set1_epi32(static_cast<int32_t>(factor))};
+    const __m256i ROUND{_mm256_set1_epi32(1 << (SCALE_BITS - 1))};
+    uint32_t x{0};
+    for (; (x + 8) <= width; x += 8) {
+        const __m128i n16{_mm_loadu_si128(reinterpret_cast<const __m128i*>(newest + x))};
+        const __m256i n{_mm256_cvtepu16_epi32(n16)};
+        const __m256i o{_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(oldest + x)))};
+        __m256i s{_mm256_loadu_si256(reinterpret_cast<const __m256i*>(sums + x))};
+        s = _mm256_sub_epi32(_mm256_add_epi32(s, n), o);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(sums + x), s);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(oldest + x), n16);
+        const __m256i r{_mm256_srli_epi32(_mm256_add_epi32(_mm256_mullo_epi32(s, FACTOR), ROUND), SCALE_BITS)};
+        const __m128i r16{_mm_packus_epi32(_mm256_castsi256_si128(r), _mm256_extracti128_si256(r, 1))};
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(output + x), _mm_packus_epi16(r16, r16));
+    }
+    updateRowScalar(sums + x, oldest + x, newest + x, width - x, factor, output + x);
+}
+#endif
+
+using UpdateRow = void (*)(uint32_t *, uint16_t *, const uint16_t *, uint32_t, uint32_t, uint8_t *);
+
+struct Implementation {
+    UpdateRow updateRow{nullptr};
+    const char *name{nullptr};
+};
+
+Implementation selectImplementation() noexcept {
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return Implementation{updateRowAVX2, "avx2"};
+    }
+#endif
+    return Implementation{updateRowScalar, "scalar"};
+}
+
+const Implementation &selectedImplementation() noexcept {
+    static const Implementation IMPLEMENTATION{selectImplementation()};
+    return IMPLEMENTATION;
+}
+
+inline int32_t clamp(int32_t v, int32_t low, int32_t high) noexcept {
+    return std::min(std::max(v, low), high);
+}
+
+} // namespace
+
+PrivacyMask::PrivacyMask(uint32_t width, uint32_t height, const std::vector<MaskPolygon> &polygons, bool blur, uint32_t radius) noexcept
+    : m_width{width}
+    , m_height{height}
+    , m_blur{blur}
+    , m_output(width * height * 3 / 2) {
+    radius = std::min(std::max(radius, 1u), 32u);
+    size_t widest{0};
+    for (uint32_t plane{0}; plane < 3; plane++) {
+        const double SCALE{(0 == plane) ? 1.0 : 0.5};
+        const int32_t WIDTH{static_cast<int32_t>((0 == plane) ? width : width / 2)};
+        const int32_t HEIGHT{static_cast<int32_t>((0 == plane) ? height : height / 2)};
+        m_radius[plane] = (0 == plane) ? radius : std::max(radius / 2, 1u);
+        const uint32_t K{2 * m_radius[plane] + 1};
+        m_factor[plane] = ((1u << SCALE_BITS) + (K * K) / 2) / (K * K);
+
+        // Rasterize every polygon with the even-odd rule at the pixel centers.
+        for (auto &polygon : polygons) {
+            const size_t N{polygon.vertices.size()};
+            double minY{static_cast<double>(HEIGHT)};
+            double maxY{0.0};
+            for (auto &vertex : polygon.vertices) {
+                minY = std::min(minY, vertex.second * SCALE);
+                maxY = std::max(maxY, vertex.second * SCALE);
+            }
+            Area area;
+            area.x0 = static_cast<uint32_t>(WIDTH);
+            area.y0 = static_cast<uint32_t>(HEIGHT);
+            std::vector<std::vector<Span>> rows;
+            const int32_t FIRST{clamp(static_cast<int32_t>(std::floor(minY)), 0, HEIGHT)};
+            const int32_t LAST{clamp(static_cast<int32_t>(std::ceil(maxY)), 0, HEIGHT)};
+            for (int32_t y{FIRST}; y < LAST; y++) {
+                const double YC{y + 0.5};
+                std::vector<double> crossings;
+                for (size_t i{0}; i < N; i++) {
+                    const double XA{polygon.vertices[i].first * SCALE}, YA{polygon.vertices[i].second * SCALE};
+                    const double XB{polygon.vertices[(i + 1) % N].first * SCALE}, YB{polygon.vertices[(i + 1) % N].second * SCALE};
+                    if ((YA <= YC) != (YB <= YC)) {
+                        crossings.push_back(XA + (YC - YA) * (XB - XA) / (YB - YA));
+                    }
+                }
+                std::sort(crossings.begin(), crossings.end());
+                std::vector<Span> spans;
+                for (size_t i{0}; (i + 1) < crossings.size(); i += 2) {
+                    Span span;
+                    span.begin = static_cast<uint32_t>(clamp(static_cast<int32_t>(std::ceil(crossings[i] - 0.5)), 0, WIDTH));
+                    span.end = static_cast<uint32_t>(clamp(static_cast<int32_t>(std::ceil(crossings[i + 1] - 0.5)), 0, WIDTH));
+                    if (span.begin < span.end) {
+                        spans.push_back(span);
+                        area.x0 = std::min(area.x0, span.begin);
+                        area.x1 = std::max(area.x1, span.end);
+                        area.y0 = std::min(area.y0, static_cast<uint32_t>(y));
+                        area.y1 = std::max(area.y1, static_cast<uint32_t>(y) + 1);
+                    }
+                }
+                rows.push_back(spans);
+            }
+            if (area.x0 < area.x1) {
+                area.spans.assign(rows.begin() + (area.y0 - FIRST), rows.begin() + (area.y1 - FIRST));
+                const uint32_t AREA_WIDTH{area.x1 - area.x0};
+                area.sums.resize(AREA_WIDTH);
+                area.rows.resize(K * AREA_WIDTH);
+                widest = std::max(widest, static_cast<size_t>(AREA_WIDTH));
+                m_areas[plane].push_back(area);
+            }
+        }
+    }
+    m_horizontalSums.resize(widest);
+    m_blurred.resize(widest);
+}
+
+const uint8_t *PrivacyMask::apply(const uint8_t *planes[3], const uint32_t strides[3]) noexcept {
+    const uint8_t FILL[3]{16, 128, 128};
+    uint8_t *output{m_output.data()};
+    for (uint32_t plane{0}; plane < 3; plane++) {
+        const uint32_t WIDTH{(0 == plane) ? m_width : m_width / 2};
+        const uint32_t HEIGHT{(0 == plane) ? m_height : m_height / 2};
+        for (uint32_t y{0}; y < HEIGHT; y++) {
+            std::memcpy(output, planes[plane] + y * strides[plane], WIDTH);
+            for (auto &area : m_areas[plane]) {
+                if ((area.y0 <= y) && (y < area.y1)) {
+                    if (m_blur) {
+                        blurRow(area, plane, planes[plane], strides[plane], y, output);
+                    }
+                    else {
+                        for (auto &span : area.spans[y - area.y0]) {
+                            std::memset(output + span.begin, FILL[plane], span.end - span.begin);
+                        }
+                    }
+                }
+            }
+            output += WIDTH;
+        }
+    }
+    return m_output.data();
+}
+
+void PrivacyMask::blurRow(Area &area, uint32_t plane, const uint8_t *input, uint32_t stride, uint32_t y, uint8_t *output) noexcept {
+    const int32_t R{static_cast<int32_t>(m_radius[plane])};
+    const int32_t K{2 * R + 1};
+    const int32_t WIDTH{static_cast<int32_t>((0 == plane) ? m_width : m_width / 2)};
+    const int32_t HEIGHT{static_cast<int32_t>((0 == plane) ? m_height : m_height / 2)};
+    const uint32_t AREA_WIDTH{area.x1 - area.x0};
+    const int32_t X0{static_cast<int32_t>(area.x0)};
+
+    // Box sums of the row v (clamped to the frame) for the columns of the area.
+    auto horizontalSums = [&](int32_t v, uint16_t *sums) {
+        const uint8_t *row{input + clamp(v, 0, HEIGHT - 1) * stride};
+        uint32_t sum{0};
+        for (int32_t dx{-R}; dx <= R; dx++) {
+            sum += row[clamp(X0 + dx, 0, WIDTH - 1)];
+        }
+        for (uint32_t i{0}; i < AREA_WIDTH; i++) {
+            sums[i] = static_cast<uint16_t>(sum);
+            const int32_t X{X0 + static_cast<int32_t>(i)};
+            sum = sum + row[clamp(X + R + 1, 0, WIDTH - 1)] - row[clamp(X - R, 0, WIDTH - 1)];
+        }
+    };
+
+    // The horizontal sums of row v are kept in slot v mod K until row v + K replaces them.
+    const int32_t Y{static_cast<int32_t>(y)};
+    if (area.y0 == y) {
+        std::fill(area.sums.begin(), area.sums.end(), 0);
+        for (int32_t v{Y - R}; v <= Y + R; v++) {
+            uint16_t *slot{area.rows.data() + ((v + K) % K) * AREA_WIDTH};
+            horizontalSums(v, slot);
+            for (uint32_t i{0}; i < AREA_WIDTH; i++) {
+                area.sums[i] += slot[i];
+            }
+        }
+        for (uint32_t i{0}; i < AREA_WIDTH; i++) {
+            m_blurred[i] = static_cast<uint8_t>(std::min((area.sums[i] * m_factor[plane] + (1u << (SCALE_BITS - 1))) >> SCALE_BITS, 255u));
+        }
+    }
+    else {
+        horizontalSums(Y + R, m_horizontalSums.data());
+        selectedImplementation().updateRow(area.sums.data(), area.rows.data() + ((Y + R) % K) * AREA_WIDTH, m_horizontalSums.data(), AREA_WIDTH, m_factor[plane], m_blurred.data());
+    }
+    for (auto &span : area.spans[y - area.y0]) {
+        std::memcpy(output + span.begin, m_blurred.data() + (span.begin - area.x0), span.end - span.begin);
+    }
+}
+
+const char *PrivacyMask::implementation() const noexcept {
+    return m_blur ? selectedImplementation().name : "scalar";
+}
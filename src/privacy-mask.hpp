@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PRIVACY_MASK_HPP
+#define PRIVACY_MASK_HPP
+
+#include "encoder-parameters.hpp"
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Privacy masks for I420 frames: the pixels inside the configured polygons
+ * are either filled with black or replaced by a box blur of their
+ * neighborhood. The frame is copied row by row into an own buffer and the
+ * masks are applied to each row right after copying it; the blur runs on
+ * AVX2 if available.
+ */
+class PrivacyMask {
+   private:
+    PrivacyMask(const PrivacyMask &) = delete;
+    PrivacyMask(PrivacyMask &&)      = delete;
+    PrivacyMask &operator=(const PrivacyMask &) = delete;
+    PrivacyMask &operator=(PrivacyMask &&) = delete;
+
+   public:
+    /**
+     * @param width Width of the frames.
+     * @param height Height of the frames.
+     * @param polygons Areas to mask in luma coordinates.
+     * @param blur Blur the areas instead of filling them.
+     * @param radius Radius of the box blur in luma pixels (1-32); halved for the chroma planes.
+     */
+    PrivacyMask(uint32_t width, uint32_t height, const std::vector<MaskPolygon> &polygons, bool blur, uint32_t radius) noexcept;
+
+   public:
+    /**
+     * @param planes Y, U, and V planes of the frame, e.g., in the shared memory area.
+     * @param strides Strides of the Y, U, and V planes.
+     * @return Masked I420 frame of width * height * 3 / 2 bytes; valid until the next call.
+     */
+    const uint8_t *apply(const uint8_t *planes[3], const uint32_t strides[3]) noexcept;
+
+    /**
+     * @return Name of the used instruction set for the blur (avx2 or scalar).
+     */
+    const char *implementation() const noexcept;
+
+   private:
+    struct Span {
+        uint32_t begin{0};
+        uint32_t end{0};
+    };
+
+    // A polygon rasterized for one plane with the state of its blur.
+    struct Area {
+        uint32_t x0{0};
+        uint32_t x1{0};
+        uint32_t y0{0};
+        uint32_t y1{0};
+        std::vector<std::vector<Span>> spans{}; // Per row from y0 to y1.
+        std::vector<uint32_t> sums{};           // Vertical sums of the horizontal sums per column.
+        std::vector<uint16_t> rows{};           // Horizontal sums of the last 2 * radius + 1 rows.
+    };
+
+    void blurRow(Area &area, uint32_t plane, const uint8_t *input, uint32_t stride, uint32_t y, uint8_t *output) noexcept;
+
+   private:
+    uint32_t m_width{0};
+    uint32_t m_height{0};
+    bool m_blur{true};
+    uint32_t m_radius[3]{0, 0, 0};
+    uint32_t m_factor[3]{0, 0, 0};
+    std::vector<Area> m_areas[3]{};
+    std::vector<uint16_t> m_horizontalSums{};
+    std::vector<uint8_t> m_blurred{};
+    std::vector<uint8_t> m_output{};
+};
+
+#endif
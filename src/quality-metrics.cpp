@@ -0,0 +1,244 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "quality-metrics.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+    #define HAVE_X86_SIMD
+#endif
+
+namespace {
+
+uint64_t sumOfSquaredErrorsRowScalar(const uint8_t *a, const uint8_t *b, uint32_t width) noexcept {
+    uint64_t sum{0};
+    for (uint32_t x{0}; x < width; x++) {
+        const int32_t d{static_cast<int32_t>(a[x]) - static_cast<int32_t>(b[x])};
+        sum += static_cast<uint64_t>(d * d);
+    }
+    return sum;
+}
+
+#ifdef HAVE_X86_SIMD
+uint64_t sumOfSquaredErrorsRowSSE2(const uint8_t *a, const uint8_t *b, uint32_t width) noexcept {
+    const __m128i ZERO{_mm_setzero_si128()};
+    __m128i acc{_mm_setzero_si128()};
+    uint32_t x{0};
+    for (; (x + 16) <= width; x += 16) {
+        const __m128i va{_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + x))};
+        const __m128i vb{_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + x))};
+        const __m128i dlo{_mm_sub_epi16(_mm_unpacklo_epi8(va, ZERO), _mm_unpacklo_epi8(vb, ZERO))};
+        const __m128i dhi{_mm_sub_epi16(_mm_unpackhi_epi8(va, ZERO), _mm_unpackhi_epi8(vb, ZERO))};
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(dlo, dlo));
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(dhi, dhi));
+    }
+    alignas(16) uint32_t lanes[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), acc);
+    uint64_t sum{static_cast<uint64_t>(lanes[0]) + lanes[1] + lanes[2] + lanes[3]};
+    return sum + sumOfSquaredErrorsRowScalar(a + x, b + x, width - x);
+}
+
+__attribute__((target("avx2")))
+uint64_t sumOfSquaredErrorsRowAVX2(const uint8_t *a, const uint8_t *b, uint32_t width) noexcept {
+    __m256i acc{_mm256_setzero_si256()};
+    uint32_t x{0};
+    for (; (x + 16) <= width; x += 16) {
+        const __m256i va{_mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + x)))};
+        const __m256i vb{_mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + x)))};
+        const __m256i d{_mm256_sub_epi16(va, vb)};
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(d, d));
+    }
+    alignas(32) uint32_t lanes[8];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), acc);
+    uint64_t sum{0};
+    for (auto lane : lanes) {
+        sum += lane;
+    }
+    return sum + sumOfSquaredErrorsRowScalar(a + x, b + x, width - x);
+}
+#endif
+
+using SumOfSquaredErrorsRow = uint64_t (*)(const uint8_t *, const uint8_t *, uint32_t);
+
+SumOfSquaredErrorsRow selectSumOfSquaredErrorsRow() noexcept {
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return sumOfSquaredErrorsRowAVX2;
+    }
+    return sumOfSquaredErrorsRowSSE2;
+#else
+    return sumOfSquaredErrorsRowScalar;
+#endif
+}
+
+uint64_t sumOfAbsoluteDifferencesRow(const uint8_t *a, const uint8_t *b, uint32_t width) noexcept {
+    uint64_t sum{0};
+    uint32_t x{0};
+#ifdef HAVE_X86_SIMD
+    __m128i acc{_mm_setzero_si128()};
+    for (; (x + 16) <= width; x += 16) {
+        const __m128i va{_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + x))};
+        const __m128i vb{_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + x))};
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(va, vb));
+    }
+    alignas(16) uint64_t lanes[2];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), acc);
+    sum = lanes[0] + lanes[1];
+#endif
+    for (; x < width; x++) {
+        sum += static_cast<uint64_t>(a[x] > b[x] ? a[x] - b[x] : b[x] - a[x]);
+    }
+    return sum;
+}
+
+struct WindowSums {
+    uint32_t a{0};
+    uint32_t b{0};
+    uint32_t aa{0};
+    uint32_t bb{0};
+    uint32_t ab{0};
+};
+
+WindowSums windowSums8x8(const uint8_t *a, uint32_t strideA, const uint8_t *b, uint32_t strideB) noexcept {
+    WindowSums sums;
+#ifdef HAVE_X86_SIMD
+    const __m128i ZERO{_mm_setzero_si128()};
+    __m128i sa{_mm_setzero_si128()};
+    __m128i sb{_mm_setzero_si128()};
+    __m128i saa{_mm_setzero_si128()};
+    __m128i sbb{_mm_setzero_si128()};
+    __m128i sab{_mm_setzero_si128()};
+    for (uint32_t y{0}; y < 8; y++) {
+        const __m128i va8{_mm_loadl_epi64(reinterpret_cast<const __m128i*>(a + y * strideA))};
+        const __m128i vb8{_mm_loadl_epi64(reinterpret_cast<const __m128i*>(b + y * strideB))};
+        sa = _mm_add_epi64(sa, _mm_sad_epu8(va8, ZERO));
+        sb = _mm_add_epi64(sb, _mm_sad_epu8(vb8, ZERO));
+        const __m128i va{_mm_unpacklo_epi8(va8, ZERO)};
+        const __m128i vb{_mm_unpacklo_epi8(vb8, ZERO)};
+        saa = _mm_add_epi32(saa, _mm_madd_epi16(va, va));
+        sbb = _mm_add_epi32(sbb, _mm_madd_epi16(vb, vb));
+        sab = _mm_add_epi32(sab, _mm_madd_epi16(va, vb));
+    }
+    auto horizontalSum = [](__m128i v) {
+        v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+        v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+        return static_cast<uint32_t>(_mm_cvtsi128_si32(v));
+    };
+    sums.a = static_cast<uint32_t>(_mm_cvtsi128_si32(sa));
+    sums.b = static_cast<uint32_t>(_mm_cvtsi128_si32(sb));
+    sums.aa = horizontalSum(saa);
+    sums.bb = horizontalSum(sbb);
+    sums.ab = horizontalSum(sab);
+#else
+    for (uint32_t y{0}; y < 8; y++) {
+        for (uint32_t x{0}; x < 8; x++) {
+            const uint32_t va{a[y * strideA + x]};
+            const uint32_t vb{b[y * strideB + x]};
+            sums.a += va;
+            sums.b += vb;
+            sums.aa += va * va;
+            sums.bb += vb * vb;
+            sums.ab += va * vb;
+        }
+    }
+#endif
+    return sums;
+}
+
+} // namespace
+
+uint64_t sumOfSquaredErrors(const uint8_t *a, uint32_t strideA, const uint8_t *b, uint32_t strideB, uint32_t width, uint32_t height) noexcept {
+    static const SumOfSquaredErrorsRow ROW{selectSumOfSquaredErrorsRow()};
+    uint64_t sum{0};
+    for (uint32_t y{0}; y < height; y++) {
+        sum += ROW(a + y * strideA, b + y * strideB, width);
+    }
+    return sum;
+}
+
+double psnrFromSumOfSquaredErrors(uint64_t sse, uint64_t samples) noexcept {
+    const double MAX_PSNR{100.0};
+    if ((0 == sse) || (0 == samples)) {
+        return MAX_PSNR;
+    }
+    const double mse{static_cast<double>(sse) / static_cast<double>(samples)};
+    return std::min(MAX_PSNR, 10.0 * std::log10((255.0 * 255.0) / mse));
+}
+
+double ssim(const uint8_t *a, uint32_t strideA, const uint8_t *b, uint32_t strideB, uint32_t width, uint32_t height) noexcept {
+    const double N{64.0};
+    const double C1{(0.01 * 255.0) * (0.01 * 255.0)};
+    const double C2{(0.03 * 255.0) * (0.03 * 255.0)};
+
+    double sum{0.0};
+    uint64_t windows{0};
+    for (uint32_t y{0}; (y + 8) <= height; y += 4) {
+        for (uint32_t x{0}; (x + 8) <= width; x += 4) {
+            const WindowSums s{windowSums8x8(a + y * strideA + x, strideA, b + y * strideB + x, strideB)};
+            const double muA{s.a / N};
+            const double muB{s.b / N};
+            const double varA{s.aa / N - muA * muA};
+            const double varB{s.bb / N - muB * muB};
+            const double cov{s.ab / N - muA * muB};
+            sum += ((2.0 * muA * muB + C1) * (2.0 * cov + C2)) / ((muA * muA + muB * muB + C1) * (varA + varB + C2));
+            windows++;
+        }
+    }
+    return (0 < windows) ? sum / static_cast<double>(windows) : 1.0;
+}
+
+FrameQuality compareI420(const uint8_t *a[3], const uint32_t strideA[3], const uint8_t *b[3], const uint32_t strideB[3], uint32_t width, uint32_t height) noexcept {
+    const uint32_t CHROMA_WIDTH{(width + 1) / 2};
+    const uint32_t CHROMA_HEIGHT{(height + 1) / 2};
+    const uint64_t sseY{sumOfSquaredErrors(a[0], strideA[0], b[0], strideB[0], width, height)};
+    const uint64_t sseU{sumOfSquaredErrors(a[1], strideA[1], b[1], strideB[1], CHROMA_WIDTH, CHROMA_HEIGHT)};
+    const uint64_t sseV{sumOfSquaredErrors(a[2], strideA[2], b[2], strideB[2], CHROMA_WIDTH, CHROMA_HEIGHT)};
+    const uint64_t lumaSamples{static_cast<uint64_t>(width) * height};
+    const uint64_t chromaSamples{static_cast<uint64_t>(CHROMA_WIDTH) * CHROMA_HEIGHT};
+
+    FrameQuality quality;
+    quality.psnrY = psnrFromSumOfSquaredErrors(sseY, lumaSamples);
+    quality.psnrU = psnrFromSumOfSquaredErrors(sseU, chromaSamples);
+    quality.psnrV = psnrFromSumOfSquaredErrors(sseV, chromaSamples);
+    quality.psnr = (6.0 * quality.psnrY + quality.psnrU + quality.psnrV) / 8.0;
+    quality.ssim = ssim(a[0], strideA[0], b[0], strideB[0], width, height);
+    return quality;
+}
+
+double meanAbsoluteDifference(const uint8_t *a, uint32_t strideA, const uint8_t *b, uint32_t strideB, uint32_t width, uint32_t height) noexcept {
+    if ((0 == width) || (0 == height)) {
+        return 0.0;
+    }
+    uint64_t sum{0};
+    for (uint32_t y{0}; y < height; y++) {
+        sum += sumOfAbsoluteDifferencesRow(a + y * strideA, b + y * strideB, width);
+    }
+    return static_cast<double>(sum) / (static_cast<double>(width) * static_cast<double>(height));
+}
+
+double spatialActivity(const uint8_t *plane, uint32_t stride, uint32_t width, uint32_t height) noexcept {
+    if ((2 > width) || (2 > height)) {
+        return 0.0;
+    }
+    const double horizontal{meanAbsoluteDifference(plane, stride, plane + 1, stride, width - 1, height)};
+    const double vertical{meanAbsoluteDifference(plane, stride, plane + stride, stride, width, height - 1)};
+    return (horizontal + vertical) / 2.0;
+}
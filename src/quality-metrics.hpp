@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QUALITY_METRICS_HPP
+#define QUALITY_METRICS_HPP
+
+#include <cstdint>
+
+/**
+ * Quality of a decoded I420 frame compared to its original.
+ */
+struct FrameQuality {
+    double psnrY{0.0};
+    double psnrU{0.0};
+    double psnrV{0.0};
+    double psnr{0.0}; // Weighted 6:1:1 across Y, U, and V.
+    double ssim{0.0}; // Luma only.
+};
+
+/**
+ * @return Sum of squared differences between two 8bit planes (SSE2/AVX2 when available).
+ */
+uint64_t sumOfSquaredErrors(const uint8_t *a, uint32_t strideA, const uint8_t *b, uint32_t strideB, uint32_t width, uint32_t height) noexcept;
+
+/**
+ * @return PSNR in dB for the given sum of squared errors over the given number of samples (capped at 100dB for identical planes).
+ */
+double psnrFromSumOfSquaredErrors(uint64_t sse, uint64_t samples) noexcept;
+
+/**
+ * @return Mean SSIM of two 8bit planes computed on 8x8 windows with a step of 4 pixels.
+ */
+double ssim(const uint8_t *a, uint32_t strideA, const uint8_t *b, uint32_t strideB, uint32_t width, uint32_t height) noexcept;
+
+/**
+ * @return Quality of the I420 frame b compared to the I420 frame a; planes are
+ *         given as {Y, U, V} with their respective strides.
+ */
+FrameQuality compareI420(const uint8_t *a[3], const uint32_t strideA[3], const uint8_t *b[3], const uint32_t strideB[3], uint32_t width, uint32_t height) noexcept;
+
+/**
+ * @return Mean absolute difference between two 8bit planes (SSE2 when available).
+ */
+double meanAbsoluteDifference(const uint8_t *a, uint32_t strideA, const uint8_t *b, uint32_t strideB, uint32_t width, uint32_t height) noexcept;
+
+/**
+ * @return Spatial activity of an 8bit plane as mean absolute difference to
+ *         the right and lower neighbours.
+ */
+double spatialActivity(const uint8_t *plane, uint32_t stride, uint32_t width, uint32_t height) noexcept;
+
+#endif
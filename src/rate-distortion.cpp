@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cluon-complete.hpp"
+#include "encoder-parameters.hpp"
+#include "h264-decoder.hpp"
+#include "quality-metrics.hpp"
+#include "rate-distortion.hpp"
+#include "stream-encoder.hpp"
+
+#include <cstring>
+#include <vector>
+
+ClipResult evaluateClip(const I420Clip &clip, const std::string &preset, float fps) noexcept {
+    ClipResult result;
+
+    StreamEncoder encoder{clip.width(), clip.height(), getCommandlineArgumentsFromString(preset)};
+    H264Decoder decoder;
+    if (!encoder.valid() || !decoder.valid()) {
+        return result;
+    }
+
+    const uint32_t WIDTH{clip.width()};
+    const uint32_t HEIGHT{clip.height()};
+    const uint32_t STRIDES[3]{WIDTH, WIDTH / 2, WIDTH / 2};
+
+    // The last successfully decoded picture is kept to score skipped frames.
+    std::vector<uint8_t> lastDecoded(clip.frameSize(), 0);
+    uint8_t *lastY{lastDecoded.data()};
+    uint8_t *lastU{lastY + WIDTH * HEIGHT};
+    uint8_t *lastV{lastU + (WIDTH / 2) * (HEIGHT / 2)};
+    const uint8_t *lastPlanes[3]{lastY, lastU, lastV};
+
+    double sumPsnrY{0.0};
+    double sumPsnr{0.0};
+    double sumSsim{0.0};
+    int64_t encodingDuration{0};
+    for (uint32_t i{0}; i < clip.frames(); i++) {
+        const uint8_t *original{clip.frame(i)};
+        const uint8_t *originalPlanes[3]{original, original + WIDTH * HEIGHT, original + WIDTH * HEIGHT + (WIDTH / 2) * (HEIGHT / 2)};
+
+        AccessUnit accessUnit;
+        cluon::data::TimeStamp before{cluon::time::now()};
+        const bool encoded{encoder.encode(originalPlanes, STRIDES, accessUnit, static_cast<int64_t>(i * 1000.0f / fps))};
+        cluon::data::TimeStamp after{cluon::time::now()};
+        encodingDuration += cluon::time::deltaInMicroseconds(after, before);
+
+        if (!encoded || (0 == accessUnit.size)) {
+            result.skippedFrames++;
+        }
+        result.bytes += accessUnit.size;
+
+        DecodedPicture picture;
+        if ((0 < accessUnit.size) && decoder.decode(reinterpret_cast<const uint8_t*>(accessUnit.data), accessUnit.size, picture) && (WIDTH == picture.width) && (HEIGHT == picture.height)) {
+            FrameQuality quality{compareI420(originalPlanes, STRIDES, picture.planes, picture.strides, WIDTH, HEIGHT)};
+            sumPsnrY += quality.psnrY;
+            sumPsnr += quality.psnr;
+            sumSsim += quality.ssim;
+
+            for (uint32_t row{0}; row < HEIGHT; row++) {
+                memcpy(lastY + row * WIDTH, picture.planes[0] + row * picture.strides[0], WIDTH);
+            }
+            for (uint32_t row{0}; row < HEIGHT / 2; row++) {
+                memcpy(lastU + row * (WIDTH / 2), picture.planes[1] + row * picture.strides[1], WIDTH / 2);
+                memcpy(lastV + row * (WIDTH / 2), picture.planes[2] + row * picture.strides[2], WIDTH / 2);
+            }
+        }
+        else {
+            if (0 < accessUnit.size) {
+                result.undecodableFrames++;
+            }
+            FrameQuality quality{compareI420(originalPlanes, STRIDES, lastPlanes, STRIDES, WIDTH, HEIGHT)};
+            sumPsnrY += quality.psnrY;
+            sumPsnr += quality.psnr;
+            sumSsim += quality.ssim;
+        }
+        result.frames++;
+    }
+
+    if (0 < result.frames) {
+        const double FRAMES{static_cast<double>(result.frames)};
+        result.valid = true;
+        result.bitrateKbps = (static_cast<double>(result.bytes) * 8.0 * static_cast<double>(fps)) / (FRAMES * 1000.0);
+        result.psnrY = sumPsnrY / FRAMES;
+        result.psnr = sumPsnr / FRAMES;
+        result.ssim = sumSsim / FRAMES;
+        result.encodeMsPerFrame = (static_cast<double>(encodingDuration) / 1000.0) / FRAMES;
+        result.encodeFps = (0.0 < result.encodeMsPerFrame) ? 1000.0 / result.encodeMsPerFrame : 0.0;
+    }
+    return result;
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RATE_DISTORTION_HPP
+#define RATE_DISTORTION_HPP
+
+#include "i420-clip.hpp"
+
+#include <cstdint>
+#include <string>
+
+/**
+ * Result of encoding and decoding a clip with one parameter preset.
+ */
+struct ClipResult {
+    bool valid{false};
+    uint32_t frames{0};
+    uint32_t skippedFrames{0};
+    uint32_t undecodableFrames{0};
+    uint64_t bytes{0};
+    double bitrateKbps{0.0};
+    double psnrY{0.0};
+    double psnr{0.0};
+    double ssim{0.0};
+    double encodeFps{0.0};
+    double encodeMsPerFrame{0.0};
+};
+
+/**
+ * This function encodes all frames of the clip with the given preset,
+ * decodes the result with openh264, and compares it with the original.
+ * Skipped or undecodable frames are compared against the last decoded picture.
+ *
+ * @param clip Clip to encode.
+ * @param preset Encoder arguments as accepted by the microservice, e.g. "--ecomplexity=2 --num-ref-frame=4".
+ * @param fps Frame rate of the clip to compute the bitrate.
+ * @return Result.
+ */
+ClipResult evaluateClip(const I420Clip &clip, const std::string &preset, float fps) noexcept;
+
+#endif
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cluon-complete.hpp"
+#include "shared-memory-attach.hpp"
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+std::unique_ptr<cluon::SharedMemory> attachSharedMemory(const std::string &name, uint32_t timeout, const std::atomic<bool> *cancel) noexcept {
+    // Token files as created by cluon::SharedMemory.
+    const char *CLUON_SHAREDMEMORY_POSIX = getenv("CLUON_SHAREDMEMORY_POSIX");
+    const bool POSIX{(nullptr != CLUON_SHAREDMEMORY_POSIX) && ('1' == CLUON_SHAREDMEMORY_POSIX[0])};
+    const std::string BASENAME{name.substr(name.rfind('/') + 1)};
+    const std::string DIRECTORY{POSIX ? "/dev/shm" : "/tmp"};
+    const std::string TOKEN{DIRECTORY + "/" + BASENAME};
+
+    int fd{inotify_init1(IN_NONBLOCK | IN_CLOEXEC)};
+    if (-1 != fd) {
+        if (-1 == inotify_add_watch(fd, DIRECTORY.c_str(), IN_CREATE | IN_MOVED_TO | IN_CLOSE_WRITE | IN_ATTRIB)) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+    std::unique_ptr<cluon::SharedMemory> sharedMemory;
+    bool waiting{false};
+    const auto DEADLINE{std::chrono::steady_clock::now() + std::chrono::seconds(timeout)};
+    while (!cluon::TerminateHandler::instance().isTerminated.load() && ((nullptr == cancel) || !cancel->load())) {
+        // Only try to attach when the token file exists to not flood the log.
+        if (0 == ::access(TOKEN.c_str(), F_OK)) {
+            sharedMemory.reset(new cluon::SharedMemory{name});
+            if (sharedMemory->valid()) {
+                break;
+            }
+            sharedMemory.reset();
+        }
+        if (!waiting) {
+            std::clog << "Waiting for shared memory '" << TOKEN << "' to appear." << std::endl;
+            waiting = true;
+        }
+
+        // The area might become valid only after the token file was created;
+        // hence, attaching is retried periodically even without events.
+        int32_t sleepTime{250};
+        if (0 < timeout) {
+            const auto REMAINING{std::chrono::duration_cast<std::chrono::milliseconds>(DEADLINE - std::chrono::steady_clock::now()).count()};
+            if (0 >= REMAINING) {
+                break;
+            }
+            sleepTime = static_cast<int32_t>(std::min<int64_t>(sleepTime, REMAINING));
+        }
+        if (-1 != fd) {
+            struct pollfd pfd;
+            pfd.fd = fd;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            if (0 < ::poll(&pfd, 1, sleepTime)) {
+                char buffer[4096];
+                while (0 < ::read(fd, buffer, sizeof(buffer))) {}
+            }
+        }
+        else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(sleepTime));
+        }
+    }
+    if (-1 != fd) {
+        ::close(fd);
+    }
+    return sharedMemory;
+}
@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SHARED_MEMORY_ATTACH_HPP
+#define SHARED_MEMORY_ATTACH_HPP
+
+#include "cluon-complete.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/**
+ * This function attaches to the shared memory area with the given name and
+ * waits for it to appear if it does not exist yet; the directory holding the
+ * token files (/tmp for SysV, /dev/shm for POSIX) is watched with inotify.
+ *
+ * @param name Name of the shared memory area.
+ * @param timeout Seconds to wait for the area to appear (0: no limit).
+ * @param cancel Optional flag to stop waiting, e.g., when a stream is removed.
+ * @return Attached shared memory area or nullptr on timeout, cancellation, or termination.
+ */
+std::unique_ptr<cluon::SharedMemory> attachSharedMemory(const std::string &name, uint32_t timeout, const std::atomic<bool> *cancel = nullptr) noexcept;
+
+#endif
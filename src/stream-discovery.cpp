@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "stream-discovery.hpp"
+
+#include <fnmatch.h>
+
+#include <iostream>
+#include <sstream>
+
+namespace {
+const std::chrono::seconds RETRY_INTERVAL{1};
+}
+
+StreamDiscovery::StreamDiscovery(EncoderDaemon &daemon, const std::string &pattern, uint32_t timeout) noexcept
+    : m_daemon{daemon}
+    , m_pattern{pattern}
+    , m_timeout{timeout} {
+}
+
+void StreamDiscovery::announce(const std::string &name, uint32_t size, uint32_t width, uint32_t height, uint32_t senderStamp) noexcept {
+    // Areas with names the daemon cannot parse or without I420 content are ignored.
+    if (name.empty() || (std::string::npos != name.find_first_of(" \t\r\n")) || (0 != fnmatch(m_pattern.c_str(), name.c_str(), 0))) {
+        return;
+    }
+    if ((0 == width) || (0 == height) || (static_cast<uint64_t>(size) < static_cast<uint64_t>(width) * height * 3 / 2)) {
+        return;
+    }
+
+    const auto NOW{std::chrono::steady_clock::now()};
+    std::lock_guard<std::mutex> lck(m_areasMutex);
+    auto it = m_areas.find(name);
+    const bool ENCODING{(m_areas.end() != it) && it->second.encoding};
+    if (ENCODING && (width == it->second.width) && (height == it->second.height) && (senderStamp == it->second.senderStamp)) {
+        it->second.lastSeen = NOW;
+        return;
+    }
+    // Failed areas are retried with the next announcement after a pause.
+    if ((m_areas.end() != it) && (NOW < it->second.retry)) {
+        it->second.lastSeen = NOW;
+        return;
+    }
+
+    std::stringstream sstr;
+    sstr << (ENCODING ? "modify " : "add ") << name << " --name=" << name << " --width=" << width << " --height=" << height << " --id=" << senderStamp;
+    const std::string RESPONSE{m_daemon.handle(sstr.str())};
+    std::clog << "Discovered '" << name << "' (" << width << "x" << height << "): " << RESPONSE << std::endl;
+    Area &area{m_areas[name]};
+    area.lastSeen = NOW;
+    if (0 != RESPONSE.compare(0, 2, "OK")) {
+        // A failed modify keeps encoding with the previous geometry.
+        area.retry = NOW + RETRY_INTERVAL;
+        return;
+    }
+    area.width = width;
+    area.height = height;
+    area.senderStamp = senderStamp;
+    area.encoding = true;
+    area.retry = std::chrono::steady_clock::time_point{};
+}
+
+void StreamDiscovery::expire() noexcept {
+    const auto NOW{std::chrono::steady_clock::now()};
+    std::lock_guard<std::mutex> lck(m_areasMutex);
+    for (auto it = m_areas.begin(); it != m_areas.end();) {
+        if (NOW - it->second.lastSeen > m_timeout) {
+            if (it->second.encoding) {
+                std::clog << "Announcements for '" << it->first << "' stopped: " << m_daemon.handle("remove " + it->first) << std::endl;
+            }
+            it = m_areas.erase(it);
+        }
+        else {
+            it++;
+        }
+    }
+}
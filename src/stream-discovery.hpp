@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STREAM_DISCOVERY_HPP
+#define STREAM_DISCOVERY_HPP
+
+#include "encoder-daemon.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+/**
+ * Discovery of shared memory areas from ImageReadingShared announcements:
+ * a stream is added to the daemon for every announced area whose name
+ * matches the pattern and removed when its announcements stop.
+ */
+class StreamDiscovery {
+   private:
+    StreamDiscovery(const StreamDiscovery &) = delete;
+    StreamDiscovery(StreamDiscovery &&)      = delete;
+    StreamDiscovery &operator=(const StreamDiscovery &) = delete;
+    StreamDiscovery &operator=(StreamDiscovery &&) = delete;
+
+   public:
+    /**
+     * @param daemon Daemon to manage the streams.
+     * @param pattern Shell wildcard pattern for the names of the areas (e.g., "video*.i420").
+     * @param timeout Seconds without announcement after which a stream is removed.
+     */
+    StreamDiscovery(EncoderDaemon &daemon, const std::string &pattern, uint32_t timeout) noexcept;
+
+   public:
+    /**
+     * This method handles an announced area; new areas and areas with a
+     * changed geometry are (re-)configured, and failed areas are retried.
+     *
+     * @param senderStamp senderStamp of the announcement that is reused for the h264 frames.
+     */
+    void announce(const std::string &name, uint32_t size, uint32_t width, uint32_t height, uint32_t senderStamp) noexcept;
+
+    /**
+     * This method removes the streams without recent announcement.
+     */
+    void expire() noexcept;
+
+   private:
+    struct Area {
+        uint32_t width{0};
+        uint32_t height{0};
+        uint32_t senderStamp{0};
+        std::chrono::steady_clock::time_point lastSeen{};
+        bool encoding{false}; // The daemon accepted the area.
+        std::chrono::steady_clock::time_point retry{}; // Next attempt after a failed add or modify.
+    };
+
+    EncoderDaemon &m_daemon;
+    std::string m_pattern{};
+    std::chrono::seconds m_timeout{0};
+    std::mutex m_areasMutex{};
+    std::map<std::string, Area> m_areas{};
+};
+
+#endif
@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "stream-encoder.hpp"
+#include "openh264-backend.hpp"
+#ifdef HAVE_MJPEG
+    #include "mjpeg-backend.hpp"
+#endif
+#ifdef HAVE_X264
+    #include "x264-backend.hpp"
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+/**
+ * @return QP steps to add to make a frame of the given size fit the budget.
+ */
+uint32_t stepsToFit(uint32_t size, uint32_t budget) noexcept {
+    // The size of a frame roughly halves with every six QP steps.
+    return static_cast<uint32_t>(std::ceil(6.0 * std::log2(static_cast<double>(size) / static_cast<double>(budget))));
+}
+
+} // namespace
+
+StreamEncoder::StreamEncoder(uint32_t width, uint32_t height, std::map<std::string, std::string> arguments, bool verbose) noexcept
+    : m_backendName{(arguments["backend"].size() != 0) ? arguments["backend"] : "openh264"}
+    , m_width{width}
+    , m_height{height} {
+    try {
+        m_frameBudget = (arguments["frame-budget"].size() != 0) ? static_cast<uint32_t>(std::max(std::stoi(arguments["frame-budget"]), 0)) : 0;
+        m_frameBudgetRetries = (arguments["frame-budget-retries"].size() != 0) ? static_cast<uint32_t>(std::max(std::stoi(arguments["frame-budget-retries"]), 0)) : m_frameBudgetRetries;
+    }
+    catch (...) {
+        std::cerr << m_backendName << ": Invalid frame budget '" << arguments["frame-budget"] << "' or retries '" << arguments["frame-budget-retries"] << "'." << std::endl;
+        return;
+    }
+    if ("openh264" == m_backendName) {
+        m_backend.reset(new OpenH264Backend(m_width, m_height, arguments, verbose));
+    }
+#ifdef HAVE_X264
+    else if ("x264" == m_backendName) {
+        m_backend.reset(new X264Backend(m_width, m_height, arguments, verbose));
+    }
+#endif
+#ifdef HAVE_MJPEG
+    else if ("mjpeg" == m_backendName) {
+        m_backend.reset(new MjpegBackend(m_width, m_height, arguments));
+    }
+#endif
+    if (m_backend && !m_backend->valid()) {
+        m_backend.reset();
+    }
+    if (m_backend && (0 < m_frameBudget) && !m_backend->supportsCoarsening()) {
+        std::cerr << m_backendName << ": --frame-budget is not supported as frames cannot be encoded again with a higher QP." << std::endl;
+        m_backend.reset();
+    }
+}
+
+StreamEncoder::~StreamEncoder() {
+}
+
+bool StreamEncoder::valid() const noexcept {
+    return static_cast<bool>(m_backend);
+}
+
+const std::string &StreamEncoder::backend() const noexcept {
+    return m_backendName;
+}
+
+const char *StreamEncoder::fourcc() const noexcept {
+    return (m_backend ? m_backend->fourcc() : "");
+}
+
+uint32_t StreamEncoder::width() const noexcept {
+    return m_width;
+}
+
+uint32_t StreamEncoder::height() const noexcept {
+    return m_height;
+}
+
+int32_t StreamEncoder::targetBitrate() const noexcept {
+    return (m_backend ? m_backend->targetBitrate() : 0);
+}
+
+uint32_t StreamEncoder::frameBudget() const noexcept {
+    return m_frameBudget;
+}
+
+StreamEncoder::FrameBudgetStatistics StreamEncoder::frameBudgetStatistics() const noexcept {
+    return m_frameBudgetStatistics;
+}
+
+std::string StreamEncoder::configuration() const noexcept {
+    std::string configuration{m_backend ? m_backend->configuration() : ""};
+    if (!configuration.empty() && (0 < m_frameBudget)) {
+        configuration += ", frame budget " + std::to_string(m_frameBudget) + " bytes (" + std::to_string(m_frameBudgetRetries) + " re-encodings)";
+    }
+    return configuration;
+}
+
+void StreamEncoder::warmUp() noexcept {
+    if (!m_backend) {
+        return;
+    }
+    std::vector<uint8_t> gray(m_width * m_height * 3 / 2, 128);
+    const uint8_t *planes[3]{gray.data(), gray.data() + m_width * m_height, gray.data() + m_width * m_height + ((m_width * m_height) >> 2)};
+    const uint32_t strides[3]{m_width, m_width / 2, m_width / 2};
+    AccessUnit accessUnit;
+    m_backend->encode(planes, strides, accessUnit, 0);
+    forceIntraFrame();
+}
+
+void StreamEncoder::forceIntraFrame() noexcept {
+    if (m_backend) {
+        m_backend->forceIntraFrame();
+    }
+}
+
+void StreamEncoder::feedback(const ReferenceFeedback &feedback) noexcept {
+    if (m_backend) {
+        m_backend->feedback(feedback);
+    }
+}
+
+bool StreamEncoder::setScreenContent(bool screenContent) noexcept {
+    return (m_backend ? m_backend->setScreenContent(screenContent) : false);
+}
+
+bool StreamEncoder::encode(const uint8_t *planes[3], const uint32_t strides[3], AccessUnit &accessUnit, int64_t timeStamp) noexcept {
+    if (!m_backend) {
+        accessUnit = AccessUnit{};
+        return false;
+    }
+    if (!m_backend->encode(planes, strides, accessUnit, timeStamp)) {
+        return false;
+    }
+    if ((0 == m_frameBudget) || (videoFrameTypeSkip == accessUnit.frameType)) {
+        return true;
+    }
+    m_frameBudgetStatistics.frames++;
+    if (accessUnit.size <= m_frameBudget) {
+        return true;
+    }
+
+    // The frame is encoded again from the same input as IDR frame with a
+    // higher QP; the first attempt adds six steps as the rejected frame was
+    // likely a P frame.
+    m_frameBudgetStatistics.exceeded++;
+    const auto START{std::chrono::steady_clock::now()};
+    uint32_t steps{stepsToFit(accessUnit.size, m_frameBudget) + ((videoFrameTypeIDR == accessUnit.frameType) ? 0 : 6)};
+    uint32_t reencodings{0};
+    bool encoded{true};
+    bool fits{false};
+    bool coarsest{false};
+    while (!fits && (reencodings < m_frameBudgetRetries)) {
+        if (!m_backend->coarsenNextFrame(steps)) {
+            coarsest = (0 < reencodings);
+            break;
+        }
+        reencodings++;
+        encoded = m_backend->encode(planes, strides, accessUnit, timeStamp);
+        if (!encoded) {
+            break;
+        }
+        if (videoFrameTypeSkip == accessUnit.frameType) {
+            break;
+        }
+        fits = (accessUnit.size <= m_frameBudget);
+        steps = fits ? 0 : stepsToFit(accessUnit.size, m_frameBudget);
+    }
+    if (encoded && !fits) {
+        // The next frame must not refer to the skipped one.
+        accessUnit = AccessUnit{};
+        accessUnit.frameType = videoFrameTypeSkip;
+        m_backend->forceIntraFrame();
+        m_frameBudgetStatistics.skipped++;
+        // Every following frame would be skipped as IDR frame, too.
+        if (coarsest && !m_frameBudgetTooSmall) {
+            std::cerr << m_backendName << ": Warning, the frame budget of " << m_frameBudget << " bytes is below the size of an IDR frame at the coarsest quantization for "
+                      << m_width << "x" << m_height << "; increase --frame-budget." << std::endl;
+            m_frameBudgetTooSmall = true;
+        }
+    }
+    const uint64_t ADDED_TIME{static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - START).count())};
+    accessUnit.reencodings = reencodings;
+    accessUnit.reencodingTime = static_cast<uint32_t>(ADDED_TIME);
+    m_frameBudgetStatistics.reencodings += reencodings;
+    m_frameBudgetStatistics.addedTime += ADDED_TIME;
+    m_frameBudgetStatistics.maxAddedTime = std::max(m_frameBudgetStatistics.maxAddedTime, ADDED_TIME);
+    return encoded;
+}
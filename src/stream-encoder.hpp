@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STREAM_ENCODER_HPP
+#define STREAM_ENCODER_HPP
+
+#include "encoder-backend.hpp"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+/**
+ * Encoder for a stream of I420 frames with a fixed geometry that can be
+ * embedded into a producer to encode frames without shared memory.
+ * The encoder library is selected with --backend (default: openh264).
+ *
+ * With --frame-budget=<bytes>, a frame exceeding the budget is encoded again
+ * from the same input with a higher QP up to --frame-budget-retries times
+ * (default: 2); a frame that still exceeds it is skipped. Backends that
+ * cannot encode a frame again with a higher QP (x264) reject a frame budget.
+ */
+class StreamEncoder {
+   private:
+    StreamEncoder(const StreamEncoder &) = delete;
+    StreamEncoder(StreamEncoder &&)      = delete;
+    StreamEncoder &operator=(const StreamEncoder &) = delete;
+    StreamEncoder &operator=(StreamEncoder &&) = delete;
+
+   public:
+    /**
+     * Frames encoded with a frame budget.
+     */
+    struct FrameBudgetStatistics {
+        uint64_t frames{0};
+        uint64_t exceeded{0};    // Frames exceeding the budget at the first encoding.
+        uint64_t reencodings{0};
+        uint64_t skipped{0};     // Frames exceeding the budget after all re-encodings.
+        uint64_t addedTime{0};   // Microseconds spent on re-encodings.
+        uint64_t maxAddedTime{0};
+    };
+
+   public:
+    /**
+     * @param width Width of the frames to encode.
+     * @param height Height of the frames to encode.
+     * @param arguments Encoder arguments as accepted by the microservice (--backend, --gop, --bitrate, ...).
+     * @param verbose Enable the log output of the encoder library.
+     */
+    StreamEncoder(uint32_t width, uint32_t height, std::map<std::string, std::string> arguments, bool verbose = false) noexcept;
+    ~StreamEncoder();
+
+   public:
+    bool valid() const noexcept;
+    const std::string &backend() const noexcept;
+    const char *fourcc() const noexcept;
+    uint32_t width() const noexcept;
+    uint32_t height() const noexcept;
+    int32_t targetBitrate() const noexcept;
+
+    /**
+     * @return Maximum size of an encoded frame in bytes (0 without a budget).
+     */
+    uint32_t frameBudget() const noexcept;
+    FrameBudgetStatistics frameBudgetStatistics() const noexcept;
+
+    /**
+     * @return Effective encoder parameters in one line (empty if not applicable).
+     */
+    std::string configuration() const noexcept;
+
+    /**
+     * This method encodes a gray frame to move lazy allocations out of the
+     * first real frame; the next frame is encoded as IDR frame nevertheless.
+     */
+    void warmUp() noexcept;
+
+    /**
+     * This method requests the next frame to be encoded as IDR frame.
+     */
+    void forceIntraFrame() noexcept;
+
+    /**
+     * This method passes the feedback of a decoder to the encoder to recover
+     * from lost frames (with --long-term-ref=1 without an IDR frame).
+     *
+     * @param feedback Feedback of the decoder.
+     */
+    void feedback(const ReferenceFeedback &feedback) noexcept;
+
+    /**
+     * This method re-initializes the encoder for screen content or camera
+     * video if it is set up for the other type of content.
+     *
+     * @param screenContent The frames are screen content (e.g., simulator renders) instead of camera video.
+     * @return true if the encoder is set up for the given type of content.
+     */
+    bool setScreenContent(bool screenContent) noexcept;
+
+    /**
+     * @param planes Y, U, and V planes of the frame.
+     * @param strides Strides of the Y, U, and V planes.
+     * @param accessUnit Encoded frame; its size is 0 for skipped frames, including frames exceeding the frame budget.
+     * @param timeStamp Optional timestamp of the frame in milliseconds for the rate control.
+     * @return true if the frame was encoded or skipped without errors.
+     */
+    bool encode(const uint8_t *planes[3], const uint32_t strides[3], AccessUnit &accessUnit, int64_t timeStamp = 0) noexcept;
+
+   private:
+    std::unique_ptr<EncoderBackend> m_backend{};
+    std::string m_backendName{};
+    uint32_t m_width{0};
+    uint32_t m_height{0};
+    uint32_t m_frameBudget{0};
+    uint32_t m_frameBudgetRetries{2};
+    bool m_frameBudgetTooSmall{false};
+    FrameBudgetStatistics m_frameBudgetStatistics{};
+};
+
+#endif
@@ -0,0 +1,410 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "cluon-complete.hpp"
+#include "opendlv-standard-message-set.hpp"
+#include "synchronized-group.hpp"
+#include "shared-memory-attach.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <iostream>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+    #define HAVE_X86_SIMD
+#endif
+
+namespace {
+
+// Frames per member waiting for their partners; older ones are dropped.
+const size_t MAX_QUEUED_FRAMES{4};
+
+void copyRowScalar(uint8_t *dst, const uint8_t *src, uint32_t width) noexcept {
+    std::memcpy(dst, src, width);
+}
+
+#ifdef HAVE_X86_SIMD
+void copyRowSSE2(uint8_t *dst, const uint8_t *src, uint32_t width) noexcept {
+    uint32_t x{0};
+    for (; (x + 16) <= width; x += 16) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x)));
+    }
+    copyRowScalar(dst + x, src + x, width - x);
+}
+
+__attribute__((target("avx2")))
+void copyRowAVX2(uint8_t *dst, const uint8_t *src, uint32_t width) noexcept {
+    uint32_t x{0};
+    for (; (x + 64) <= width; x += 64) {
+        const __m256i a{_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x))};
+        const __m256i b{_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x + 32))};
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x), a);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x + 32), b);
+    }
+    for (; (x + 32) <= width; x += 32) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x)));
+    }
+    copyRowScalar(dst + x, src + x, width - x);
+}
+#endif
+
+using CopyRow = void (*)(uint8_t *, const uint8_t *, uint32_t);
+
+CopyRow selectCopyRow() noexcept {
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return copyRowAVX2;
+    }
+    return copyRowSSE2;
+#else
+    return copyRowScalar;
+#endif
+}
+
+/**
+ * Packs I420 frames of the same geometry side by side into one I420 frame
+ * that is frames.size() times as wide; the rows of every plane are
+ * interleaved, i.e., the packed frame is written sequentially.
+ */
+void packSideBySide(const std::vector<const uint8_t*> &frames, uint32_t width, uint32_t height, uint8_t *packed) noexcept {
+    static const CopyRow COPY_ROW{selectCopyRow()};
+    const uint32_t PLANE_OFFSETS[3]{0, width * height, width * height + ((width * height) >> 2)};
+    const uint32_t PLANE_WIDTHS[3]{width, width / 2, width / 2};
+    const uint32_t PLANE_HEIGHTS[3]{height, height / 2, height / 2};
+    const uint32_t MEMBERS{static_cast<uint32_t>(frames.size())};
+    for (uint32_t plane{0}; plane < 3; plane++) {
+        uint8_t *dst{packed + MEMBERS * PLANE_OFFSETS[plane]};
+        for (uint32_t y{0}; y < PLANE_HEIGHTS[plane]; y++) {
+            for (auto frame : frames) {
+                COPY_ROW(dst, frame + PLANE_OFFSETS[plane] + y * PLANE_WIDTHS[plane], PLANE_WIDTHS[plane]);
+                dst += PLANE_WIDTHS[plane];
+            }
+        }
+    }
+}
+
+}
+
+SynchronizedGroup::SynchronizedGroup(const std::vector<std::string> &names, uint32_t width, uint32_t height, uint32_t senderStamp,
+                                     std::vector<std::unique_ptr<StreamEncoder>> encoders, int64_t tolerance, std::shared_ptr<cluon::OD4Session> od4, bool verbose) noexcept
+    : m_width{width}
+    , m_height{height}
+    , m_senderStamp{senderStamp}
+    , m_encoders{std::move(encoders)}
+    , m_tolerance{tolerance}
+    , m_od4{od4}
+    , m_verbose{verbose}
+    , m_sideBySide{(1 < names.size()) && (1 == m_encoders.size())} {
+    for (auto &name : names) {
+        std::unique_ptr<Member> member{new Member()};
+        member->name = name;
+        m_members.push_back(std::move(member));
+    }
+    if (m_sideBySide) {
+        m_packed.resize(names.size() * width * height * 3 / 2);
+    }
+}
+
+SynchronizedGroup::~SynchronizedGroup() {
+    m_stop = true;
+    stopWorkers();
+    for (auto &member : m_members) {
+        if (member->capture.joinable()) {
+            member->capture.join();
+        }
+    }
+}
+
+bool SynchronizedGroup::valid() const noexcept {
+    const uint32_t EXPECTED_WIDTH{m_sideBySide ? static_cast<uint32_t>(m_members.size()) * m_width : m_width};
+    bool valid{(m_members.size() >= 2) && (m_sideBySide || (m_encoders.size() == m_members.size()))};
+    for (auto &encoder : m_encoders) {
+        valid = valid && encoder && encoder->valid() && (encoder->width() == EXPECTED_WIDTH) && (encoder->height() == m_height);
+    }
+    return valid;
+}
+
+bool SynchronizedGroup::run(uint32_t timeout) noexcept {
+    if (!valid() || !m_od4) {
+        return false;
+    }
+    for (auto &member : m_members) {
+        member->sharedMemory = attachSharedMemory(member->name, timeout, &m_stop);
+        if (!member->sharedMemory || !member->sharedMemory->valid()) {
+            return false;
+        }
+        std::clog << member->name << ": Attached (" << member->sharedMemory->size() << " bytes)." << std::endl;
+    }
+    if (m_sideBySide) {
+        std::clog << "Encoding " << m_members.size() << " frames side by side as " << m_members.size() * m_width << "x" << m_height
+                  << " with " << m_encoders[0]->backend() << " as senderStamp " << m_senderStamp << "." << std::endl;
+    }
+    if (!m_sideBySide) {
+        startWorkers();
+    }
+    for (auto &member : m_members) {
+        Member *m{member.get()};
+        member->capture = std::thread([this, m]() { capture(*m); });
+    }
+
+    std::vector<Frame> group;
+    while (!m_stop.load() && m_od4->isRunning()) {
+        {
+            // Wake up regularly to notice a stopped OD4Session.
+            std::unique_lock<std::mutex> lck(m_framesMutex);
+            if (!m_framesCondition.wait_for(lck, std::chrono::milliseconds(100), [this, &group]() { return m_stop.load() || nextGroup(group); })
+                || group.empty()) {
+                continue;
+            }
+        }
+        encode(group);
+        {
+            std::lock_guard<std::mutex> lck(m_framesMutex);
+            for (size_t i{0}; i < group.size(); i++) {
+                m_members[i]->spare.push_back(std::move(group[i].data));
+            }
+        }
+        group.clear();
+    }
+
+    // The producers might have stopped; hence, the capturing threads are
+    // woken up until they noticed the request.
+    m_stop = true;
+    stopWorkers();
+    for (auto &member : m_members) {
+        auto joiner = std::async(std::launch::async, [&member]() { member->capture.join(); });
+        while (std::future_status::ready != joiner.wait_for(std::chrono::milliseconds(20))) {
+            member->sharedMemory->notifyAll();
+        }
+    }
+    return true;
+}
+
+void SynchronizedGroup::capture(Member &member) noexcept {
+    const size_t SIZE{static_cast<size_t>(m_width) * m_height * 3 / 2};
+    cluon::SharedMemory *sharedMemory{member.sharedMemory.get()};
+    int64_t lastSampleTime{0};
+    while (!m_stop.load() && sharedMemory->valid()) {
+        sharedMemory->wait();
+        if (m_stop.load()) {
+            break;
+        }
+
+        Frame frame;
+        {
+            std::lock_guard<std::mutex> lck(m_framesMutex);
+            if (!member.spare.empty()) {
+                frame.data = std::move(member.spare.back());
+                member.spare.pop_back();
+            }
+        }
+        frame.data.resize(SIZE);
+
+        sharedMemory->lock();
+        auto r = sharedMemory->getTimeStamp();
+        frame.sampleTime = cluon::time::toMicroseconds(r.first ? r.second : cluon::time::now());
+        // Spurious wake-up without a new frame.
+        const bool NEW_FRAME{!r.first || (frame.sampleTime != lastSampleTime)};
+        if (NEW_FRAME) {
+            std::memcpy(frame.data.data(), sharedMemory->data(), std::min(SIZE, static_cast<size_t>(sharedMemory->size())));
+        }
+        sharedMemory->unlock();
+        lastSampleTime = frame.sampleTime;
+
+        {
+            std::lock_guard<std::mutex> lck(m_framesMutex);
+            if (!NEW_FRAME) {
+                member.spare.push_back(std::move(frame.data));
+                continue;
+            }
+            if (MAX_QUEUED_FRAMES <= member.frames.size()) {
+                member.spare.push_back(std::move(member.frames.front().data));
+                member.frames.pop_front();
+                m_droppedFrames++;
+            }
+            member.frames.push_back(std::move(frame));
+        }
+        m_framesCondition.notify_all();
+    }
+    if (!sharedMemory->valid()) {
+        std::cerr << member.name << ": Shared memory area vanished." << std::endl;
+    }
+    // A group is incomplete without this member.
+    m_stop = true;
+    m_framesCondition.notify_all();
+}
+
+bool SynchronizedGroup::nextGroup(std::vector<Frame> &group) noexcept {
+    while (true) {
+        // The member with the newest oldest frame determines the group.
+        int64_t newest{std::numeric_limits<int64_t>::min()};
+        for (auto &member : m_members) {
+            if (member->frames.empty()) {
+                return false;
+            }
+            newest = std::max(newest, member->frames.front().sampleTime);
+        }
+        // Frames that are too old or have a successor closer to the group are
+        // dropped as the frames of every member arrive in order; the group is
+        // determined anew after dropping frames.
+        bool complete{true};
+        for (auto &member : m_members) {
+            std::deque<Frame> &frames{member->frames};
+            if ((frames.front().sampleTime < (newest - m_tolerance))
+                || ((1 < frames.size()) && (std::abs(frames[1].sampleTime - newest) <= std::abs(frames[0].sampleTime - newest)))) {
+                member->spare.push_back(std::move(frames.front().data));
+                frames.pop_front();
+                m_droppedFrames++;
+                complete = false;
+            }
+        }
+        if (complete) {
+            for (auto &member : m_members) {
+                group.push_back(std::move(member->frames.front()));
+                member->frames.pop_front();
+            }
+            return true;
+        }
+    }
+}
+
+void SynchronizedGroup::startWorkers() noexcept {
+    uint64_t first{0};
+    {
+        std::lock_guard<std::mutex> lck(m_workersMutex);
+        m_workersStop = false;
+        m_workersPending = 0;
+        first = m_workersGeneration;
+    }
+    for (size_t i{0}; i < m_members.size(); i++) {
+        m_members[i]->worker = std::thread([this, i, first]() {
+            uint64_t generation{first};
+            while (true) {
+                const std::vector<Frame> *group{nullptr};
+                {
+                    std::unique_lock<std::mutex> lck(m_workersMutex);
+                    m_workersStart.wait(lck, [this, &generation]() { return m_workersStop || (generation != m_workersGeneration); });
+                    if (m_workersStop) {
+                        break;
+                    }
+                    generation = m_workersGeneration;
+                    group = m_workersGroup;
+                }
+                encodeMember(i, (*group)[i]);
+                std::lock_guard<std::mutex> lck(m_workersMutex);
+                if (0 == --m_workersPending) {
+                    m_workersDone.notify_all();
+                }
+            }
+        });
+    }
+}
+
+void SynchronizedGroup::stopWorkers() noexcept {
+    {
+        std::lock_guard<std::mutex> lck(m_workersMutex);
+        m_workersStop = true;
+    }
+    m_workersStart.notify_all();
+    for (auto &member : m_members) {
+        if (member->worker.joinable()) {
+            member->worker.join();
+        }
+    }
+}
+
+void SynchronizedGroup::encodeMember(size_t index, const Frame &frame) noexcept {
+    const uint8_t *data{frame.data.data()};
+    const uint8_t *planes[3]{data, data + (m_width * m_height), data + (m_width * m_height + ((m_width * m_height) >> 2))};
+    const uint32_t strides[3]{m_width, m_width / 2, m_width / 2};
+    Member &member{*m_members[index]};
+    member.accessUnit = AccessUnit{};
+    if (!m_encoders[index]->encode(planes, strides, member.accessUnit)) {
+        std::cerr << member.name << ": Failed to encode frame." << std::endl;
+    }
+}
+
+void SynchronizedGroup::encode(std::vector<Frame> &group) noexcept {
+    const cluon::data::TimeStamp SAMPLE_TIME_STAMP{cluon::time::fromMicroseconds(group[0].sampleTime)};
+    cluon::data::TimeStamp before{cluon::time::now()};
+    if (m_sideBySide) {
+        std::vector<const uint8_t*> frames;
+        for (auto &frame : group) {
+            frames.push_back(frame.data.data());
+        }
+        packSideBySide(frames, m_width, m_height, m_packed.data());
+
+        const uint32_t WIDTH{static_cast<uint32_t>(frames.size()) * m_width};
+        uint8_t *packed{m_packed.data()};
+        const uint8_t *planes[3]{packed, packed + (WIDTH * m_height), packed + (WIDTH * m_height + ((WIDTH * m_height) >> 2))};
+        const uint32_t strides[3]{WIDTH, WIDTH / 2, WIDTH / 2};
+        AccessUnit accessUnit;
+        if (!m_encoders[0]->encode(planes, strides, accessUnit)) {
+            std::cerr << "Failed to encode frames side by side." << std::endl;
+        }
+        publish(accessUnit, SAMPLE_TIME_STAMP, m_senderStamp, WIDTH, m_encoders[0]->fourcc());
+    }
+    else {
+        // The members are encoded in parallel by their workers and published together.
+        {
+            std::lock_guard<std::mutex> lck(m_workersMutex);
+            m_workersGroup = &group;
+            m_workersPending = static_cast<uint32_t>(group.size());
+            m_workersGeneration++;
+        }
+        m_workersStart.notify_all();
+        {
+            std::unique_lock<std::mutex> lck(m_workersMutex);
+            m_workersDone.wait(lck, [this]() { return 0 == m_workersPending; });
+            m_workersGroup = nullptr;
+        }
+        for (size_t i{0}; i < group.size(); i++) {
+            publish(m_members[i]->accessUnit, SAMPLE_TIME_STAMP, m_senderStamp + static_cast<uint32_t>(i), m_width, m_encoders[i]->fourcc());
+        }
+    }
+    m_groups++;
+
+    if (m_verbose) {
+        auto range = std::minmax_element(group.begin(), group.end(), [](const Frame &a, const Frame &b) { return a.sampleTime < b.sampleTime; });
+        const int64_t SPREAD{range.second->sampleTime - range.first->sampleTime};
+        std::clog << "Group " << m_groups.load() << ": sample time = " << group[0].sampleTime << " microseconds; spread = " << SPREAD
+                  << " microseconds; encoding took " << cluon::time::deltaInMicroseconds(cluon::time::now(), before) << " microseconds." << std::endl;
+    }
+}
+
+void SynchronizedGroup::publish(const AccessUnit &accessUnit, const cluon::data::TimeStamp &sampleTimeStamp, uint32_t senderStamp, uint32_t width, const char *fourcc) noexcept {
+    if (0 < accessUnit.size) {
+        opendlv::proxy::ImageReading ir;
+        ir.fourcc(fourcc).width(width).height(m_height).data(std::string(accessUnit.data, accessUnit.size));
+        m_od4->send(ir, sampleTimeStamp, senderStamp);
+    }
+}
+
+uint64_t SynchronizedGroup::groups() const noexcept {
+    return m_groups.load();
+}
+
+uint64_t SynchronizedGroup::droppedFrames() const noexcept {
+    return m_droppedFrames.load();
+}
@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYNCHRONIZED_GROUP_HPP
+#define SYNCHRONIZED_GROUP_HPP
+
+#include "cluon-complete.hpp"
+#include "stream-encoder.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Several shared memory areas holding I420 frames of the same geometry, e.g.,
+ * from a stereo camera, that are encoded together: the frames of all members
+ * are paired by their nearest sample timestamp, and each complete group is
+ * encoded and published with the sample timestamp of the first member.
+ *
+ * With one encoder per member, member i is published with senderStamp + i;
+ * with a single encoder for all members, their frames are packed side by side
+ * into one frame that is published with senderStamp.
+ */
+class SynchronizedGroup {
+   private:
+    SynchronizedGroup(const SynchronizedGroup &) = delete;
+    SynchronizedGroup(SynchronizedGroup &&)      = delete;
+    SynchronizedGroup &operator=(const SynchronizedGroup &) = delete;
+    SynchronizedGroup &operator=(SynchronizedGroup &&) = delete;
+
+   public:
+    /**
+     * @param names Names of the shared memory areas.
+     * @param width Width of the frames of every member.
+     * @param height Height of the frames of every member.
+     * @param senderStamp senderStamp of the first member.
+     * @param encoders One encoder per member or one encoder for the members packed side by side.
+     * @param tolerance Maximum difference of the sample timestamps within a group in microseconds.
+     * @param od4 OD4Session to publish the frames to.
+     * @param verbose Print information about every group.
+     */
+    SynchronizedGroup(const std::vector<std::string> &names, uint32_t width, uint32_t height, uint32_t senderStamp,
+                      std::vector<std::unique_ptr<StreamEncoder>> encoders, int64_t tolerance, std::shared_ptr<cluon::OD4Session> od4, bool verbose) noexcept;
+    ~SynchronizedGroup();
+
+   public:
+    /**
+     * @return true if there are at least two members and the encoders match them.
+     */
+    bool valid() const noexcept;
+
+    /**
+     * This method attaches to all shared memory areas and encodes their
+     * groups of frames until the areas or the OD4Session vanish.
+     *
+     * @param timeout Seconds to wait for each shared memory area to appear (0: no limit).
+     * @return true if all shared memory areas were attached.
+     */
+    bool run(uint32_t timeout) noexcept;
+
+    uint64_t groups() const noexcept;
+    uint64_t droppedFrames() const noexcept;
+
+   private:
+    struct Frame {
+        int64_t sampleTime{0};
+        std::vector<uint8_t> data{};
+    };
+
+    struct Member {
+        std::string name{};
+        std::unique_ptr<cluon::SharedMemory> sharedMemory{};
+        std::deque<Frame> frames{};
+        std::vector<std::vector<uint8_t>> spare{};
+        std::thread capture{};
+        AccessUnit accessUnit{};
+        std::thread worker{};
+    };
+
+    void capture(Member &member) noexcept;
+    bool nextGroup(std::vector<Frame> &group) noexcept;
+    void startWorkers() noexcept;
+    void stopWorkers() noexcept;
+    void encodeMember(size_t index, const Frame &frame) noexcept;
+    void encode(std::vector<Frame> &group) noexcept;
+    void publish(const AccessUnit &accessUnit, const cluon::data::TimeStamp &sampleTimeStamp, uint32_t senderStamp, uint32_t width, const char *fourcc) noexcept;
+
+   private:
+    uint32_t m_width{0};
+    uint32_t m_height{0};
+    uint32_t m_senderStamp{0};
+    std::vector<std::unique_ptr<StreamEncoder>> m_encoders{};
+    int64_t m_tolerance{0};
+    std::shared_ptr<cluon::OD4Session> m_od4{};
+    bool m_verbose{false};
+    bool m_sideBySide{false};
+    std::vector<uint8_t> m_packed{};
+
+    std::mutex m_framesMutex{};
+    std::condition_variable m_framesCondition{};
+    std::vector<std::unique_ptr<Member>> m_members{};
+
+    std::mutex m_workersMutex{};
+    std::condition_variable m_workersStart{};
+    std::condition_variable m_workersDone{};
+    const std::vector<Frame> *m_workersGroup{nullptr};
+    uint64_t m_workersGeneration{0};
+    uint32_t m_workersPending{0};
+    bool m_workersStop{false};
+
+    std::atomic<bool> m_stop{false};
+    std::atomic<uint64_t> m_groups{0};
+    std::atomic<uint64_t> m_droppedFrames{0};
+};
+
+#endif
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "temporal-denoiser.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+    #define HAVE_X86_SIMD
+#endif
+
+namespace {
+
+// The averages round up like pavgb so that all implementations match.
+inline uint8_t average(uint8_t a, uint8_t b) noexcept {
+    return static_cast<uint8_t>((static_cast<uint32_t>(a) + b + 1) >> 1);
+}
+
+void denoiseRowScalar(uint8_t *output, const uint8_t *input, uint32_t width, uint8_t threshold) noexcept {
+    const uint8_t HALF{static_cast<uint8_t>(threshold >> 1)};
+    for (uint32_t x{0}; x < width; x++) {
+        const uint8_t p{output[x]};
+        const uint8_t c{input[x]};
+        const uint8_t d{static_cast<uint8_t>(p > c ? p - c : c - p)};
+        if (d <= HALF) {
+            output[x] = average(p, average(p, c));
+        }
+        else if (d <= threshold) {
+            output[x] = average(p, c);
+        }
+        else {
+            output[x] = c;
+        }
+    }
+}
+
+#ifdef HAVE_X86_SIMD
+void denoiseRowSSE2(uint8_t *output, const uint8_t *input, uint32_t width, uint8_t threshold) noexcept {
+    const __m128i ZERO{_mm_setzero_si128()};
+    const __m128i T{_mm_set1_epi8(static_cast<char>(threshold))};
+    const __m128i HALF{_mm_set1_epi8(static_cast<char>(threshold >> 1))};
+    uint32_t x{0};
+    for (; (x + 16) <= width; x += 16) {
+        const __m128i p{_mm_loadu_si128(reinterpret_cast<const __m128i*>(output + x))};
+        const __m128i c{_mm_loadu_si128(reinterpret_cast<const __m128i*>(input + x))};
+        const __m128i d{_mm_or_si128(_mm_subs_epu8(p, c), _mm_subs_epu8(c, p))};
+        const __m128i a1{_mm_avg_epu8(p, c)};
+        const __m128i a2{_mm_avg_epu8(p, a1)};
+        const __m128i still{_mm_cmpeq_epi8(_mm_subs_epu8(d, HALF), ZERO)};
+        const __m128i calm{_mm_cmpeq_epi8(_mm_subs_epu8(d, T), ZERO)};
+        __m128i o{_mm_or_si128(_mm_and_si128(calm, a1), _mm_andnot_si128(calm, c))};
+        o = _mm_or_si128(_mm_and_si128(still, a2), _mm_andnot_si128(still, o));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + x), o);
+    }
+    denoiseRowScalar(output + x, input + x, width - x, threshold);
+}
+
+__attribute__((target("avx2")))
+void denoiseRowAVX2(uint8_t *output, const uint8_t *input, uint32_t width, uint8_t threshold) noexcept {
+    const __m256i ZERO{_mm256_setzero_si256()};
+    const __m256i T{_mm256_set1_epi8(static_cast<char>(threshold))};
+    const __m256i HALF{_mm256_set1_epi8(static_cast<char>(threshold >> 1))};
+    uint32_t x{0};
+    for (; (x + 32) <= width; x += 32) {
+        const __m256i p{_mm256_loadu_si256(reinterpret_cast<const __m256i*>(output + x))};
+        const __m256i c{_mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + x))};
+        const __m256i d{_mm256_or_si256(_mm256_subs_epu8(p, c), _mm256_subs_epu8(c, p))};
+        const __m256i a1{_mm256_avg_epu8(p, c)};
+        const __m256i a2{_mm256_avg_epu8(p, a1)};
+        const __m256i still{_mm256_cmpeq_epi8(_mm256_subs_epu8(d, HALF), ZERO)};
+        const __m256i calm{_mm256_cmpeq_epi8(_mm256_subs_epu8(d, T), ZERO)};
+        const __m256i o{_mm256_blendv_epi8(_mm256_blendv_epi8(c, a1, calm), a2, still)};
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + x), o);
+    }
+    denoiseRowScalar(output + x, input + x, width - x, threshold);
+}
+#endif
+
+using DenoiseRow = void (*)(uint8_t *, const uint8_t *, uint32_t, uint8_t);
+
+struct Implementation {
+    DenoiseRow denoiseRow{nullptr};
+    const char *name{nullptr};
+};
+
+Implementation selectImplementation() noexcept {
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return Implementation{denoiseRowAVX2, "avx2"};
+    }
+    return Implementation{denoiseRowSSE2, "sse2"};
+#else
+    return Implementation{denoiseRowScalar, "scalar"};
+#endif
+}
+
+const Implementation &selectedImplementation() noexcept {
+    static const Implementation IMPLEMENTATION{selectImplementation()};
+    return IMPLEMENTATION;
+}
+
+} // namespace
+
+TemporalDenoiser::TemporalDenoiser(uint32_t width, uint32_t height, uint32_t threshold) noexcept
+    : m_width{width}
+    , m_height{height}
+    , m_threshold{static_cast<uint8_t>(std::min(std::max(threshold, 1u), 255u))}
+    , m_output(width * height * 3 / 2) {
+}
+
+const uint8_t *TemporalDenoiser::filter(const uint8_t *planes[3], const uint32_t strides[3]) noexcept {
+    const DenoiseRow DENOISE_ROW{selectedImplementation().denoiseRow};
+    const uint32_t WIDTHS[3]{m_width, m_width / 2, m_width / 2};
+    const uint32_t HEIGHTS[3]{m_height, m_height / 2, m_height / 2};
+    uint8_t *output{m_output.data()};
+    for (uint32_t plane{0}; plane < 3; plane++) {
+        for (uint32_t y{0}; y < HEIGHTS[plane]; y++) {
+            const uint8_t *input{planes[plane] + y * strides[plane]};
+            if (m_first) {
+                std::memcpy(output, input, WIDTHS[plane]);
+            }
+            else {
+                DENOISE_ROW(output, input, WIDTHS[plane], m_threshold);
+            }
+            output += WIDTHS[plane];
+        }
+    }
+    m_first = false;
+    return m_output.data();
+}
+
+void TemporalDenoiser::reset() noexcept {
+    m_first = true;
+}
+
+const char *TemporalDenoiser::implementation() const noexcept {
+    return selectedImplementation().name;
+}
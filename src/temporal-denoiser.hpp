@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef TEMPORAL_DENOISER_HPP
+#define TEMPORAL_DENOISER_HPP
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Motion-adaptive temporal denoiser for I420 frames: every sample is blended
+ * with the previous output (3:1 for differences up to half the threshold,
+ * 1:1 up to the threshold); larger differences are considered motion and
+ * the sample is kept. The filter runs on AVX2 or SSE2 if available.
+ */
+class TemporalDenoiser {
+   private:
+    TemporalDenoiser(const TemporalDenoiser &) = delete;
+    TemporalDenoiser(TemporalDenoiser &&)      = delete;
+    TemporalDenoiser &operator=(const TemporalDenoiser &) = delete;
+    TemporalDenoiser &operator=(TemporalDenoiser &&) = delete;
+
+   public:
+    /**
+     * @param width Width of the frames.
+     * @param height Height of the frames.
+     * @param threshold Largest difference to the previous output that is considered noise (1-255).
+     */
+    TemporalDenoiser(uint32_t width, uint32_t height, uint32_t threshold) noexcept;
+
+   public:
+    /**
+     * This method filters a frame against the previous output.
+     *
+     * @param planes Y, U, and V planes of the frame, e.g., in the shared memory area.
+     * @param strides Strides of the Y, U, and V planes.
+     * @return Filtered I420 frame of width * height * 3 / 2 bytes; valid until the next call.
+     */
+    const uint8_t *filter(const uint8_t *planes[3], const uint32_t strides[3]) noexcept;
+
+    /**
+     * This method lets the next frame pass unfiltered, e.g., after a scene cut.
+     */
+    void reset() noexcept;
+
+    /**
+     * @return Name of the used instruction set (avx2, sse2, or scalar).
+     */
+    const char *implementation() const noexcept;
+
+   private:
+    uint32_t m_width{0};
+    uint32_t m_height{0};
+    uint8_t m_threshold{0};
+    bool m_first{true};
+    std::vector<uint8_t> m_output{};
+};
+
+#endif
@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "encoder-parameters.hpp"
+#include "x264-backend.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+
+X264Backend::X264Backend(uint32_t width, uint32_t height, std::map<std::string, std::string> &arguments, bool verbose) noexcept
+    : m_width{width}
+    , m_height{height} {
+    // Same defaults and limits as for openh264 so that both backends can be
+    // compared with the same arguments.
+    const uint32_t GOP_DEFAULT{10};
+    const float FPS_DEFAULT{20.0f};
+    const uint32_t BITRATE_MIN{100000};
+    const uint32_t BITRATE_DEFAULT{1500000};
+    const uint32_t QP_MIN{0};
+    const uint32_t QP_MAX{51};
+
+    x264_param_t parameters;
+    try {
+        const uint32_t GOP{(arguments["gop"].size() != 0) ? static_cast<uint32_t>(std::stoi(arguments["gop"])) : GOP_DEFAULT};
+        const float FPS{(arguments["fps"].size() != 0) ? std::max(std::stof(arguments["fps"]), 1.0f) : FPS_DEFAULT};
+        const uint32_t REQUESTED_BITRATE{(arguments["bitrate"].size() != 0) ? std::max(static_cast<uint32_t>(std::stoi(arguments["bitrate"])), BITRATE_MIN) : BITRATE_DEFAULT};
+        const uint32_t REQUESTED_BITRATE_MAX{(arguments["bitrate-max"].size() != 0) ? std::max(static_cast<uint32_t>(std::stoi(arguments["bitrate-max"])), BITRATE_MIN) : 0};
+        const uint32_t I_MAX_QP{(arguments["qp-max"].size() != 0) ? std::min(std::max(static_cast<uint32_t>(std::stoi(arguments["qp-max"])), QP_MIN), QP_MAX) : 42};
+        const uint32_t I_MIN_QP{(arguments["qp-min"].size() != 0) ? std::min(std::max(static_cast<uint32_t>(std::stoi(arguments["qp-min"])), QP_MIN), QP_MAX) : 12};
+        // 0: one thread per core; x264 slices the frame with zerolatency.
+        const uint32_t THREADS{(arguments["threads"].size() != 0) ? static_cast<uint32_t>(std::stoi(arguments["threads"])) : 0};
+        const std::string PRESET{(arguments["x264-preset"].size() != 0) ? arguments["x264-preset"] : "veryfast"};
+        // Constrained baseline keeps the stream decodable by openh264.
+        const std::string PROFILE{(arguments["x264-profile"].size() != 0) ? arguments["x264-profile"] : "baseline"};
+        // The high profiles for more than 8 bits or 4:2:0 allow even higher bitrates.
+        EncoderLimits limits;
+        if (!deriveEncoderLimits(m_width, m_height, FPS, std::max(REQUESTED_BITRATE, REQUESTED_BITRATE_MAX), arguments["level"], (0 == PROFILE.compare(0, 4, "high")) ? "high" : PROFILE, limits)) {
+            std::cerr << "x264: Invalid encoder arguments, no H.264 level " << arguments["level"] << " of the " << PROFILE << " profile allows " << m_width << "x" << m_height << " at " << FPS << " fps." << std::endl;
+            return;
+        }
+        const uint32_t BITRATE{std::min(REQUESTED_BITRATE, limits.maxBitrate)};
+        const uint32_t I_BITRATE_MAX{(0 != REQUESTED_BITRATE_MAX) ? std::min(REQUESTED_BITRATE_MAX, limits.maxBitrate) : limits.maxBitrate};
+        if ((I_MIN_QP > I_MAX_QP) || (BITRATE > I_BITRATE_MAX)) {
+            std::cerr << "x264: Invalid encoder arguments, the QP range " << I_MIN_QP << "-" << I_MAX_QP << " or the bitrate " << BITRATE << " above the maximum bitrate " << I_BITRATE_MAX << "." << std::endl;
+            return;
+        }
+
+        if (0 != x264_param_default_preset(&parameters, PRESET.c_str(), "zerolatency")) {
+            return;
+        }
+        parameters.i_log_level = verbose ? X264_LOG_INFO : X264_LOG_NONE;
+        parameters.i_width = static_cast<int>(m_width);
+        parameters.i_height = static_cast<int>(m_height);
+        parameters.i_csp = X264_CSP_I420;
+        parameters.i_threads = static_cast<int>(THREADS);
+        // Same assumption as for openh264; the frames are triggered by the shared memory.
+        parameters.i_fps_num = static_cast<int>(std::lround(FPS * 1000.0f));
+        parameters.i_fps_den = 1000;
+        parameters.i_level_idc = static_cast<int>(limits.levelIdc);
+        parameters.i_frame_reference = std::min(parameters.i_frame_reference, static_cast<int>(limits.maxReferenceFrames));
+        parameters.b_vfr_input = 0;
+        parameters.i_keyint_max = static_cast<int>(GOP);
+        parameters.i_keyint_min = static_cast<int>(GOP);
+        parameters.b_repeat_headers = 1;
+        parameters.b_annexb = 1;
+        parameters.rc.i_rc_method = X264_RC_ABR;
+        parameters.rc.i_bitrate = static_cast<int>(BITRATE / 1000);
+        parameters.rc.i_vbv_max_bitrate = static_cast<int>(I_BITRATE_MAX / 1000);
+        parameters.rc.i_vbv_buffer_size = static_cast<int>(std::min(I_BITRATE_MAX, limits.maxFrameSize * 8) / 1000);
+        parameters.rc.i_qp_min = static_cast<int>(I_MIN_QP);
+        parameters.rc.i_qp_max = static_cast<int>(I_MAX_QP);
+        if (0 != x264_param_apply_profile(&parameters, PROFILE.c_str())) {
+            return;
+        }
+        m_targetBitrate = static_cast<int32_t>(BITRATE);
+
+        std::stringstream sstr;
+        sstr << m_width << "x" << m_height << " at " << FPS << " fps, " << PROFILE << " profile, level_idc " << limits.levelIdc
+             << ", bitrate " << BITRATE << " (max " << I_BITRATE_MAX << "), QP " << I_MIN_QP << "-" << I_MAX_QP << ", " << parameters.i_frame_reference << " reference frame(s), GOP " << GOP << ", preset " << PRESET;
+        m_configuration = sstr.str();
+    }
+    catch (...) {
+        return;
+    }
+    m_encoder = x264_encoder_open(&parameters);
+}
+
+X264Backend::~X264Backend() {
+    if (nullptr != m_encoder) {
+        x264_encoder_close(m_encoder);
+    }
+}
+
+bool X264Backend::valid() const noexcept {
+    return (nullptr != m_encoder);
+}
+
+const char *X264Backend::fourcc() const noexcept {
+    return "h264";
+}
+
+std::string X264Backend::configuration() const noexcept {
+    return m_configuration;
+}
+
+int32_t X264Backend::targetBitrate() const noexcept {
+    return m_targetBitrate;
+}
+
+void X264Backend::forceIntraFrame() noexcept {
+    m_forceIntraFrame = true;
+}
+
+bool X264Backend::encode(const uint8_t *planes[3], const uint32_t strides[3], AccessUnit &accessUnit, int64_t /*timeStamp*/) noexcept {
+    accessUnit = AccessUnit{};
+    if (nullptr == m_encoder) {
+        return false;
+    }
+
+    x264_picture_t pictureIn;
+    x264_picture_t pictureOut;
+    x264_picture_init(&pictureIn);
+    pictureIn.img.i_csp = X264_CSP_I420;
+    pictureIn.img.i_plane = 3;
+    for (uint8_t plane{0}; plane < 3; plane++) {
+        pictureIn.img.i_stride[plane] = static_cast<int>(strides[plane]);
+        pictureIn.img.plane[plane] = const_cast<uint8_t*>(planes[plane]);
+    }
+    // x264 requires strictly increasing pts for its rate control.
+    pictureIn.i_pts = m_frameCounter++;
+    pictureIn.i_type = m_forceIntraFrame ? X264_TYPE_IDR : X264_TYPE_AUTO;
+    m_forceIntraFrame = false;
+
+    x264_nal_t *nals{nullptr};
+    int numberOfNals{0};
+    const int size{x264_encoder_encode(m_encoder, &nals, &numberOfNals, &pictureIn, &pictureOut)};
+    if (0 > size) {
+        return false;
+    }
+    if ((0 == size) || (0 == numberOfNals)) {
+        accessUnit.frameType = videoFrameTypeSkip;
+        return true;
+    }
+    // The payloads of all NAL units of one frame are sequential in memory.
+    accessUnit.data = reinterpret_cast<const char*>(nals[0].p_payload);
+    accessUnit.size = static_cast<uint32_t>(size);
+    accessUnit.frameType = (pictureOut.b_keyframe ? videoFrameTypeIDR : videoFrameTypeP);
+    return true;
+}
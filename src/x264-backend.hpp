@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef X264_BACKEND_HPP
+#define X264_BACKEND_HPP
+
+#include "encoder-backend.hpp"
+
+#include <cstdint>
+extern "C" {
+#include <x264.h>
+}
+
+#include <map>
+#include <string>
+
+/**
+ * Encoder backend using x264 with tune=zerolatency, i.e., without B-frames,
+ * lookahead, or frame threading so that every frame is returned immediately.
+ */
+class X264Backend : public EncoderBackend {
+   private:
+    X264Backend(const X264Backend &) = delete;
+    X264Backend(X264Backend &&)      = delete;
+    X264Backend &operator=(const X264Backend &) = delete;
+    X264Backend &operator=(X264Backend &&) = delete;
+
+   public:
+    X264Backend(uint32_t width, uint32_t height, std::map<std::string, std::string> &arguments, bool verbose) noexcept;
+    ~X264Backend() override;
+
+   public:
+    bool valid() const noexcept override;
+    const char *fourcc() const noexcept override;
+    int32_t targetBitrate() const noexcept override;
+    std::string configuration() const noexcept override;
+    void forceIntraFrame() noexcept override;
+    bool encode(const uint8_t *planes[3], const uint32_t strides[3], AccessUnit &accessUnit, int64_t timeStamp) noexcept override;
+
+   private:
+    x264_t *m_encoder{nullptr};
+    uint32_t m_width{0};
+    uint32_t m_height{0};
+    int32_t m_targetBitrate{0};
+    std::string m_configuration{};
+    bool m_forceIntraFrame{false};
+    int64_t m_frameCounter{0};
+};
+
+#endif